@@ -0,0 +1,93 @@
+/**
+ * Audio Resampling Benchmark
+ * 
+ * Measures the cost per output sample of each audio quality level.
+ * OUTX changes are fed straight into the audio hook at the ROM's rate
+ * (one update per 4 scanlines), so only the audio path is timed.
+ */
+
+#include "gigatron.h"
+#include "audio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_SECONDS       20      /* Emulated time per quality level */
+#define BENCH_OUTX_PERIOD   800     /* Cycles between OUTX updates */
+
+/**
+ * Get monotonic wall time in seconds
+ */
+static double bench_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Run one quality level, returns nanoseconds per output sample
+ */
+static double bench_quality(gigatron_t* cpu, audio_quality_t quality, uint32_t sample_rate,
+                            uint64_t* out_samples) {
+    audio_t audio;
+    if (!audio_init(&audio, cpu)) return 0.0;
+    audio_set_quality(&audio, quality);
+    audio_set_sample_rate(&audio, sample_rate);
+    
+    static float samples[AUDIO_BUFFER_SIZE * AUDIO_NUM_BUFFERS];
+    const uint32_t cycles_per_frame = cpu->hz / 60;
+    const uint32_t frames = BENCH_SECONDS * 60;
+    uint64_t total = 0;
+    uint32_t seed = 1;
+    
+    double start = bench_now();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        uint64_t end = cpu->cycles + cycles_per_frame;
+        for (uint64_t cycle = cpu->cycles + BENCH_OUTX_PERIOD; cycle < end; cycle += BENCH_OUTX_PERIOD) {
+            /* Pseudo-random 4-bit levels: worst case, every update is a step */
+            seed = seed * 1664525u + 1013904223u;
+            cpu->outx_cb(cpu->outx_user_data, cycle, (uint8_t)(seed >> 24) & 0xF0);
+        }
+        cpu->cycles = end;
+        audio_update(&audio);
+        total += audio_read_samples(&audio, samples, sizeof(samples) / sizeof(samples[0]));
+    }
+    double elapsed = bench_now() - start;
+    
+    audio_shutdown(&audio);
+    cpu->cycles = 0;
+    
+    *out_samples = total;
+    return total ? elapsed * 1e9 / (double)total : 0.0;
+}
+
+int main(int argc, char** argv) {
+    uint32_t sample_rate = (argc > 1) ? (uint32_t)atoi(argv[1]) : AUDIO_SAMPLE_RATE;
+    if (sample_rate < 8000 || sample_rate > 192000) {
+        fprintf(stderr, "Usage: %s [sample_rate]\n", argv[0]);
+        return 1;
+    }
+    
+    gigatron_config_t config = gigatron_default_config();
+    gigatron_t cpu;
+    if (!gigatron_init(&cpu, &config)) {
+        fprintf(stderr, "Failed to initialize CPU\n");
+        return 1;
+    }
+    
+    printf("Audio bench: %u Hz output, %d s emulated per level\n\n", sample_rate, BENCH_SECONDS);
+    printf("%-18s %12s %12s %10s\n", "Quality", "Samples", "ns/sample", "% budget");
+    
+    /* Real-time budget per sample */
+    double budget_ns = 1e9 / (double)sample_rate;
+    
+    for (int q = 0; q < AUDIO_QUALITY_COUNT; q++) {
+        uint64_t samples = 0;
+        double ns = bench_quality(&cpu, (audio_quality_t)q, sample_rate, &samples);
+        printf("%-18s %12llu %12.2f %9.3f%%\n", audio_quality_name((audio_quality_t)q),
+               (unsigned long long)samples, ns, ns * 100.0 / budget_ns);
+    }
+    
+    gigatron_shutdown(&cpu);
+    return 0;
+}
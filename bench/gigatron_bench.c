@@ -0,0 +1,530 @@
+/**
+ * Gigatron Benchmark Suite
+ *
+ * Repeatable micro and macro benchmarks of the core:
+ *   gigatron_bench <rom> [--reps N] [--frames N] [--gt1 FILE] [--filter TEXT] [--json FILE]
+ *
+ * Every benchmark runs once to warm up, then N timed repetitions. The
+ * table shows mean and spread; --json writes every sample with mean,
+ * standard deviation, min, median and max, for tracking across commits.
+ *
+ * RAM is zeroed before each boot, so all runs execute the same cycles.
+ * The JSON names the commit it was built from (GIGATRON_BENCH_COMMIT, set
+ * by CMake from git).
+ */
+
+#include "gigatron.h"
+#include "vga.h"
+#include "audio.h"
+#include "loader.h"
+#include "machine.h"
+#include "pacer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define BENCH_DEFAULT_REPS      5
+#define BENCH_DEFAULT_FRAMES    300     /* Demo frames */
+#define BENCH_MAX_REPS          100
+#define BENCH_BOOT_FRAMES       100     /* Reset to menu (as the loader waits) */
+#define BENCH_RUN_FRAMES        60      /* gigatron_run per repetition */
+#define BENCH_VGA_FRAMES        60      /* vga_tick replays per repetition */
+#define BENCH_AUDIO_SECONDS     2       /* Emulated audio per repetition */
+#define BENCH_OUTX_PERIOD       800     /* Cycles between OUTX updates (4 lines) */
+#define BENCH_PARSE_COUNT       2000    /* loader_parse_gt1 calls per repetition */
+#define BENCH_LOAD_TIMEOUT      3000    /* Frames before a loader session fails */
+#define BENCH_MENU_RACER        1       /* Menu entries above Racer */
+
+#ifndef GIGATRON_BENCH_COMMIT
+#define GIGATRON_BENCH_COMMIT   "unknown"
+#endif
+
+/**
+ * Shared inputs, prepared once
+ */
+typedef struct bench_ctx_t {
+    const char* rom_file;
+    uint32_t frames;
+    uint8_t* gt1_data;
+    size_t gt1_size;
+    uint8_t* out_trace;     /* OUT per cycle of one frame at the menu */
+    bool failed;            /* Set by a benchmark whose workload did not complete */
+} bench_ctx_t;
+
+/**
+ * Benchmark: one repetition, returns its result in unit
+ */
+typedef struct bench_t {
+    const char* name;
+    const char* unit;
+    bool higher_is_better;
+    double (*run)(bench_ctx_t* ctx);
+} bench_t;
+
+/**
+ * Emulated machine with its devices
+ */
+typedef struct bench_machine_t {
+    gigatron_t cpu;
+    vga_t vga;
+    loader_t loader;
+    machine_t machine;
+} bench_machine_t;
+
+/**
+ * Get monotonic wall time in seconds
+ */
+static double bench_now(void) {
+    return (double)pacer_now_ns() * 1e-9;
+}
+
+/**
+ * Initialize CPU, VGA and loader, load the ROM and reset with zeroed RAM
+ */
+static bool bench_machine_init(bench_machine_t* m, const bench_ctx_t* ctx) {
+    gigatron_config_t config = gigatron_default_config();
+    if (!gigatron_init(&m->cpu, &config)) return false;
+    if (!gigatron_load_rom_file(&m->cpu, ctx->rom_file) || !vga_init(&m->vga, &m->cpu) ||
+        !loader_init(&m->loader, &m->cpu)) {
+        gigatron_shutdown(&m->cpu);
+        return false;
+    }
+    memset(m->cpu.ram, 0, m->cpu.ram_size);
+    gigatron_reset(&m->cpu);
+    machine_init(&m->machine, &m->cpu, &m->vga, &m->loader);
+    return true;
+}
+
+static void bench_machine_shutdown(bench_machine_t* m) {
+    loader_shutdown(&m->loader);
+    vga_shutdown(&m->vga);
+    gigatron_shutdown(&m->cpu);
+}
+
+static void bench_frames(bench_machine_t* m, uint32_t frames) {
+    machine_run(&m->machine, (uint64_t)frames * GIGATRON_CYCLES_PER_FRAME);
+}
+
+/**
+ * Hold buttons for a frame, then release them for a frame
+ */
+static void bench_press(bench_machine_t* m, uint8_t buttons) {
+    m->cpu.in_reg = buttons ^ 0xFF;
+    bench_frames(m, 1);
+    m->cpu.in_reg = 0xFF;
+    bench_frames(m, 1);
+}
+
+/*
+ * Micro benchmarks
+ */
+
+/* gigatron_run throughput in emulated MHz */
+static double bench_cpu_run(bench_ctx_t* ctx) {
+    bench_machine_t m;
+    if (!bench_machine_init(&m, ctx)) {
+        ctx->failed = true;
+        return 0.0;
+    }
+    bench_frames(&m, BENCH_BOOT_FRAMES);
+    
+    const uint32_t cycles = BENCH_RUN_FRAMES * GIGATRON_CYCLES_PER_FRAME;
+    double start = bench_now();
+    gigatron_run(&m.cpu, cycles);
+    double elapsed = bench_now() - start;
+    
+    bench_machine_shutdown(&m);
+    return (double)cycles / elapsed * 1e-6;
+}
+
+/* vga_tick cost per frame in microseconds, replaying a recorded OUT sequence */
+static double bench_vga_tick(bench_ctx_t* ctx) {
+    gigatron_config_t config = gigatron_default_config();
+    gigatron_t cpu;
+    vga_t vga;
+    if (!gigatron_init(&cpu, &config) || !vga_init(&vga, &cpu)) {
+        ctx->failed = true;
+        return 0.0;
+    }
+    
+    double start = bench_now();
+    for (uint32_t frame = 0; frame < BENCH_VGA_FRAMES; frame++) {
+        for (uint32_t i = 0; i < GIGATRON_CYCLES_PER_FRAME; i++) {
+            cpu.out = ctx->out_trace[i];
+            vga_tick(&vga);
+        }
+    }
+    double elapsed = bench_now() - start;
+    
+    if (vga_get_frame_count(&vga) < BENCH_VGA_FRAMES - 1) ctx->failed = true;
+    vga_shutdown(&vga);
+    gigatron_shutdown(&cpu);
+    return elapsed * 1e6 / BENCH_VGA_FRAMES;
+}
+
+/* Audio cost per second of output in milliseconds (default quality) */
+static double bench_audio(bench_ctx_t* ctx) {
+    gigatron_config_t config = gigatron_default_config();
+    gigatron_t cpu;
+    audio_t audio;
+    if (!gigatron_init(&cpu, &config) || !audio_init(&audio, &cpu)) {
+        ctx->failed = true;
+        return 0.0;
+    }
+    
+    static float samples[AUDIO_BUFFER_SIZE * AUDIO_NUM_BUFFERS];
+    const uint32_t frames = BENCH_AUDIO_SECONDS * 60;
+    const uint32_t cycles_per_frame = cpu.hz / 60;
+    uint32_t seed = 1;
+    
+    double start = bench_now();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        uint64_t end = cpu.cycles + cycles_per_frame;
+        for (uint64_t cycle = cpu.cycles + BENCH_OUTX_PERIOD; cycle < end; cycle += BENCH_OUTX_PERIOD) {
+            seed = seed * 1664525u + 1013904223u;
+            cpu.outx_cb(cpu.outx_user_data, cycle, (uint8_t)(seed >> 24) & 0xF0);
+        }
+        cpu.cycles = end;
+        audio_update(&audio);
+        audio_read_samples(&audio, samples, sizeof(samples) / sizeof(samples[0]));
+    }
+    double elapsed = bench_now() - start;
+    
+    audio_shutdown(&audio);
+    gigatron_shutdown(&cpu);
+    return elapsed * 1e3 / BENCH_AUDIO_SECONDS;
+}
+
+/* loader_parse_gt1 cost per file in microseconds */
+static double bench_gt1_parse(bench_ctx_t* ctx) {
+    double start = bench_now();
+    for (uint32_t i = 0; i < BENCH_PARSE_COUNT; i++) {
+        gt1_file_t* gt1 = loader_parse_gt1(ctx->gt1_data, ctx->gt1_size);
+        if (!gt1) {
+            ctx->failed = true;
+            return 0.0;
+        }
+        loader_free_gt1(gt1);
+    }
+    return (bench_now() - start) * 1e6 / BENCH_PARSE_COUNT;
+}
+
+/*
+ * Macro benchmarks
+ */
+
+/* Full loader session (reset, menu navigation, transfer, start) in milliseconds */
+static double bench_loader_session(bench_ctx_t* ctx) {
+    bench_machine_t m;
+    gt1_file_t* gt1 = loader_parse_gt1(ctx->gt1_data, ctx->gt1_size);
+    if (!gt1 || !bench_machine_init(&m, ctx)) {
+        loader_free_gt1(gt1);
+        ctx->failed = true;
+        return 0.0;
+    }
+    
+    double start = bench_now();
+    loader_start(&m.loader, gt1);
+    uint32_t frames = 0;
+    while (loader_is_active(&m.loader) && frames++ < BENCH_LOAD_TIMEOUT) {
+        bench_frames(&m, 1);
+    }
+    double elapsed = bench_now() - start;
+    
+    if (!loader_is_complete(&m.loader)) ctx->failed = true;
+    bench_machine_shutdown(&m);
+    return elapsed * 1e3;
+}
+
+/* Reset to the menu with video in milliseconds */
+static double bench_boot(bench_ctx_t* ctx) {
+    bench_machine_t m;
+    if (!bench_machine_init(&m, ctx)) {
+        ctx->failed = true;
+        return 0.0;
+    }
+    
+    double start = bench_now();
+    bench_frames(&m, BENCH_BOOT_FRAMES);
+    double elapsed = bench_now() - start;
+    
+    bench_machine_shutdown(&m);
+    return elapsed * 1e3;
+}
+
+/* Racer started from the menu with video, emulated frames per second */
+static double bench_demo(bench_ctx_t* ctx) {
+    bench_machine_t m;
+    if (!bench_machine_init(&m, ctx)) {
+        ctx->failed = true;
+        return 0.0;
+    }
+    bench_frames(&m, BENCH_BOOT_FRAMES);
+    for (uint32_t i = 0; i < BENCH_MENU_RACER; i++) {
+        bench_press(&m, GIGATRON_BTN_DOWN);
+    }
+    bench_press(&m, GIGATRON_BTN_A);
+    
+    double start = bench_now();
+    bench_frames(&m, ctx->frames);
+    double elapsed = bench_now() - start;
+    
+    bench_machine_shutdown(&m);
+    return (double)ctx->frames / elapsed;
+}
+
+static const bench_t benches[] = {
+    { "cpu_run",        "MHz",      true,   bench_cpu_run },
+    { "vga_tick",       "us/frame", false,  bench_vga_tick },
+    { "audio",          "ms/s",     false,  bench_audio },
+    { "gt1_parse",      "us/file",  false,  bench_gt1_parse },
+    { "loader_session", "ms",       false,  bench_loader_session },
+    { "boot_to_menu",   "ms",       false,  bench_boot },
+    { "demo",           "fps",      true,   bench_demo },
+};
+
+#define NUM_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+/*
+ * Inputs
+ */
+
+/**
+ * Build a GT1 file: one 96-byte segment in the free tail of each video
+ * page, starting a vCPU loop (BRA to itself) on the first.
+ */
+static uint8_t* bench_make_gt1(size_t* size) {
+    const uint32_t first_page = 0x08;
+    const uint32_t last_page = 0x7F;
+    const uint32_t seg_size = 96;
+    size_t capacity = (last_page - first_page + 1) * (3 + seg_size) + 3;
+    uint8_t* data = (uint8_t*)malloc(capacity);
+    if (!data) return NULL;
+    
+    size_t pos = 0;
+    uint32_t seed = 7;
+    for (uint32_t page = first_page; page <= last_page; page++) {
+        data[pos++] = (uint8_t)page;
+        data[pos++] = 0xA0;
+        data[pos++] = (uint8_t)seg_size;
+        for (uint32_t i = 0; i < seg_size; i++) {
+            seed = seed * 1664525u + 1013904223u;
+            data[pos++] = (uint8_t)(seed >> 24);
+        }
+    }
+    data[3] = 0x90;     /* 08A0: BRA $08A0 */
+    data[4] = 0x9E;
+    data[pos++] = 0x00;
+    data[pos++] = (uint8_t)first_page;
+    data[pos++] = 0xA0;
+    
+    *size = pos;
+    return data;
+}
+
+static uint8_t* bench_read_file(const char* filename, size_t* size) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = length > 0 ? (uint8_t*)malloc((size_t)length) : NULL;
+    if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    *size = data ? (size_t)length : 0;
+    return data;
+}
+
+/**
+ * Record OUT per cycle for one frame at the menu, from a VSYNC falling edge
+ */
+static uint8_t* bench_record_out(const bench_ctx_t* ctx) {
+    bench_machine_t m;
+    if (!bench_machine_init(&m, ctx)) return NULL;
+    uint8_t* trace = (uint8_t*)malloc(GIGATRON_CYCLES_PER_FRAME);
+    if (trace) {
+        bench_frames(&m, BENCH_BOOT_FRAMES);
+        machine_until_t until = { MACHINE_STOP_VSYNC, 0, 0, 0 };
+        machine_run_until(&m.machine, &until);
+        for (uint32_t i = 0; i < GIGATRON_CYCLES_PER_FRAME; i++) {
+            gigatron_tick(&m.cpu);
+            trace[i] = m.cpu.out;
+        }
+    }
+    bench_machine_shutdown(&m);
+    return trace;
+}
+
+/*
+ * Statistics and output
+ */
+
+typedef struct bench_stats_t {
+    double mean;
+    double stddev;
+    double min;
+    double median;
+    double max;
+} bench_stats_t;
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static bench_stats_t bench_stats(const double* samples, uint32_t count) {
+    bench_stats_t stats = { 0 };
+    double sorted[BENCH_MAX_REPS];
+    memcpy(sorted, samples, count * sizeof(double));
+    qsort(sorted, count, sizeof(double), compare_double);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        stats.mean += sorted[i];
+    }
+    stats.mean /= count;
+    double sum_sq = 0.0;
+    for (uint32_t i = 0; i < count; i++) {
+        sum_sq += (sorted[i] - stats.mean) * (sorted[i] - stats.mean);
+    }
+    stats.stddev = count > 1 ? sqrt(sum_sq / (count - 1)) : 0.0;
+    stats.min = sorted[0];
+    stats.max = sorted[count - 1];
+    stats.median = count % 2 ? sorted[count / 2] : (sorted[count / 2 - 1] + sorted[count / 2]) * 0.5;
+    return stats;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: gigatron_bench <rom> [--reps N] [--frames N] [--gt1 FILE] [--filter TEXT]\n"
+            "                      [--json FILE]\n"
+            "  --reps N       Timed repetitions per benchmark (default %d, max %d)\n"
+            "  --frames N     Frames of the demo workload (default %d)\n"
+            "  --gt1 FILE     GT1 for gt1_parse and loader_session (default: built in)\n"
+            "  --filter TEXT  Only run benchmarks whose name contains TEXT\n"
+            "  --json FILE    Write results as JSON (- for stdout)\n"
+            "Benchmarks:\n",
+            BENCH_DEFAULT_REPS, BENCH_MAX_REPS, BENCH_DEFAULT_FRAMES);
+    for (size_t i = 0; i < NUM_BENCHES; i++) {
+        fprintf(stderr, "  %-16s %s\n", benches[i].name, benches[i].unit);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+    
+    bench_ctx_t ctx = { 0 };
+    ctx.rom_file = argv[1];
+    ctx.frames = BENCH_DEFAULT_FRAMES;
+    uint32_t reps = BENCH_DEFAULT_REPS;
+    const char* gt1_file = NULL;
+    const char* filter = NULL;
+    const char* json_file = NULL;
+    for (int i = 2; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        if (strcmp(argv[i], "--reps") == 0) {
+            reps = (uint32_t)atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--frames") == 0) {
+            ctx.frames = (uint32_t)atoi(argv[i + 1]);
+        } else if (strcmp(argv[i], "--gt1") == 0) {
+            gt1_file = argv[i + 1];
+        } else if (strcmp(argv[i], "--filter") == 0) {
+            filter = argv[i + 1];
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json_file = argv[i + 1];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (reps < 1 || reps > BENCH_MAX_REPS || ctx.frames < 1) {
+        usage();
+        return 1;
+    }
+    
+    ctx.gt1_data = gt1_file ? bench_read_file(gt1_file, &ctx.gt1_size) : bench_make_gt1(&ctx.gt1_size);
+    if (!ctx.gt1_data) {
+        fprintf(stderr, "Failed to read GT1: %s\n", gt1_file ? gt1_file : "(built in)");
+        return 1;
+    }
+    ctx.out_trace = bench_record_out(&ctx);
+    if (!ctx.out_trace) {
+        fprintf(stderr, "Failed to load ROM: %s\n", ctx.rom_file);
+        free(ctx.gt1_data);
+        return 1;
+    }
+    
+    /* The table goes to stderr when the JSON goes to stdout */
+    FILE* table = (json_file && strcmp(json_file, "-") == 0) ? stderr : stdout;
+    fprintf(table, "%-16s %-9s %12s %10s %12s %12s\n", "Benchmark", "Unit", "Mean", "Stddev", "Min", "Max");
+    
+    double samples[NUM_BENCHES][BENCH_MAX_REPS];
+    bench_stats_t stats[NUM_BENCHES];
+    bool ran[NUM_BENCHES] = { false };
+    bool failed[NUM_BENCHES] = { false };
+    int status = 0;
+    for (size_t b = 0; b < NUM_BENCHES; b++) {
+        if (filter && !strstr(benches[b].name, filter)) continue;
+        
+        ctx.failed = false;
+        benches[b].run(&ctx);
+        for (uint32_t r = 0; r < reps; r++) {
+            samples[b][r] = benches[b].run(&ctx);
+        }
+        ran[b] = true;
+        failed[b] = ctx.failed;
+        stats[b] = bench_stats(samples[b], reps);
+        
+        if (failed[b]) {
+            fprintf(table, "%-16s %-9s %12s\n", benches[b].name, benches[b].unit, "FAILED");
+            status = 1;
+        } else {
+            fprintf(table, "%-16s %-9s %12.3f %9.2f%% %12.3f %12.3f\n", benches[b].name, benches[b].unit,
+                    stats[b].mean, stats[b].mean ? stats[b].stddev * 100.0 / stats[b].mean : 0.0,
+                    stats[b].min, stats[b].max);
+        }
+        fflush(table);
+    }
+    
+    if (json_file) {
+        FILE* json = strcmp(json_file, "-") == 0 ? stdout : fopen(json_file, "w");
+        if (!json) {
+            fprintf(stderr, "Failed to write %s\n", json_file);
+            status = 1;
+        } else {
+            fprintf(json, "{\n  \"version\": 1,\n  \"commit\": \"%s\",\n  \"repetitions\": %u,\n  \"benchmarks\": [",
+                    GIGATRON_BENCH_COMMIT, reps);
+            const char* sep = "";
+            for (size_t b = 0; b < NUM_BENCHES; b++) {
+                if (!ran[b]) continue;
+                fprintf(json, "%s\n    {\"name\": \"%s\", \"unit\": \"%s\", \"higher_is_better\": %s, "
+                        "\"ok\": %s,\n     \"mean\": %.6g, \"stddev\": %.6g, \"min\": %.6g, "
+                        "\"median\": %.6g, \"max\": %.6g,\n     \"samples\": [",
+                        sep, benches[b].name, benches[b].unit, benches[b].higher_is_better ? "true" : "false",
+                        failed[b] ? "false" : "true", stats[b].mean, stats[b].stddev, stats[b].min,
+                        stats[b].median, stats[b].max);
+                for (uint32_t r = 0; r < reps; r++) {
+                    fprintf(json, "%s%.6g", r ? ", " : "", samples[b][r]);
+                }
+                fprintf(json, "]}");
+                sep = ",";
+            }
+            fprintf(json, "\n  ]\n}\n");
+            if (json != stdout) fclose(json);
+        }
+    }
+    
+    free(ctx.out_trace);
+    free(ctx.gt1_data);
+    return status;
+}
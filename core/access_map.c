@@ -0,0 +1,47 @@
+/**
+ * Gigatron RAM Access Counters
+ */
+
+#include "access_map.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Initialize counters
+ */
+bool access_map_init(access_map_t* map, uint32_t ram_size) {
+    if (!map || ram_size == 0) return false;
+    
+    map->reads = (uint32_t*)calloc(ram_size, sizeof(uint32_t));
+    map->writes = (uint32_t*)calloc(ram_size, sizeof(uint32_t));
+    if (!map->reads || !map->writes) {
+        access_map_shutdown(map);
+        return false;
+    }
+    map->size = ram_size;
+    
+    return true;
+}
+
+/**
+ * Free the counters
+ */
+void access_map_shutdown(access_map_t* map) {
+    if (!map) return;
+    
+    free(map->reads);
+    free(map->writes);
+    map->reads = NULL;
+    map->writes = NULL;
+    map->size = 0;
+}
+
+/**
+ * Clear all counts
+ */
+void access_map_reset(access_map_t* map) {
+    if (!map || !map->reads || !map->writes) return;
+    
+    memset(map->reads, 0, map->size * sizeof(uint32_t));
+    memset(map->writes, 0, map->size * sizeof(uint32_t));
+}
@@ -0,0 +1,52 @@
+/**
+ * Gigatron RAM Access Counters
+ *
+ * Counts reads and writes per RAM address. Counting is done by a separate
+ * machine run loop variant (see machine_set_access_map), so the default
+ * loops are unaffected while no map is attached.
+ *
+ * Counters only grow (and wrap), so a reader on another thread takes the
+ * difference between two looks to get the accesses in between.
+ */
+
+#ifndef GIGATRON_ACCESS_MAP_H
+#define GIGATRON_ACCESS_MAP_H
+
+#include "gigatron.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Access counter state
+ */
+typedef struct access_map_t {
+    uint32_t* reads;    /* Reads per RAM address */
+    uint32_t* writes;   /* Writes per RAM address */
+    uint32_t size;      /* Number of addresses */
+} access_map_t;
+
+/**
+ * Initialize counters for ram_size bytes of RAM.
+ * Returns true on success, false on failure.
+ */
+bool access_map_init(access_map_t* map, uint32_t ram_size);
+
+/**
+ * Free the counters.
+ */
+void access_map_shutdown(access_map_t* map);
+
+/**
+ * Clear all counts.
+ */
+void access_map_reset(access_map_t* map);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GIGATRON_ACCESS_MAP_H */
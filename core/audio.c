@@ -3,9 +3,72 @@
  */
 
 #include "audio.h"
+#include "gigatron_atomic.h"
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
+/* DC filter lanes: SSE2 or NEON where available, portable C otherwise */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define AUDIO_NEON
+#endif
+
+#define AUDIO_PI            3.14159265358979323846
+#define AUDIO_BLEP_CUTOFF   0.45    /* Kernel cutoff as a fraction of the sample rate */
+
+static void audio_outx_changed(void* user_data, uint64_t cycle, uint8_t outx);
+
+/**
+ * Convert OUTX to a raw sample (4-bit DAC on the upper nibble)
+ */
+static inline float audio_outx_level(uint8_t outx) {
+    return (float)(outx >> 4) / 8.0f;
+}
+
+/**
+ * Build the band-limited step kernel for the current quality.
+ * Row p holds a Blackman-windowed sinc for a step (p + 0.5) / PHASES
+ * samples before the output sample it is added at, delayed by taps / 2.
+ */
+static void audio_build_kernel(audio_t* audio) {
+    static const uint32_t taps_for_quality[AUDIO_QUALITY_COUNT] = { 1, 8, 16, 32 };
+    
+    uint32_t taps = taps_for_quality[audio->quality];
+    double half = (double)(taps / 2);
+    audio->taps = taps;
+    memset(audio->kernel, 0, sizeof(audio->kernel));
+    
+    for (uint32_t phase = 0; phase < AUDIO_BLEP_PHASES; phase++) {
+        float* kernel = audio->kernel[phase];
+        if (taps == 1) {
+            kernel[0] = 1.0f;
+            continue;
+        }
+        
+        double offset = (phase + 0.5) / AUDIO_BLEP_PHASES;
+        double coeffs[AUDIO_BLEP_MAX_TAPS];
+        double sum = 0.0;
+        for (uint32_t i = 0; i < taps; i++) {
+            double x = (double)i - half + offset;
+            double sinc = (x == 0.0) ? 2.0 * AUDIO_BLEP_CUTOFF :
+                          sin(2.0 * AUDIO_PI * AUDIO_BLEP_CUTOFF * x) / (AUDIO_PI * x);
+            double window = 0.42 + 0.5 * cos(AUDIO_PI * x / half) +
+                            0.08 * cos(2.0 * AUDIO_PI * x / half);
+            coeffs[i] = sinc * window;
+            sum += coeffs[i];
+        }
+        
+        /* Unity gain so a step settles exactly at its new level */
+        for (uint32_t i = 0; i < taps; i++) {
+            kernel[i] = (float)(coeffs[i] / sum);
+        }
+    }
+}
+
 /**
  * Initialize audio emulation
  */
@@ -15,7 +78,12 @@ bool audio_init(audio_t* audio, gigatron_t* cpu) {
     memset(audio, 0, sizeof(audio_t));
     
     audio->cpu = cpu;
+    audio->cycle = cpu->cycles;
+    audio->level = audio_outx_level(cpu->outx);
+    audio->integrator = audio->level;
     audio->sample_rate = AUDIO_SAMPLE_RATE;
+    audio->resample_hz = cpu->hz;
+    audio->drc_ratio = 1.0;
     audio->volume = 1.0f;
     audio->mute = false;
     
@@ -23,8 +91,16 @@ bool audio_init(audio_t* audio, gigatron_t* cpu) {
     audio->alpha = 0.99f;
     audio->bias = 0.0f;
     
-    /* Allocate sample buffer */
-    audio->buffer.size = AUDIO_BUFFER_SIZE * AUDIO_NUM_BUFFERS;
+    audio->quality = AUDIO_QUALITY_MEDIUM;
+    audio_build_kernel(audio);
+    
+    /* Allocate sample buffer (power of two for index masking) */
+    uint32_t size = 1;
+    while (size < AUDIO_BUFFER_SIZE * AUDIO_NUM_BUFFERS) {
+        size <<= 1;
+    }
+    audio->buffer.size = size;
+    audio->buffer.mask = size - 1;
     audio->buffer.samples = (float*)calloc(audio->buffer.size, sizeof(float));
     if (!audio->buffer.samples) {
         return false;
@@ -33,6 +109,9 @@ bool audio_init(audio_t* audio, gigatron_t* cpu) {
     audio->buffer.write_pos = 0;
     audio->buffer.read_pos = 0;
     
+    /* Record OUTX changes instead of sampling every cycle */
+    gigatron_set_outx_callback(cpu, audio_outx_changed, audio);
+    
     return true;
 }
 
@@ -42,6 +121,10 @@ bool audio_init(audio_t* audio, gigatron_t* cpu) {
 void audio_shutdown(audio_t* audio) {
     if (!audio) return;
     
+    if (audio->cpu && audio->cpu->outx_user_data == audio) {
+        gigatron_set_outx_callback(audio->cpu, NULL, NULL);
+    }
+    
     if (audio->buffer.samples) {
         free(audio->buffer.samples);
         audio->buffer.samples = NULL;
@@ -56,11 +139,83 @@ void audio_reset(audio_t* audio) {
     
     audio->cycle_counter = 0;
     audio->bias = 0.0f;
-    audio->buffer.write_pos = 0;
-    audio->buffer.read_pos = 0;
+    audio->num_events = 0;
+    if (audio->cpu) {
+        audio->cycle = audio->cpu->cycles;
+        audio->level = audio_outx_level(audio->cpu->outx);
+    }
+    memset(audio->deltas, 0, sizeof(audio->deltas));
+    audio->integrator = audio->level;
+    audio->drc_fill = (double)audio->drc_target;
+}
+
+/**
+ * Select the resampling quality
+ */
+void audio_set_quality(audio_t* audio, audio_quality_t quality) {
+    if (!audio || quality >= AUDIO_QUALITY_COUNT) return;
     
-    if (audio->buffer.samples) {
-        memset(audio->buffer.samples, 0, audio->buffer.size * sizeof(float));
+    /* Pending kernel tails stay valid, they are integrated as before */
+    audio->quality = quality;
+    audio_build_kernel(audio);
+}
+
+/**
+ * Set the output sample rate
+ */
+bool audio_set_sample_rate(audio_t* audio, uint32_t sample_rate) {
+    if (!audio || sample_rate < 8000 || sample_rate > 192000) return false;
+    
+    audio->sample_rate = sample_rate;
+    return true;
+}
+
+/**
+ * Enable dynamic rate control
+ */
+void audio_set_rate_control(audio_t* audio, bool enable, uint32_t target_samples) {
+    if (!audio) return;
+    
+    audio->drc_enabled = enable;
+    audio->drc_target = target_samples ? target_samples : 1;
+    audio->drc_fill = (double)audio->drc_target;
+    audio->drc_integral = 0.0;
+    audio->drc_ratio = 1.0;
+}
+
+/**
+ * Get buffered audio latency in milliseconds
+ */
+float audio_get_latency_ms(const audio_t* audio) {
+    if (!audio || audio->sample_rate == 0) return 0.0f;
+    
+    return (float)audio_available_samples(audio) * 1000.0f / (float)audio->sample_rate;
+}
+
+/**
+ * Get number of underruns
+ */
+uint32_t audio_get_underruns(const audio_t* audio) {
+    return audio ? GIGATRON_LOAD_ACQUIRE(&audio->buffer.underruns) : 0;
+}
+
+/**
+ * Get number of overruns
+ */
+uint32_t audio_get_overruns(const audio_t* audio) {
+    return audio ? audio->buffer.overruns : 0;
+}
+
+/**
+ * Get display name of a quality level
+ */
+const char* audio_quality_name(audio_quality_t quality) {
+    switch (quality) {
+        case AUDIO_QUALITY_POINT:  return "Point";
+        case AUDIO_QUALITY_LOW:    return "Low (8 taps)";
+        case AUDIO_QUALITY_MEDIUM: return "Medium (16 taps)";
+        case AUDIO_QUALITY_HIGH:   return "High (32 taps)";
+        default:                   return "Unknown";
     }
 }
 
@@ -70,14 +225,10 @@ void audio_reset(audio_t* audio) {
 uint32_t audio_available_samples(const audio_t* audio) {
     if (!audio) return 0;
     
-    uint32_t write = audio->buffer.write_pos;
-    uint32_t read = audio->buffer.read_pos;
-    
-    if (write >= read) {
-        return write - read;
-    } else {
-        return audio->buffer.size - read + write;
-    }
+    /* Free-running positions, unsigned difference handles wrap-around */
+    uint32_t write = GIGATRON_LOAD_ACQUIRE(&audio->buffer.write_pos);
+    uint32_t read = GIGATRON_LOAD_ACQUIRE(&audio->buffer.read_pos);
+    return write - read;
 }
 
 /**
@@ -86,72 +237,313 @@ uint32_t audio_available_samples(const audio_t* audio) {
 bool audio_buffer_full(const audio_t* audio) {
     if (!audio) return true;
     
-    uint32_t next_write = (audio->buffer.write_pos + 1) % audio->buffer.size;
-    return next_write == audio->buffer.read_pos;
+    return audio_available_samples(audio) >= audio->buffer.size;
 }
 
 /**
- * Write a sample to the buffer
+ * Write a block of samples to the buffer (producer side).
+ * Samples that don't fit are dropped.
  */
-static void audio_write_sample(audio_t* audio, float sample) {
-    uint32_t next_write = (audio->buffer.write_pos + 1) % audio->buffer.size;
+static void audio_write_samples(audio_t* audio, const float* samples, uint32_t count) {
+    audio_buffer_t* buffer = &audio->buffer;
+    uint32_t write = buffer->write_pos;
+    uint32_t read = GIGATRON_LOAD_ACQUIRE(&buffer->read_pos);
     
     /* Don't overwrite unread samples */
-    if (next_write != audio->buffer.read_pos) {
-        audio->buffer.samples[audio->buffer.write_pos] = sample;
-        audio->buffer.write_pos = next_write;
+    uint32_t space = buffer->size - (write - read);
+    if (count > space) {
+        count = space;
+        buffer->overruns++;
+    }
+    
+    uint32_t start = write & buffer->mask;
+    uint32_t first = buffer->size - start;
+    if (first > count) first = count;
+    
+    memcpy(buffer->samples + start, samples, first * sizeof(float));
+    memcpy(buffer->samples, samples + first, (count - first) * sizeof(float));
+    
+    GIGATRON_STORE_RELEASE(&buffer->write_pos, write + count);
+}
+
+/**
+ * Remove the DC bias from a block of raw samples
+ */
+static void audio_remove_bias(audio_t* audio, float* block, uint32_t count) {
+    const float a = audio->alpha;
+    const float c = 1.0f - a;
+    
+    /*
+     * One-pole filter bias' = a * bias + c * x, unrolled 4 samples ahead:
+     * bias[k] = a^(k+1) * bias + sum(j <= k) c * a^(k-j) * x[j].
+     * The 4 lanes are independent, only the last one carries to the next
+     * block, so the serial dependency is one multiply-add per 4 samples
+     * instead of per sample. Stored transposed: gain[j] is the column of
+     * x[j]'s weights for the 4 lanes.
+     */
+    float decay[4];
+    float gain[4][4];
+    for (int k = 0; k < 4; k++) {
+        decay[k] = (k == 0) ? a : decay[k - 1] * a;
+        for (int j = 0; j < 4; j++) {
+            gain[j][k] = (j > k) ? 0.0f : ((j == k) ? c : gain[j][k - 1] * a);
+        }
     }
+    
+    float bias = audio->bias;
+    uint32_t i = 0;
+#if defined(AUDIO_SSE2)
+    const __m128 decay4 = _mm_loadu_ps(decay);
+    const __m128 g0 = _mm_loadu_ps(gain[0]);
+    const __m128 g1 = _mm_loadu_ps(gain[1]);
+    const __m128 g2 = _mm_loadu_ps(gain[2]);
+    const __m128 g3 = _mm_loadu_ps(gain[3]);
+    __m128 bias4 = _mm_set1_ps(bias);
+    for (; i + 4 <= count; i += 4) {
+        __m128 x = _mm_loadu_ps(block + i);
+        __m128 lo = _mm_add_ps(_mm_mul_ps(g0, _mm_shuffle_ps(x, x, 0x00)),
+                               _mm_mul_ps(g1, _mm_shuffle_ps(x, x, 0x55)));
+        __m128 hi = _mm_add_ps(_mm_mul_ps(g2, _mm_shuffle_ps(x, x, 0xAA)),
+                               _mm_mul_ps(g3, _mm_shuffle_ps(x, x, 0xFF)));
+        __m128 b = _mm_add_ps(_mm_mul_ps(decay4, bias4), _mm_add_ps(lo, hi));
+        _mm_storeu_ps(block + i, _mm_sub_ps(x, b));
+        bias4 = _mm_shuffle_ps(b, b, 0xFF);
+    }
+    bias = _mm_cvtss_f32(bias4);
+#elif defined(AUDIO_NEON)
+    const float32x4_t decay4 = vld1q_f32(decay);
+    const float32x4_t g0 = vld1q_f32(gain[0]);
+    const float32x4_t g1 = vld1q_f32(gain[1]);
+    const float32x4_t g2 = vld1q_f32(gain[2]);
+    const float32x4_t g3 = vld1q_f32(gain[3]);
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t x = vld1q_f32(block + i);
+        float32x4_t b = vmulq_n_f32(decay4, bias);
+        b = vmlaq_n_f32(b, g0, vgetq_lane_f32(x, 0));
+        b = vmlaq_n_f32(b, g1, vgetq_lane_f32(x, 1));
+        b = vmlaq_n_f32(b, g2, vgetq_lane_f32(x, 2));
+        b = vmlaq_n_f32(b, g3, vgetq_lane_f32(x, 3));
+        vst1q_f32(block + i, vsubq_f32(x, b));
+        bias = vgetq_lane_f32(b, 3);
+    }
+#else
+    for (; i + 4 <= count; i += 4) {
+        float* x = block + i;
+        float b[4];
+        for (int k = 0; k < 4; k++) {
+            b[k] = decay[k] * bias + gain[0][k] * x[0] + gain[1][k] * x[1] +
+                   gain[2][k] * x[2] + gain[3][k] * x[3];
+        }
+        for (int k = 0; k < 4; k++) {
+            x[k] -= b[k];
+        }
+        bias = b[3];
+    }
+#endif
+    for (; i < count; i++) {
+        bias = a * bias + c * block[i];
+        block[i] -= bias;
+    }
+    audio->bias = bias;
 }
 
 /**
- * Advance audio simulation by one tick
+ * Apply volume and clamp to [-1, 1] (mute is zero volume)
  */
-void audio_tick(audio_t* audio) {
-    if (!audio || !audio->cpu) return;
+static void audio_apply_volume(audio_t* audio, float* block, uint32_t count) {
+    const float volume = audio->mute ? 0.0f : audio->volume;
+    for (uint32_t i = 0; i < count; i++) {
+        float sample = block[i] * volume;
+        sample = (sample > 1.0f) ? 1.0f : sample;
+        sample = (sample < -1.0f) ? -1.0f : sample;
+        block[i] = sample;
+    }
+}
+
+/**
+ * Add a band-limited step to the delta buffer at the given output sample
+ */
+static inline void audio_add_step(audio_t* audio, uint32_t index, uint32_t phase, float delta) {
+    const float* kernel = audio->kernel[phase];
+    float* deltas = audio->deltas + index;
+    for (uint32_t i = 0; i < audio->taps; i++) {
+        deltas[i] += delta * kernel[i];
+    }
+}
+
+/**
+ * Integrate a block of deltas into samples and write them out
+ */
+static void audio_flush_block(audio_t* audio, uint32_t count) {
+    float block[AUDIO_BLOCK_SIZE];
     
-    /* Accumulate cycles and generate sample when enough have passed */
-    audio->cycle_counter += audio->sample_rate;
+    float sum = audio->integrator;
+    for (uint32_t i = 0; i < count; i++) {
+        sum += audio->deltas[i];
+        block[i] = sum;
+    }
+    audio->integrator = sum;
     
-    if (audio->cycle_counter >= audio->cpu->hz) {
-        audio->cycle_counter -= audio->cpu->hz;
-        
-        /* Get 4-bit audio sample from OUTX (upper 4 bits) */
-        float raw_sample = (float)(audio->cpu->outx >> 4) / 8.0f;
-        
-        /* Apply DC bias removal (high-pass filter) */
-        audio->bias = (audio->alpha * audio->bias) + ((1.0f - audio->alpha) * raw_sample);
-        float sample = raw_sample - audio->bias;
-        
-        /* Apply volume */
-        sample *= audio->volume;
+    /* Kernel tails past the block move to the front */
+    memmove(audio->deltas, audio->deltas + count, AUDIO_BLEP_MAX_TAPS * sizeof(float));
+    memset(audio->deltas + AUDIO_BLEP_MAX_TAPS, 0, count * sizeof(float));
+    
+    audio_remove_bias(audio, block, count);
+    if (audio->sample_cb) {
+        float period = (float)((double)audio->resample_hz / (double)audio->cpu->hz);
+        audio->sample_cb(audio->sample_user_data, block, count, period);
+    }
+    audio_apply_volume(audio, block, count);
+    audio_write_samples(audio, block, count);
+}
+
+/**
+ * Generate samples for the cycles up to and including `to`
+ */
+static void audio_render(audio_t* audio, uint64_t to) {
+    const uint32_t hz = audio->resample_hz;
+    const uint32_t rate = audio->sample_rate;
+    uint32_t count = 0;
+    uint32_t next_event = 0;
+    
+    for (;;) {
+        /* Cycles until the sample phase accumulator reaches hz */
+        uint32_t step = (audio->cycle_counter < hz) ? (hz - audio->cycle_counter + rate - 1) / rate : 0;
+        if (audio->cycle + step > to) {
+            audio->cycle_counter += (uint32_t)(to - audio->cycle) * rate;
+            audio->cycle = to;
+            break;
+        }
+        audio->cycle += step;
+        audio->cycle_counter += step * rate - hz;
         
-        /* Clamp to [-1, 1] */
-        if (sample > 1.0f) sample = 1.0f;
-        if (sample < -1.0f) sample = -1.0f;
+        /* Insert the OUTX steps since the previous sample (4-bit DAC) */
+        while (next_event < audio->num_events &&
+               audio->events[next_event].cycle <= audio->cycle) {
+            const audio_event_t* event = &audio->events[next_event++];
+            float level = audio_outx_level(event->outx);
+            
+            /*
+             * Sub-sample position of the step: the sample instant lies
+             * cycle_counter / rate cycles before the current cycle
+             */
+            uint64_t distance = (audio->cycle - event->cycle) * rate;
+            uint32_t phase = 0;
+            if (distance > audio->cycle_counter) {
+                phase = (uint32_t)((distance - audio->cycle_counter) * AUDIO_BLEP_PHASES / hz);
+                if (phase >= AUDIO_BLEP_PHASES) phase = AUDIO_BLEP_PHASES - 1;
+            }
+            
+            audio_add_step(audio, count, phase, level - audio->level);
+            audio->level = level;
+        }
         
-        /* Mute if needed */
-        if (audio->mute) {
-            sample = 0.0f;
+        if (++count == AUDIO_BLOCK_SIZE) {
+            audio_flush_block(audio, count);
+            count = 0;
         }
+    }
+    
+    /* Steps after the last sample belong to the next one */
+    audio->num_events -= next_event;
+    memmove(audio->events, audio->events + next_event, audio->num_events * sizeof(audio_event_t));
+    
+    if (count > 0) {
+        audio_flush_block(audio, count);
+    }
+}
+
+/**
+ * CPU hook: record an OUTX change
+ */
+static void audio_outx_changed(void* user_data, uint64_t cycle, uint8_t outx) {
+    audio_t* audio = (audio_t*)user_data;
+    
+    /* CPU was reset, restart sample timing */
+    if (cycle <= audio->cycle) {
+        audio->cycle = cycle;
+        audio->num_events = 0;
+    }
+    
+    if (audio->num_events == AUDIO_MAX_EVENTS) {
+        audio_render(audio, cycle - 1);
         
-        /* Write to buffer */
-        audio_write_sample(audio, sample);
+        /* Still full: fold into the last change */
+        if (audio->num_events == AUDIO_MAX_EVENTS) {
+            audio->num_events--;
+        }
+    }
+    
+    audio->events[audio->num_events].cycle = cycle;
+    audio->events[audio->num_events].outx = outx;
+    audio->num_events++;
+}
+
+/**
+ * Generate samples for all cycles run since the last update
+ */
+void audio_update(audio_t* audio) {
+    if (!audio || !audio->cpu) return;
+    
+    uint64_t now = audio->cpu->cycles;
+    if (now < audio->cycle) {
+        audio->cycle = now;
+        audio->num_events = 0;
+        return;
+    }
+    
+    /*
+     * Nudge the output rate towards the target fill. The proportional term
+     * alone would settle where its correction matches the clock offset, off
+     * target; the integral learns the offset and brings the fill back.
+     */
+    if (audio->drc_enabled) {
+        audio->drc_fill += AUDIO_DRC_SMOOTHING * ((double)audio_available_samples(audio) - audio->drc_fill);
+        double error = ((double)audio->drc_target - audio->drc_fill) / (double)audio->drc_target;
+        error = (error > 1.0) ? 1.0 : ((error < -1.0) ? -1.0 : error);
+        double integral = audio->drc_integral + AUDIO_DRC_INTEGRAL * error;
+        integral = (integral > AUDIO_DRC_WINDUP) ? AUDIO_DRC_WINDUP :
+                   ((integral < -AUDIO_DRC_WINDUP) ? -AUDIO_DRC_WINDUP : integral);
+        audio->drc_integral = integral;
+        double control = error + integral;
+        control = (control > 1.0) ? 1.0 : ((control < -1.0) ? -1.0 : control);
+        audio->drc_ratio = 1.0 + AUDIO_DRC_MAX_DELTA * control;
+    } else {
+        audio->drc_ratio = 1.0;
     }
+    audio->resample_hz = (uint32_t)((double)audio->cpu->hz / audio->drc_ratio + 0.5);
+    
+    audio_render(audio, now);
 }
 
 /**
- * Read samples from the audio buffer
+ * Read samples from the audio buffer (consumer side)
  */
 uint32_t audio_read_samples(audio_t* audio, float* out_samples, uint32_t count) {
     if (!audio || !out_samples || count == 0) return 0;
     
-    uint32_t available = audio_available_samples(audio);
+    audio_buffer_t* buffer = &audio->buffer;
+    uint32_t read = buffer->read_pos;
+    uint32_t write = GIGATRON_LOAD_ACQUIRE(&buffer->write_pos);
+    uint32_t available = write - read;
     uint32_t to_read = (count < available) ? count : available;
     
-    for (uint32_t i = 0; i < to_read; i++) {
-        out_samples[i] = audio->buffer.samples[audio->buffer.read_pos];
-        audio->buffer.read_pos = (audio->buffer.read_pos + 1) % audio->buffer.size;
+    /* Bulk copy in at most two pieces around the end of the ring */
+    uint32_t start = read & buffer->mask;
+    uint32_t first = buffer->size - start;
+    if (first > to_read) first = to_read;
+    
+    memcpy(out_samples, buffer->samples + start, first * sizeof(float));
+    memcpy(out_samples + first, buffer->samples, (to_read - first) * sizeof(float));
+    
+    GIGATRON_STORE_RELEASE(&buffer->read_pos, read + to_read);
+    
+    /* Count each time the buffer runs dry, not every short read while idle */
+    bool short_read = to_read < count;
+    if (short_read && !buffer->starved) {
+        GIGATRON_STORE_RELEASE(&buffer->underruns, buffer->underruns + 1);
     }
+    buffer->starved = short_read;
     
     return to_read;
 }
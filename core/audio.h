@@ -19,15 +19,61 @@ extern "C" {
 #define AUDIO_SAMPLE_RATE   44100
 #define AUDIO_BUFFER_SIZE   2048    /* Samples per buffer */
 #define AUDIO_NUM_BUFFERS   4       /* Number of buffers for double/triple buffering */
+#define AUDIO_CACHE_LINE    64      /* Separation of producer and consumer indices */
+#define AUDIO_MAX_EVENTS    512     /* OUTX changes buffered between updates */
+#define AUDIO_BLOCK_SIZE    256     /* Samples generated per block */
+#define AUDIO_BLEP_PHASES   32      /* Sub-sample positions of the step kernel */
+#define AUDIO_BLEP_MAX_TAPS 32
+#define AUDIO_DRC_MAX_DELTA 0.005   /* Max resampling ratio deviation (inaudible pitch shift) */
+#define AUDIO_DRC_SMOOTHING 0.1     /* Per-update weight of the latest buffer fill */
+#define AUDIO_DRC_INTEGRAL  0.005   /* Per-update integral gain, removes the steady fill offset */
+#define AUDIO_DRC_WINDUP    0.5     /* Integral share of the ratio range at most */
 
 /**
- * Audio ring buffer for samples
+ * Resampling quality: number of taps of the band-limited step kernel.
+ * POINT samples OUTX directly (aliases, cheapest).
+ */
+typedef enum audio_quality_t {
+    AUDIO_QUALITY_POINT = 0,    /* 1 tap */
+    AUDIO_QUALITY_LOW,          /* 8 taps */
+    AUDIO_QUALITY_MEDIUM,       /* 16 taps */
+    AUDIO_QUALITY_HIGH,         /* 32 taps */
+    AUDIO_QUALITY_COUNT
+} audio_quality_t;
+
+/**
+ * Callback for every block of output samples (e.g. recording).
+ * period is the emulated length of each sample in nominal sample periods,
+ * 1.0 unless rate control is stretching the output.
+ */
+typedef void (*audio_sample_cb_t)(void* user_data, const float* samples, uint32_t count, float period);
+
+/**
+ * OUTX change, recorded by the CPU hook and rendered in batches
+ */
+typedef struct audio_event_t {
+    uint64_t cycle;     /* First cycle with the new value */
+    uint8_t outx;
+} audio_event_t;
+
+/**
+ * Audio ring buffer for samples.
+ * Lock-free single producer (emulation thread) / single consumer (audio
+ * callback). Positions are free-running counters masked by size - 1, each
+ * written only by its owner with release ordering and read with acquire.
  */
 typedef struct audio_buffer_t {
     float* samples;
-    uint32_t size;
-    uint32_t write_pos;
-    uint32_t read_pos;
+    uint32_t size;          /* Power of two */
+    uint32_t mask;
+    uint8_t pad0[AUDIO_CACHE_LINE];
+    uint32_t write_pos;     /* Owned by the producer */
+    uint32_t overruns;      /* Blocks that lost samples to a full ring */
+    uint8_t pad1[AUDIO_CACHE_LINE - 2 * sizeof(uint32_t)];
+    uint32_t read_pos;      /* Owned by the consumer */
+    uint32_t underruns;     /* Reads that ran the ring dry */
+    uint32_t starved;       /* Previous read came up short */
+    uint8_t pad2[AUDIO_CACHE_LINE - 3 * sizeof(uint32_t)];
 } audio_buffer_t;
 
 /**
@@ -40,8 +86,36 @@ typedef struct audio_t {
     /* Sample rate */
     uint32_t sample_rate;
     
-    /* Cycle counter for sample timing */
+    /* Sample timing: cycles rendered so far and fractional sample phase */
+    uint64_t cycle;
     uint32_t cycle_counter;
+    uint32_t resample_hz;   /* Cycles per second of output, cpu->hz / drc_ratio */
+    
+    /*
+     * Dynamic rate control: the resampling ratio follows the buffer fill
+     * so display-paced emulation neither overflows nor drains the ring
+     */
+    bool drc_enabled;
+    uint32_t drc_target;    /* Target fill (samples) */
+    double drc_fill;        /* Smoothed fill (samples) */
+    double drc_integral;    /* Accumulated fill error, the host clock offset */
+    double drc_ratio;       /* Output samples per nominal sample */
+    
+    /* OUTX changes since the last update */
+    audio_event_t events[AUDIO_MAX_EVENTS];
+    uint32_t num_events;
+    float level;    /* Raw sample value of the current OUTX */
+    
+    /*
+     * Band-limited synthesis: each OUTX step adds a windowed-sinc impulse
+     * to the delta buffer, which is integrated into the output. Output is
+     * delayed by taps / 2 samples.
+     */
+    audio_quality_t quality;
+    uint32_t taps;
+    float kernel[AUDIO_BLEP_PHASES][AUDIO_BLEP_MAX_TAPS];
+    float deltas[AUDIO_BLOCK_SIZE + AUDIO_BLEP_MAX_TAPS];
+    float integrator;
     
     /* DC bias removal (high-pass filter) */
     float bias;
@@ -53,6 +127,10 @@ typedef struct audio_t {
     /* Mute flag */
     bool mute;
     
+    /* Sample tap, called before samples enter the ring */
+    audio_sample_cb_t sample_cb;
+    void* sample_user_data;
+    
     /* Sample buffer */
     audio_buffer_t buffer;
 } audio_t;
@@ -70,17 +148,67 @@ void audio_shutdown(audio_t* audio);
 
 /**
  * Reset audio state.
+ * Samples already in the buffer are left for the consumer, which may be
+ * reading concurrently.
  */
 void audio_reset(audio_t* audio);
 
 /**
- * Advance audio simulation by one tick.
- * Should be called once per CPU cycle.
+ * Generate samples for all cycles run since the last update.
+ * Call once per batch of CPU cycles (e.g. per frame), not per cycle:
+ * OUTX changes are recorded through the CPU's OUTX hook and the samples
+ * are produced in blocks.
+ */
+void audio_update(audio_t* audio);
+
+/**
+ * Select the resampling quality (default AUDIO_QUALITY_MEDIUM).
+ */
+void audio_set_quality(audio_t* audio, audio_quality_t quality);
+
+/**
+ * Set the output sample rate (e.g. 44100 or 48000).
+ * Returns false if the rate is out of range.
+ */
+bool audio_set_sample_rate(audio_t* audio, uint32_t sample_rate);
+
+/**
+ * Enable dynamic rate control around a target buffer fill (samples).
+ * The output rate varies by at most AUDIO_DRC_MAX_DELTA. A clamped integral
+ * term absorbs a constant clock offset, so the fill settles on the target.
  */
-void audio_tick(audio_t* audio);
+void audio_set_rate_control(audio_t* audio, bool enable, uint32_t target_samples);
+
+/**
+ * Get buffered audio latency in milliseconds.
+ */
+float audio_get_latency_ms(const audio_t* audio);
+
+/**
+ * Get number of underruns (consumer ran the buffer dry).
+ */
+uint32_t audio_get_underruns(const audio_t* audio);
+
+/**
+ * Get number of overruns (samples dropped on a full buffer).
+ */
+uint32_t audio_get_overruns(const audio_t* audio);
+
+/**
+ * Get current resampling ratio (1.0 without rate control).
+ */
+static inline double audio_get_rate_ratio(const audio_t* audio) {
+    return audio ? audio->drc_ratio : 1.0;
+}
+
+/**
+ * Get display name of a quality level.
+ */
+const char* audio_quality_name(audio_quality_t quality);
 
 /**
  * Read samples from the audio buffer.
+ * Safe to call from the audio thread while the emulation produces samples.
  * Returns the number of samples read.
  */
 uint32_t audio_read_samples(audio_t* audio, float* out_samples, uint32_t count);
@@ -113,6 +241,20 @@ static inline void audio_set_mute(audio_t* audio, bool mute) {
     }
 }
 
+/**
+ * Register a callback for every block of samples, NULL to remove it.
+ * Samples are passed after DC removal but before volume and mute, and
+ * regardless of whether they fit in the ring. They follow the rate
+ * control ratio, which the period argument reports so that a recording
+ * can resample them back to the nominal rate.
+ */
+static inline void audio_set_sample_callback(audio_t* audio, audio_sample_cb_t cb, void* user_data) {
+    if (audio) {
+        audio->sample_cb = cb;
+        audio->sample_user_data = user_data;
+    }
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,256 @@
+/**
+ * Gigatron Disassembler
+ */
+
+#include "disasm.h"
+#include "vcpu_profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char* const disasm_alu_ops[6] = { "ld", "anda", "ora", "xora", "adda", "suba" };
+static const char* const disasm_branches[8] = { "jmp", "bgt", "blt", "bne", "beq", "bge", "ble", "bra" };
+
+/* Register loaded by modes 4-7 (AC for modes 0-3) */
+static const char* const disasm_dest[8] = { "", "", "", "", ",x", ",y", ",out", ",out" };
+
+/**
+ * vCPU operand kinds
+ */
+typedef enum disasm_operand_t {
+    DISASM_OPERAND_NONE = 0,    /* Opcode only */
+    DISASM_OPERAND_BYTE,        /* Zero page address or immediate */
+    DISASM_OPERAND_WORD,        /* 16-bit immediate or address */
+    DISASM_OPERAND_BRANCH,      /* Target in the page, fetched at operand + 2 */
+    DISASM_OPERAND_CONDITION    /* BCC: condition, then target as for BRANCH */
+} disasm_operand_t;
+
+/* vCPU operands by opcode (ROM v5a), names come from vcpu_opcode_name */
+static const struct {
+    uint8_t op;
+    disasm_operand_t operand;
+} disasm_vcpu_ops[] = {
+    { 0x11, DISASM_OPERAND_WORD },   { 0x1A, DISASM_OPERAND_BYTE },   { 0x1F, DISASM_OPERAND_BYTE },
+    { 0x21, DISASM_OPERAND_BYTE },   { 0x2B, DISASM_OPERAND_BYTE },   { 0x35, DISASM_OPERAND_CONDITION },
+    { 0x59, DISASM_OPERAND_BYTE },   { 0x5E, DISASM_OPERAND_BYTE },   { 0x63, DISASM_OPERAND_NONE },
+    { 0x75, DISASM_OPERAND_NONE },   { 0x7F, DISASM_OPERAND_BYTE },   { 0x82, DISASM_OPERAND_BYTE },
+    { 0x85, DISASM_OPERAND_WORD },   { 0x88, DISASM_OPERAND_BYTE },   { 0x8C, DISASM_OPERAND_BYTE },
+    { 0x90, DISASM_OPERAND_BRANCH }, { 0x93, DISASM_OPERAND_BYTE },   { 0x97, DISASM_OPERAND_BYTE },
+    { 0x99, DISASM_OPERAND_BYTE },   { 0xAD, DISASM_OPERAND_NONE },   { 0xB4, DISASM_OPERAND_BYTE },
+    { 0xB8, DISASM_OPERAND_BYTE },   { 0xCD, DISASM_OPERAND_BRANCH }, { 0xCF, DISASM_OPERAND_BYTE },
+    { 0xDF, DISASM_OPERAND_BYTE },   { 0xE3, DISASM_OPERAND_BYTE },   { 0xE6, DISASM_OPERAND_BYTE },
+    { 0xE9, DISASM_OPERAND_NONE },   { 0xEC, DISASM_OPERAND_BYTE },   { 0xEE, DISASM_OPERAND_BYTE },
+    { 0xF0, DISASM_OPERAND_BYTE },   { 0xF3, DISASM_OPERAND_BYTE },   { 0xF6, DISASM_OPERAND_NONE },
+    { 0xF8, DISASM_OPERAND_BYTE },   { 0xFA, DISASM_OPERAND_BYTE },   { 0xFC, DISASM_OPERAND_BYTE },
+    { 0xFF, DISASM_OPERAND_NONE }
+};
+
+/* BCC conditions: the interpreter jumps into its branch table at the condition byte */
+static const struct {
+    uint8_t cond;
+    const char* name;
+} disasm_vcpu_conditions[] = {
+    { 0x3F, "BEQ" }, { 0x4D, "BGT" }, { 0x50, "BLT" },
+    { 0x53, "BGE" }, { 0x56, "BLE" }, { 0x72, "BNE" }
+};
+
+/**
+ * Format the RAM operand of a mode
+ */
+static void disasm_address(uint8_t mode, uint8_t d, char* buf, size_t size) {
+    switch (mode) {
+        case 1:  snprintf(buf, size, "[x]");          break;
+        case 2:  snprintf(buf, size, "[y,$%02x]", d); break;
+        case 3:  snprintf(buf, size, "[y,x]");        break;
+        case 7:  snprintf(buf, size, "[y,x++]");      break;
+        default: snprintf(buf, size, "[$%02x]", d);   break;
+    }
+}
+
+/**
+ * Disassemble a native instruction word
+ */
+size_t disasm_native(uint16_t ir, char* buf, size_t size) {
+    if (!buf || size == 0) return 0;
+    
+    uint8_t op = (ir >> 13) & 0x07;
+    uint8_t mode = (ir >> 10) & 0x07;
+    uint8_t bus = (ir >> 8) & 0x03;
+    uint8_t d = ir & 0xFF;
+    
+    char addr[12];
+    char source[12];
+    int n;
+    
+    if (op == 7) {
+        /* Branch: operand is the target low byte */
+        switch (bus) {
+            case 0:  snprintf(source, sizeof(source), "$%02x", d);   break;
+            case 1:  snprintf(source, sizeof(source), "[$%02x]", d); break;
+            case 2:  snprintf(source, sizeof(source), "ac");         break;
+            default: snprintf(source, sizeof(source), "in");         break;
+        }
+        n = snprintf(buf, size, mode == 0 ? "%s y,%s" : "%s %s", disasm_branches[mode], source);
+    } else if (op == 6) {
+        /* Store: AC by default, D or IN spelled out; modes 4 and 5 also load X or Y */
+        disasm_address(mode, d, addr, sizeof(addr));
+        const char* dest = (mode == 4 || mode == 5) ? disasm_dest[mode] : "";
+        switch (bus) {
+            case 0:  n = snprintf(buf, size, "st $%02x,%s%s", d, addr, dest); break;
+            case 1:  n = snprintf(buf, size, "st ?,%s%s", addr, dest);         break;
+            case 2:  n = snprintf(buf, size, "st %s%s", addr, dest);           break;
+            default: n = snprintf(buf, size, "st in,%s%s", addr, dest);        break;
+        }
+    } else {
+        switch (bus) {
+            case 0:  snprintf(source, sizeof(source), "$%02x", d); break;
+            case 1:  disasm_address(mode, d, source, sizeof(source)); break;
+            case 2:  snprintf(source, sizeof(source), "ac"); break;
+            default: snprintf(source, sizeof(source), "in"); break;
+        }
+        n = snprintf(buf, size, "%s %s%s", disasm_alu_ops[op], source, disasm_dest[mode]);
+    }
+    
+    if (n < 0) {
+        buf[0] = '\0';
+        return 0;
+    }
+    return (size_t)n < size ? (size_t)n : size - 1;
+}
+
+/**
+ * Disassemble a vCPU instruction
+ */
+uint8_t disasm_vcpu(const uint8_t* ram, uint32_t ram_mask, uint16_t addr, char* buf, size_t size) {
+    if (!ram || !buf || size == 0) return 1;
+    
+    uint8_t op = ram[addr & ram_mask];
+    uint8_t b1 = ram[disasm_vcpu_next(addr, 1) & ram_mask];
+    uint8_t b2 = ram[disasm_vcpu_next(addr, 2) & ram_mask];
+    const char* name = vcpu_opcode_name(op);
+    
+    disasm_operand_t operand = DISASM_OPERAND_NONE;
+    for (size_t i = 0; name && i < sizeof(disasm_vcpu_ops) / sizeof(disasm_vcpu_ops[0]); i++) {
+        if (disasm_vcpu_ops[i].op == op) operand = disasm_vcpu_ops[i].operand;
+    }
+    if (!name) {
+        snprintf(buf, size, "db $%02x", op);
+        return 1;
+    }
+    
+    switch (operand) {
+        case DISASM_OPERAND_BYTE:
+            snprintf(buf, size, "%s $%02x", name, b1);
+            return 2;
+        case DISASM_OPERAND_WORD:
+            snprintf(buf, size, "%s $%04x", name, b1 | (b2 << 8));
+            return 3;
+        case DISASM_OPERAND_BRANCH:
+            snprintf(buf, size, "%s $%04x", name, disasm_vcpu_next(addr & 0xFF00, (uint8_t)(b1 + 2)));
+            return 2;
+        case DISASM_OPERAND_CONDITION: {
+            uint16_t target = disasm_vcpu_next(addr & 0xFF00, (uint8_t)(b2 + 2));
+            for (size_t i = 0; i < sizeof(disasm_vcpu_conditions) / sizeof(disasm_vcpu_conditions[0]); i++) {
+                if (disasm_vcpu_conditions[i].cond == b1) {
+                    snprintf(buf, size, "%s $%04x", disasm_vcpu_conditions[i].name, target);
+                    return 3;
+                }
+            }
+            snprintf(buf, size, "%s $%02x,$%04x", name, b1, target);
+            return 3;
+        }
+        default:
+            snprintf(buf, size, "%s", name);
+            return 1;
+    }
+}
+
+/**
+ * Initialize a cache
+ */
+bool disasm_cache_init(disasm_cache_t* cache, uint32_t rom_size, uint32_t ram_size) {
+    if (!cache || rom_size == 0 || ram_size < DISASM_PAGE_SIZE) return false;
+    
+    memset(cache, 0, sizeof(disasm_cache_t));
+    cache->native = (disasm_line_t*)calloc(rom_size, sizeof(disasm_line_t));
+    cache->vcpu = (disasm_line_t*)calloc(ram_size, sizeof(disasm_line_t));
+    cache->ram = (uint8_t*)calloc(ram_size, 1);
+    if (!cache->native || !cache->vcpu || !cache->ram) {
+        disasm_cache_shutdown(cache);
+        return false;
+    }
+    cache->rom_size = rom_size;
+    cache->ram_size = ram_size;
+    
+    return true;
+}
+
+/**
+ * Free the cache
+ */
+void disasm_cache_shutdown(disasm_cache_t* cache) {
+    if (!cache) return;
+    
+    free(cache->native);
+    free(cache->vcpu);
+    free(cache->ram);
+    memset(cache, 0, sizeof(disasm_cache_t));
+}
+
+/**
+ * Drop all native lines
+ */
+void disasm_cache_invalidate_rom(disasm_cache_t* cache) {
+    if (!cache || !cache->native) return;
+    
+    memset(cache->native, 0, cache->rom_size * sizeof(disasm_line_t));
+}
+
+/**
+ * Drop the vCPU lines of pages that changed
+ */
+uint32_t disasm_cache_sync_ram(disasm_cache_t* cache, const uint8_t* ram) {
+    if (!cache || !cache->ram || !ram) return 0;
+    
+    uint32_t dropped = 0;
+    for (uint32_t page = 0; page < cache->ram_size; page += DISASM_PAGE_SIZE) {
+        if (memcmp(cache->ram + page, ram + page, DISASM_PAGE_SIZE) == 0) continue;
+        
+        memcpy(cache->ram + page, ram + page, DISASM_PAGE_SIZE);
+        for (uint32_t i = 0; i < DISASM_PAGE_SIZE; i++) {
+            cache->vcpu[page + i].length = 0;
+        }
+        dropped++;
+    }
+    return dropped;
+}
+
+/**
+ * Get a native line
+ */
+const char* disasm_cache_native(disasm_cache_t* cache, const uint16_t* rom, uint16_t addr) {
+    if (!cache || !cache->native || !rom || addr >= cache->rom_size) return "";
+    
+    disasm_line_t* line = &cache->native[addr];
+    if (!line->length) {
+        disasm_native(rom[addr], line->text, sizeof(line->text));
+        line->length = 1;
+        cache->decoded++;
+    }
+    return line->text;
+}
+
+/**
+ * Get a vCPU line
+ */
+const disasm_line_t* disasm_cache_vcpu(disasm_cache_t* cache, uint16_t addr) {
+    if (!cache || !cache->vcpu) return NULL;
+    
+    addr &= (uint16_t)(cache->ram_size - 1);
+    disasm_line_t* line = &cache->vcpu[addr];
+    if (!line->length) {
+        line->length = disasm_vcpu(cache->ram, cache->ram_size - 1, addr, line->text, sizeof(line->text));
+        cache->decoded++;
+    }
+    return line;
+}
@@ -0,0 +1,105 @@
+/**
+ * Gigatron Disassembler
+ * 
+ * Native instruction words in the syntax of the ROM assembler
+ * (ld, anda, ora, xora, adda, suba, st, jmp/bcc), and vCPU bytecode with
+ * the interpreter's mnemonics (LDWI, LDW, BEQ, CALL...).
+ *
+ * A cache keeps the decoded text per address so views can redraw every
+ * frame without decoding again. Native lines stay valid until the ROM is
+ * replaced. vCPU lines are decoded from a copy of RAM that is compared page
+ * by page on each sync, so a write to a page invalidates only that page.
+ */
+
+#ifndef GIGATRON_DISASM_H
+#define GIGATRON_DISASM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DISASM_MAX_TEXT     24      /* Longest instruction text including NUL */
+#define DISASM_PAGE_SIZE    256     /* vCPU code and its operands stay within a page */
+
+/**
+ * Decoded instruction
+ */
+typedef struct disasm_line_t {
+    char text[DISASM_MAX_TEXT];
+    uint8_t length;         /* Bytes (vCPU) or words (native), 0 if not decoded */
+} disasm_line_t;
+
+/**
+ * Disassembly cache
+ */
+typedef struct disasm_cache_t {
+    disasm_line_t* native;  /* Per ROM address */
+    uint32_t rom_size;
+    disasm_line_t* vcpu;    /* Per RAM address */
+    uint8_t* ram;           /* RAM the vCPU lines were decoded from */
+    uint32_t ram_size;
+    uint64_t decoded;       /* Lines decoded since init (cache misses) */
+} disasm_cache_t;
+
+/**
+ * Disassemble a native instruction word into buf.
+ * Returns the length of the text (truncated to size - 1).
+ */
+size_t disasm_native(uint16_t ir, char* buf, size_t size);
+
+/**
+ * Disassemble the vCPU instruction at addr into buf. Operands wrap within
+ * the page like the interpreter's vPC. Unknown opcodes are shown as data.
+ * Returns the length of the instruction in bytes (1 to 3).
+ */
+uint8_t disasm_vcpu(const uint8_t* ram, uint32_t ram_mask, uint16_t addr, char* buf, size_t size);
+
+/**
+ * Get the address of the vCPU instruction after one of `length` bytes at addr.
+ */
+static inline uint16_t disasm_vcpu_next(uint16_t addr, uint8_t length) {
+    return (uint16_t)((addr & 0xFF00) | ((addr + length) & 0xFF));
+}
+
+/**
+ * Initialize a cache for a ROM of rom_size words and ram_size bytes of RAM.
+ * Returns true on success, false on failure.
+ */
+bool disasm_cache_init(disasm_cache_t* cache, uint32_t rom_size, uint32_t ram_size);
+
+/**
+ * Free the cache.
+ */
+void disasm_cache_shutdown(disasm_cache_t* cache);
+
+/**
+ * Drop all native lines (after loading a ROM).
+ */
+void disasm_cache_invalidate_rom(disasm_cache_t* cache);
+
+/**
+ * Compare RAM with the copy the vCPU lines were decoded from and drop the
+ * lines of each page that changed. Returns the number of pages dropped.
+ */
+uint32_t disasm_cache_sync_ram(disasm_cache_t* cache, const uint8_t* ram);
+
+/**
+ * Get the native instruction text at a ROM address, decoding it on a miss.
+ */
+const char* disasm_cache_native(disasm_cache_t* cache, const uint16_t* rom, uint16_t addr);
+
+/**
+ * Get the vCPU instruction at a RAM address, decoding it on a miss.
+ * Reflects RAM as of the last disasm_cache_sync_ram.
+ */
+const disasm_line_t* disasm_cache_vcpu(disasm_cache_t* cache, uint16_t addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GIGATRON_DISASM_H */
@@ -5,53 +5,12 @@
  */
 
 #include "gigatron.h"
+#include "gigatron_exec.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
 
-/* Instruction field extraction macros */
-#define INST_OP(ir)     (((ir) >> 13) & 0x07)
-#define INST_MODE(ir)   (((ir) >> 10) & 0x07)
-#define INST_BUS(ir)    (((ir) >> 8) & 0x03)
-#define INST_D(ir)      ((ir) & 0xFF)
-
-/* Opcodes */
-#define OP_LD   0
-#define OP_AND  1
-#define OP_OR   2
-#define OP_XOR  3
-#define OP_ADD  4
-#define OP_SUB  5
-#define OP_ST   6
-#define OP_BR   7
-
-/* Bus sources */
-#define BUS_D   0
-#define BUS_RAM 1
-#define BUS_AC  2
-#define BUS_IN  3
-
-/* Address modes (for RAM access) */
-#define MODE_D      0
-#define MODE_X      1
-#define MODE_YD     2
-#define MODE_YX     3
-#define MODE_D_X    4   /* Also writes to X */
-#define MODE_D_Y    5   /* Also writes to Y */
-#define MODE_D_OUT  6   /* Also writes to OUT */
-#define MODE_YX_INC 7   /* Y,X with X++ */
-
-/* Branch conditions */
-#define BR_JMP  0       /* Jump (uses Y register for high byte) */
-#define BR_GT   1       /* Branch if AC > 0 */
-#define BR_LT   2       /* Branch if AC < 0 */
-#define BR_NE   3       /* Branch if AC != 0 */
-#define BR_EQ   4       /* Branch if AC == 0 */
-#define BR_GE   5       /* Branch if AC >= 0 */
-#define BR_LE   6       /* Branch if AC <= 0 */
-#define BR_BRA  7       /* Branch always (within page) */
-
 /**
  * Get default configuration
  */
@@ -144,216 +103,10 @@ void gigatron_reset(gigatron_t* cpu) {
     cpu->outx = 0;
     cpu->in_reg = 0xFF;     /* Active low - all buttons released */
     cpu->cycles = 0;
-}
-
-/**
- * Calculate RAM address based on mode
- */
-static inline uint16_t calc_addr(gigatron_t* cpu, uint8_t mode, uint8_t d) {
-    switch (mode) {
-        case MODE_D:
-        case MODE_D_X:
-        case MODE_D_Y:
-        case MODE_D_OUT:
-            return d;
-        case MODE_X:
-            return cpu->x;
-        case MODE_YD:
-            return ((uint16_t)cpu->y << 8) | d;
-        case MODE_YX:
-            return ((uint16_t)cpu->y << 8) | cpu->x;
-        case MODE_YX_INC: {
-            uint16_t addr = ((uint16_t)cpu->y << 8) | cpu->x;
-            cpu->x = (cpu->x + 1) & 0xFF;
-            return addr;
-        }
-        default:
-            return d;
-    }
-}
-
-/**
- * Calculate branch offset based on bus source
- */
-static inline uint8_t calc_offset(gigatron_t* cpu, uint8_t bus, uint8_t d) {
-    switch (bus) {
-        case BUS_D:
-            return d;
-        case BUS_RAM:
-            /* RAM always has at least 1 page, so no need to mask address for offset */
-            return cpu->ram[d & cpu->ram_mask];
-        case BUS_AC:
-            return cpu->ac;
-        case BUS_IN:
-            return cpu->in_reg;
-        default:
-            return d;
-    }
-}
-
-/**
- * Execute ALU operation (OP 0-5)
- */
-static void exec_alu_op(gigatron_t* cpu, uint8_t op, uint8_t mode, uint8_t bus, uint8_t d) {
-    uint8_t b;
-    
-    /* Get bus value */
-    switch (bus) {
-        case BUS_D:
-            b = d;
-            break;
-        case BUS_RAM: {
-            uint16_t addr = calc_addr(cpu, mode, d) & cpu->ram_mask;
-            b = cpu->ram[addr];
-            break;
-        }
-        case BUS_AC:
-            b = cpu->ac;
-            break;
-        case BUS_IN:
-            b = cpu->in_reg;
-            break;
-        default:
-            b = d;
-            break;
-    }
     
-    /* Perform ALU operation */
-    switch (op) {
-        case OP_LD:
-            /* b = b (no operation) */
-            break;
-        case OP_AND:
-            b = cpu->ac & b;
-            break;
-        case OP_OR:
-            b = cpu->ac | b;
-            break;
-        case OP_XOR:
-            b = cpu->ac ^ b;
-            break;
-        case OP_ADD:
-            b = (cpu->ac + b) & 0xFF;
-            break;
-        case OP_SUB:
-            b = (cpu->ac - b) & 0xFF;
-            break;
-    }
-    
-    /* Write result to destination */
-    switch (mode) {
-        case MODE_D:
-        case MODE_X:
-        case MODE_YD:
-        case MODE_YX:
-            cpu->ac = b;
-            break;
-        case MODE_D_X:
-            cpu->x = b;
-            break;
-        case MODE_D_Y:
-            cpu->y = b;
-            break;
-        case MODE_D_OUT:
-        case MODE_YX_INC: {
-            uint8_t rising = ~cpu->out & b;
-            cpu->out = b;
-            
-            /* Rising edge of out[6] latches AC into OUTX */
-            if (rising & 0x40) {
-                cpu->outx = cpu->ac;
-            }
-            break;
-        }
-    }
-}
-
-/**
- * Execute store operation (OP 6)
- */
-static void exec_store_op(gigatron_t* cpu, uint8_t mode, uint8_t bus, uint8_t d) {
-    uint8_t b;
-    
-    /* Get value to store */
-    switch (bus) {
-        case BUS_D:
-            b = d;
-            break;
-        case BUS_RAM:
-            /* Undefined behavior in original - we use 0 */
-            b = 0;
-            break;
-        case BUS_AC:
-            b = cpu->ac;
-            break;
-        case BUS_IN:
-            b = cpu->in_reg;
-            break;
-        default:
-            b = d;
-            break;
-    }
-    
-    /* Calculate address and store */
-    uint16_t addr = calc_addr(cpu, mode, d) & cpu->ram_mask;
-    cpu->ram[addr] = b;
-    
-    /* Some modes also write to a register */
-    switch (mode) {
-        case MODE_D_X:
-            cpu->x = b;
-            break;
-        case MODE_D_Y:
-            cpu->y = b;
-            break;
-    }
-}
-
-/**
- * Execute branch operation (OP 7)
- */
-static void exec_branch_op(gigatron_t* cpu, uint8_t mode, uint8_t bus, uint8_t d) {
-    const uint8_t ZERO = 0x80;
-    bool condition;
-    uint8_t ac = cpu->ac ^ ZERO;    /* Convert to signed comparison */
-    uint16_t base = cpu->pc & 0xFF00;
-    
-    /* Evaluate branch condition */
-    switch (mode) {
-        case BR_JMP:
-            condition = true;
-            base = (uint16_t)cpu->y << 8;
-            break;
-        case BR_GT:
-            condition = (ac > ZERO);
-            break;
-        case BR_LT:
-            condition = (ac < ZERO);
-            break;
-        case BR_NE:
-            condition = (ac != ZERO);
-            break;
-        case BR_EQ:
-            condition = (ac == ZERO);
-            break;
-        case BR_GE:
-            condition = (ac >= ZERO);
-            break;
-        case BR_LE:
-            condition = (ac <= ZERO);
-            break;
-        case BR_BRA:
-            condition = true;
-            break;
-        default:
-            condition = false;
-            break;
-    }
-    
-    /* Take branch if condition is true */
-    if (condition) {
-        uint8_t offset = calc_offset(cpu, bus, d);
-        cpu->next_pc = base | offset;
+    /* Let the OUTX listener restart its timing */
+    if (cpu->outx_cb) {
+        cpu->outx_cb(cpu->outx_user_data, 0, 0);
     }
 }
 
@@ -363,46 +116,17 @@ static void exec_branch_op(gigatron_t* cpu, uint8_t mode, uint8_t bus, uint8_t d
 void gigatron_tick(gigatron_t* cpu) {
     if (!cpu || !cpu->rom) return;
     
-    /* Fetch instruction */
-    uint16_t pc = cpu->pc;
-    cpu->pc = cpu->next_pc;
-    cpu->next_pc = (cpu->pc + 1) & cpu->rom_mask;
-    
-    uint16_t ir = cpu->rom[pc];
-    
-    /* Decode instruction */
-    uint8_t op = INST_OP(ir);
-    uint8_t mode = INST_MODE(ir);
-    uint8_t bus = INST_BUS(ir);
-    uint8_t d = INST_D(ir);
-    
-    /* Execute instruction */
-    switch (op) {
-        case OP_LD:
-        case OP_AND:
-        case OP_OR:
-        case OP_XOR:
-        case OP_ADD:
-        case OP_SUB:
-            exec_alu_op(cpu, op, mode, bus, d);
-            break;
-        case OP_ST:
-            exec_store_op(cpu, mode, bus, d);
-            break;
-        case OP_BR:
-            exec_branch_op(cpu, mode, bus, d);
-            break;
-    }
-    
-    cpu->cycles++;
+    gigatron_exec(cpu);
 }
 
 /**
  * Run multiple cycles
  */
 void gigatron_run(gigatron_t* cpu, uint32_t cycles) {
+    if (!cpu || !cpu->rom) return;
+    
     for (uint32_t i = 0; i < cycles; i++) {
-        gigatron_tick(cpu);
+        gigatron_exec(cpu);
     }
 }
 
@@ -21,6 +21,11 @@ extern "C" {
 #define GIGATRON_ROM_SIZE       (1 << 16)   /* 64K x 16-bit ROM */
 #define GIGATRON_RAM_SIZE       (1 << 15)   /* 32K x 8-bit RAM */
 
+/* Video timing generated by the ROM */
+#define GIGATRON_CYCLES_PER_LINE    200     /* 31.25 kHz at 6.25 MHz */
+#define GIGATRON_LINES_PER_FRAME    521     /* ~59.98 Hz at 6.25 MHz */
+#define GIGATRON_CYCLES_PER_FRAME   (GIGATRON_CYCLES_PER_LINE * GIGATRON_LINES_PER_FRAME)
+
 /* OUT register bit definitions */
 #define GIGATRON_OUT_HSYNC      0x40        /* Horizontal sync (active low) */
 #define GIGATRON_OUT_VSYNC      0x80        /* Vertical sync (active low) */
@@ -35,6 +40,14 @@ extern "C" {
 #define GIGATRON_BTN_B          0x40
 #define GIGATRON_BTN_A          0x80
 
+/**
+ * OUTX change callback.
+ * Called when an HSYNC rising edge latches a new value into OUTX; `cycle`
+ * is the first cycle count at which the new value is visible.
+ * gigatron_reset reports OUTX = 0 at cycle 0.
+ */
+typedef void (*gigatron_outx_cb_t)(void* user_data, uint64_t cycle, uint8_t outx);
+
 /**
  * Gigatron CPU state
  */
@@ -64,6 +77,10 @@ typedef struct gigatron_t {
     
     /* Cycle counter for timing */
     uint64_t cycles;
+    
+    /* OUTX change hook (NULL if unused) */
+    gigatron_outx_cb_t outx_cb;
+    void* outx_user_data;
 } gigatron_t;
 
 /**
@@ -135,6 +152,15 @@ static inline uint8_t gigatron_get_output(gigatron_t* cpu) {
     return cpu->out;
 }
 
+/**
+ * Register a callback for OUTX changes, NULL to remove it.
+ * Only invoked from the OUTX latch path, never per cycle.
+ */
+static inline void gigatron_set_outx_callback(gigatron_t* cpu, gigatron_outx_cb_t cb, void* user_data) {
+    cpu->outx_cb = cb;
+    cpu->outx_user_data = user_data;
+}
+
 /**
  * Get extended output register value (audio)
  */
@@ -0,0 +1,55 @@
+/**
+ * Gigatron Ring Position Atomics
+ *
+ * Internal to the core: acquire loads and release stores of the 32-bit
+ * positions shared by the single producer / single consumer rings (audio
+ * buffer, trace and recorder writer threads). Not part of the API.
+ */
+
+#ifndef GIGATRON_ATOMIC_H
+#define GIGATRON_ATOMIC_H
+
+#include <stdint.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+
+/*
+ * MSVC has no C11 atomics here. A volatile access plus a compiler barrier
+ * is acquire/release on x86 and x64; ARM needs a data memory barrier.
+ * Plain loads, unlike an interlocked read-modify-write, leave the
+ * producer's cache line shared.
+ */
+#if defined(_M_ARM64)
+#define GIGATRON_ATOMIC_FENCE() __dmb(_ARM64_BARRIER_ISH)
+#elif defined(_M_ARM)
+#define GIGATRON_ATOMIC_FENCE() __dmb(_ARM_BARRIER_ISH)
+#else
+#define GIGATRON_ATOMIC_FENCE() _ReadWriteBarrier()
+#endif
+
+/**
+ * Load a position, later accesses stay after it
+ */
+static __forceinline uint32_t gigatron_load_acquire(const volatile uint32_t* p) {
+    uint32_t value = (uint32_t)__iso_volatile_load32((const volatile __int32*)p);
+    GIGATRON_ATOMIC_FENCE();
+    return value;
+}
+
+/**
+ * Store a position, earlier accesses stay before it
+ */
+static __forceinline void gigatron_store_release(volatile uint32_t* p, uint32_t value) {
+    GIGATRON_ATOMIC_FENCE();
+    __iso_volatile_store32((volatile __int32*)p, (__int32)value);
+}
+
+#define GIGATRON_LOAD_ACQUIRE(p)        gigatron_load_acquire(p)
+#define GIGATRON_STORE_RELEASE(p, v)    gigatron_store_release((p), (v))
+#else
+#define GIGATRON_LOAD_ACQUIRE(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define GIGATRON_STORE_RELEASE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+#endif /* GIGATRON_ATOMIC_H */
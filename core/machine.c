@@ -0,0 +1,553 @@
+/**
+ * Gigatron Machine Run Loop
+ */
+
+#include "machine.h"
+#include "gigatron_exec.h"
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Initialize a machine
+ */
+void machine_init(machine_t* machine, gigatron_t* cpu, vga_t* vga, loader_t* loader) {
+    if (!machine) return;
+    
+    memset(machine, 0, sizeof(machine_t));
+    machine->cpu = cpu;
+    machine->vga = vga;
+    machine->loader = loader;
+    machine->input = 0xFF;
+    machine->last_break = -1;
+}
+
+/**
+ * Set the controller input
+ */
+void machine_set_input(machine_t* machine, uint8_t input) {
+    if (!machine || !machine->cpu) return;
+    
+    machine->input = input;
+    if (!loader_is_active(machine->loader)) {
+        machine->cpu->in_reg = input;
+    }
+}
+
+/**
+ * Get the value of a register
+ */
+static uint8_t machine_reg_value(const gigatron_t* cpu, machine_reg_t reg) {
+    switch (reg) {
+        case MACHINE_REG_AC:   return cpu->ac;
+        case MACHINE_REG_X:    return cpu->x;
+        case MACHINE_REG_Y:    return cpu->y;
+        case MACHINE_REG_OUT:  return cpu->out;
+        case MACHINE_REG_OUTX: return cpu->outx;
+        case MACHINE_REG_IN:   return cpu->in_reg;
+        default:               return 0;
+    }
+}
+
+/**
+ * Get the set of register conditions that currently hold (bit per breakpoint)
+ */
+static uint32_t machine_reg_state(const machine_t* machine) {
+    uint32_t state = 0;
+    for (uint32_t i = 0; i < machine->num_breakpoints; i++) {
+        const machine_breakpoint_t* bp = &machine->breakpoints[i];
+        if (bp->type == MACHINE_BP_REGISTER &&
+            (machine_reg_value(machine->cpu, bp->reg) & bp->mask) == bp->value) {
+            state |= 1u << i;
+        }
+    }
+    return state;
+}
+
+/**
+ * Check the enabled breakpoints after an instruction.
+ * Register conditions trigger when they become true, so a run started on
+ * a condition that holds continues past it.
+ */
+static bool machine_check_breakpoints(machine_t* machine, const gigatron_access_t* access,
+                                      uint32_t* reg_state) {
+    const gigatron_t* cpu = machine->cpu;
+    bool triggered = false;
+    
+    for (uint32_t i = 0; i < machine->num_breakpoints; i++) {
+        machine_breakpoint_t* bp = &machine->breakpoints[i];
+        bool hit = false;
+        
+        switch (bp->type) {
+            case MACHINE_BP_PC:
+                hit = cpu->pc == bp->addr;
+                break;
+            case MACHINE_BP_READ:
+                hit = (access->kind & GIGATRON_ACCESS_READ) &&
+                      access->read_addr == (bp->addr & cpu->ram_mask);
+                break;
+            case MACHINE_BP_WRITE:
+                hit = (access->kind & GIGATRON_ACCESS_WRITE) &&
+                      access->write_addr == (bp->addr & cpu->ram_mask);
+                break;
+            case MACHINE_BP_REGISTER: {
+                uint32_t bit = 1u << i;
+                bool holds = (machine_reg_value(cpu, bp->reg) & bp->mask) == bp->value;
+                hit = holds && !(*reg_state & bit);
+                *reg_state = holds ? (*reg_state | bit) : (*reg_state & ~bit);
+                break;
+            }
+            default:
+                break;
+        }
+        
+        if (hit && bp->enabled) {
+            bp->hits++;
+            if (!triggered) {
+                machine->last_break = (int32_t)i;
+                triggered = true;
+            }
+        }
+    }
+    
+    return triggered;
+}
+
+/**
+ * Complete a trace record with the state after the instruction and append it
+ */
+static GIGATRON_FORCE_INLINE void machine_trace(trace_writer_t* tracer, const gigatron_t* cpu,
+                                                const gigatron_access_t* access, trace_record_t* record) {
+    record->ac = cpu->ac;
+    record->x = cpu->x;
+    record->y = cpu->y;
+    record->out = cpu->out;
+    record->outx = cpu->outx;
+    if (access->kind & GIGATRON_ACCESS_WRITE) {
+        record->flags = TRACE_RECORD_WRITE;
+        record->write_addr = access->write_addr;
+        record->write_value = cpu->ram[access->write_addr];
+    } else {
+        record->flags = 0;
+        record->write_addr = 0;
+        record->write_value = 0;
+    }
+    trace_writer_put(tracer, record);
+}
+
+/* Instrumentation compiled into a run loop variant */
+#define MACHINE_INSTR_DEBUG     0x1     /* Breakpoints */
+#define MACHINE_INSTR_PROFILE   0x2     /* ROM profiler */
+#define MACHINE_INSTR_VCPU      0x4     /* vCPU profiler */
+#define MACHINE_INSTR_TRACE     0x8     /* Execution trace */
+#define MACHINE_INSTR_TIMING    0x10    /* Host time per device */
+#define MACHINE_INSTR_ACCESS    0x20    /* RAM access counters */
+#define MACHINE_INSTR_ALL       0x3F
+
+/**
+ * Count the RAM accesses of one instruction
+ */
+static GIGATRON_FORCE_INLINE void machine_count_access(access_map_t* map, const gigatron_access_t* access) {
+    if (access->kind & GIGATRON_ACCESS_READ) {
+        map->reads[access->read_addr]++;
+    }
+    if (access->kind & GIGATRON_ACCESS_WRITE) {
+        map->writes[access->write_addr]++;
+    }
+}
+
+/**
+ * Account one sampled cycle: t0 before the CPU, t1 before VGA, t2 before
+ * the loader. An idle loader stage measures the cost of the counter reads.
+ */
+static GIGATRON_FORCE_INLINE void machine_perf_sample(perf_t* perf, uint64_t t0, uint64_t t1, uint64_t t2,
+                                                      bool loading) {
+    uint64_t t3 = perf_ticks();
+    perf->sample_ticks[PERF_CPU] += t1 - t0;
+    perf->sample_ticks[PERF_VGA] += t2 - t1;
+    if (loading) {
+        perf->sample_ticks[PERF_LOADER] += t3 - t2;
+    } else {
+        perf->empty_ticks += t3 - t2;
+        perf->empty_samples++;
+    }
+    perf->samples++;
+}
+
+/**
+ * Tick the active loader. On the cycle it finishes the controller input
+ * takes over in_reg again, so input timing matches applying it every cycle.
+ */
+static GIGATRON_FORCE_INLINE void machine_tick_loader(machine_t* machine) {
+    loader_tick(machine->loader);
+    if (!loader_is_active(machine->loader)) {
+        machine->cpu->in_reg = machine->input;
+    }
+}
+
+/**
+ * Run loop template: `flags` and `instr` are constants in the fast
+ * instantiations, so the checks for absent conditions and unused
+ * instrumentation are compiled out
+ */
+static GIGATRON_FORCE_INLINE uint32_t machine_loop(machine_t* machine, const machine_until_t* until,
+                                                  const uint32_t flags, const uint32_t instr) {
+    gigatron_t* cpu = machine->cpu;
+    vga_t* vga = machine->vga;
+    loader_t* loader = machine->loader;
+    const bool debug = (instr & MACHINE_INSTR_DEBUG) != 0;
+    const bool profile = (instr & MACHINE_INSTR_PROFILE) != 0;
+    const bool vprofile = (instr & MACHINE_INSTR_VCPU) != 0;
+    const bool trace = (instr & MACHINE_INSTR_TRACE) != 0;
+    const bool timed = (instr & MACHINE_INSTR_TIMING) != 0;
+    const bool counted = (instr & MACHINE_INSTR_ACCESS) != 0;
+    uint64_t* counts = profile ? machine->profiler->counts : NULL;
+    vcpu_profiler_t* vcpu = vprofile ? machine->vcpu_profiler : NULL;
+    trace_writer_t* tracer = trace ? machine->tracer : NULL;
+    perf_t* perf = timed ? machine->perf : NULL;
+    access_map_t* map = counted ? machine->access_map : NULL;
+    
+    const uint64_t end = cpu->cycles + until->cycles;
+    const uint16_t stop_pc = until->pc;
+    const uint8_t* watch = cpu->ram + (until->ram_addr & cpu->ram_mask);
+    const uint8_t watch_value = *watch;
+    const uint8_t outx = cpu->outx;
+    uint8_t prev_out = cpu->out;
+    
+    gigatron_access_t access = { 0, 0, 0 };
+    trace_record_t record;
+    uint32_t reg_state = debug ? machine_reg_state(machine) : 0;
+    
+    /* Fast path: a counted loop with no checks */
+    if (!debug && !trace && flags == MACHINE_STOP_CYCLES) {
+        for (uint64_t n = until->cycles; n; n--) {
+            if (profile) {
+                counts[cpu->pc]++;
+            }
+            if (vprofile && vcpu_profiler_watches(vcpu, cpu->pc)) {
+                vcpu_profiler_event(vcpu, cpu);
+            }
+            const bool sampled = timed && !(cpu->cycles & (PERF_SAMPLE_PERIOD - 1));
+            const uint64_t t0 = sampled ? perf_ticks() : 0;
+            if (counted) {
+                access.kind = 0;
+                gigatron_exec_traced(cpu, &access);
+                machine_count_access(map, &access);
+            } else {
+                gigatron_exec(cpu);
+            }
+            const uint64_t t1 = sampled ? perf_ticks() : 0;
+            if (vga) {
+                vga_tick(vga);
+            }
+            const uint64_t t2 = sampled ? perf_ticks() : 0;
+            const bool loading = loader && loader_is_active(loader);
+            if (loading) {
+                machine_tick_loader(machine);
+            }
+            if (sampled) {
+                machine_perf_sample(perf, t0, t1, t2, loading);
+            }
+        }
+        return MACHINE_STOP_CYCLES;
+    }
+    
+    for (;;) {
+        if (profile) {
+            counts[cpu->pc]++;
+        }
+        if (vprofile && vcpu_profiler_watches(vcpu, cpu->pc)) {
+            vcpu_profiler_event(vcpu, cpu);
+        }
+        if (trace) {
+            record.cycle = cpu->cycles;
+            record.pc = cpu->pc;
+            record.ir = cpu->rom[cpu->pc];
+        }
+        const bool sampled = timed && !(cpu->cycles & (PERF_SAMPLE_PERIOD - 1));
+        const uint64_t t0 = sampled ? perf_ticks() : 0;
+        if (debug || trace || counted) {
+            access.kind = 0;
+            gigatron_exec_traced(cpu, &access);
+        } else {
+            gigatron_exec(cpu);
+        }
+        if (counted) {
+            machine_count_access(map, &access);
+        }
+        if (trace) {
+            machine_trace(tracer, cpu, &access, &record);
+        }
+        const uint64_t t1 = sampled ? perf_ticks() : 0;
+        if (vga) {
+            vga_tick(vga);
+        }
+        const uint64_t t2 = sampled ? perf_ticks() : 0;
+        const bool loading = loader && loader_is_active(loader);
+        if (loading) {
+            machine_tick_loader(machine);
+        }
+        if (sampled) {
+            machine_perf_sample(perf, t0, t1, t2, loading);
+        }
+        
+        uint32_t hit = 0;
+        if (debug && machine_check_breakpoints(machine, &access, &reg_state)) hit |= MACHINE_STOP_BREAK;
+        if (flags & MACHINE_STOP_VSYNC) {
+            if (prev_out & ~cpu->out & GIGATRON_OUT_VSYNC) hit |= MACHINE_STOP_VSYNC;
+            prev_out = cpu->out;
+        }
+        if ((flags & MACHINE_STOP_PC) && cpu->pc == stop_pc) hit |= MACHINE_STOP_PC;
+        if ((flags & MACHINE_STOP_RAM) && *watch != watch_value) hit |= MACHINE_STOP_RAM;
+        if ((flags & MACHINE_STOP_OUTX) && cpu->outx != outx) hit |= MACHINE_STOP_OUTX;
+        if ((flags & MACHINE_STOP_CYCLES) && cpu->cycles >= end) hit |= MACHINE_STOP_CYCLES;
+        if (hit) return hit;
+    }
+}
+
+typedef uint32_t (*machine_loop_fn)(machine_t* machine, const machine_until_t* until);
+
+/* One instantiation per combination of stop conditions */
+#define MACHINE_LOOP(f) \
+    static uint32_t machine_loop_##f(machine_t* machine, const machine_until_t* until) { \
+        return machine_loop(machine, until, f, 0); \
+    }
+
+MACHINE_LOOP(1)  MACHINE_LOOP(2)  MACHINE_LOOP(3)  MACHINE_LOOP(4)  MACHINE_LOOP(5)  MACHINE_LOOP(6)
+MACHINE_LOOP(7)  MACHINE_LOOP(8)  MACHINE_LOOP(9)  MACHINE_LOOP(10) MACHINE_LOOP(11) MACHINE_LOOP(12)
+MACHINE_LOOP(13) MACHINE_LOOP(14) MACHINE_LOOP(15) MACHINE_LOOP(16) MACHINE_LOOP(17) MACHINE_LOOP(18)
+MACHINE_LOOP(19) MACHINE_LOOP(20) MACHINE_LOOP(21) MACHINE_LOOP(22) MACHINE_LOOP(23) MACHINE_LOOP(24)
+MACHINE_LOOP(25) MACHINE_LOOP(26) MACHINE_LOOP(27) MACHINE_LOOP(28) MACHINE_LOOP(29) MACHINE_LOOP(30)
+MACHINE_LOOP(31)
+
+/* Indexed by MACHINE_STOP_* flags, 0 (no condition) never runs */
+static const machine_loop_fn machine_loops[MACHINE_STOP_ALL + 1] = {
+    NULL,            machine_loop_1,  machine_loop_2,  machine_loop_3,
+    machine_loop_4,  machine_loop_5,  machine_loop_6,  machine_loop_7,
+    machine_loop_8,  machine_loop_9,  machine_loop_10, machine_loop_11,
+    machine_loop_12, machine_loop_13, machine_loop_14, machine_loop_15,
+    machine_loop_16, machine_loop_17, machine_loop_18, machine_loop_19,
+    machine_loop_20, machine_loop_21, machine_loop_22, machine_loop_23,
+    machine_loop_24, machine_loop_25, machine_loop_26, machine_loop_27,
+    machine_loop_28, machine_loop_29, machine_loop_30, machine_loop_31
+};
+
+/*
+ * Instrumented loops, one per combination of instrumentation: conditions
+ * are checked at run time
+ */
+#define MACHINE_INSTRUMENTED(i) \
+    static uint32_t machine_instrumented_##i(machine_t* machine, const machine_until_t* until) { \
+        return machine_loop(machine, until, until->flags & MACHINE_STOP_ALL, i); \
+    }
+
+MACHINE_INSTRUMENTED(1)  MACHINE_INSTRUMENTED(2)  MACHINE_INSTRUMENTED(3)  MACHINE_INSTRUMENTED(4)
+MACHINE_INSTRUMENTED(5)  MACHINE_INSTRUMENTED(6)  MACHINE_INSTRUMENTED(7)  MACHINE_INSTRUMENTED(8)
+MACHINE_INSTRUMENTED(9)  MACHINE_INSTRUMENTED(10) MACHINE_INSTRUMENTED(11) MACHINE_INSTRUMENTED(12)
+MACHINE_INSTRUMENTED(13) MACHINE_INSTRUMENTED(14) MACHINE_INSTRUMENTED(15) MACHINE_INSTRUMENTED(16)
+MACHINE_INSTRUMENTED(17) MACHINE_INSTRUMENTED(18) MACHINE_INSTRUMENTED(19) MACHINE_INSTRUMENTED(20)
+MACHINE_INSTRUMENTED(21) MACHINE_INSTRUMENTED(22) MACHINE_INSTRUMENTED(23) MACHINE_INSTRUMENTED(24)
+MACHINE_INSTRUMENTED(25) MACHINE_INSTRUMENTED(26) MACHINE_INSTRUMENTED(27) MACHINE_INSTRUMENTED(28)
+MACHINE_INSTRUMENTED(29) MACHINE_INSTRUMENTED(30) MACHINE_INSTRUMENTED(31) MACHINE_INSTRUMENTED(32)
+MACHINE_INSTRUMENTED(33) MACHINE_INSTRUMENTED(34) MACHINE_INSTRUMENTED(35) MACHINE_INSTRUMENTED(36)
+MACHINE_INSTRUMENTED(37) MACHINE_INSTRUMENTED(38) MACHINE_INSTRUMENTED(39) MACHINE_INSTRUMENTED(40)
+MACHINE_INSTRUMENTED(41) MACHINE_INSTRUMENTED(42) MACHINE_INSTRUMENTED(43) MACHINE_INSTRUMENTED(44)
+MACHINE_INSTRUMENTED(45) MACHINE_INSTRUMENTED(46) MACHINE_INSTRUMENTED(47) MACHINE_INSTRUMENTED(48)
+MACHINE_INSTRUMENTED(49) MACHINE_INSTRUMENTED(50) MACHINE_INSTRUMENTED(51) MACHINE_INSTRUMENTED(52)
+MACHINE_INSTRUMENTED(53) MACHINE_INSTRUMENTED(54) MACHINE_INSTRUMENTED(55) MACHINE_INSTRUMENTED(56)
+MACHINE_INSTRUMENTED(57) MACHINE_INSTRUMENTED(58) MACHINE_INSTRUMENTED(59) MACHINE_INSTRUMENTED(60)
+MACHINE_INSTRUMENTED(61) MACHINE_INSTRUMENTED(62) MACHINE_INSTRUMENTED(63)
+
+/* Indexed by MACHINE_INSTR_* flags, 0 uses machine_loops */
+static const machine_loop_fn machine_instrumented[MACHINE_INSTR_ALL + 1] = {
+    NULL,                    machine_instrumented_1,  machine_instrumented_2,  machine_instrumented_3,
+    machine_instrumented_4,  machine_instrumented_5,  machine_instrumented_6,  machine_instrumented_7,
+    machine_instrumented_8,  machine_instrumented_9,  machine_instrumented_10, machine_instrumented_11,
+    machine_instrumented_12, machine_instrumented_13, machine_instrumented_14, machine_instrumented_15,
+    machine_instrumented_16, machine_instrumented_17, machine_instrumented_18, machine_instrumented_19,
+    machine_instrumented_20, machine_instrumented_21, machine_instrumented_22, machine_instrumented_23,
+    machine_instrumented_24, machine_instrumented_25, machine_instrumented_26, machine_instrumented_27,
+    machine_instrumented_28, machine_instrumented_29, machine_instrumented_30, machine_instrumented_31,
+    machine_instrumented_32, machine_instrumented_33, machine_instrumented_34, machine_instrumented_35,
+    machine_instrumented_36, machine_instrumented_37, machine_instrumented_38, machine_instrumented_39,
+    machine_instrumented_40, machine_instrumented_41, machine_instrumented_42, machine_instrumented_43,
+    machine_instrumented_44, machine_instrumented_45, machine_instrumented_46, machine_instrumented_47,
+    machine_instrumented_48, machine_instrumented_49, machine_instrumented_50, machine_instrumented_51,
+    machine_instrumented_52, machine_instrumented_53, machine_instrumented_54, machine_instrumented_55,
+    machine_instrumented_56, machine_instrumented_57, machine_instrumented_58, machine_instrumented_59,
+    machine_instrumented_60, machine_instrumented_61, machine_instrumented_62, machine_instrumented_63
+};
+
+/**
+ * Run until a stop condition is met
+ */
+uint32_t machine_run_until(machine_t* machine, const machine_until_t* until) {
+    if (!machine || !machine->cpu || !machine->cpu->rom || !until) return 0;
+    
+    machine->last_break = -1;
+    
+    uint32_t flags = until->flags & MACHINE_STOP_ALL;
+    if ((flags & MACHINE_STOP_CYCLES) && until->cycles == 0) return MACHINE_STOP_CYCLES;
+    
+    uint32_t instr = (machine->num_enabled ? MACHINE_INSTR_DEBUG : 0) |
+                     (machine->profiler ? MACHINE_INSTR_PROFILE : 0) |
+                     (machine->vcpu_profiler ? MACHINE_INSTR_VCPU : 0) |
+                     (machine->tracer ? MACHINE_INSTR_TRACE : 0) |
+                     (machine->perf ? MACHINE_INSTR_TIMING : 0) |
+                     (machine->access_map ? MACHINE_INSTR_ACCESS : 0);
+    
+    /* Only breakpoints can end a run without a stop condition */
+    if (!flags && !(instr & MACHINE_INSTR_DEBUG)) return 0;
+    
+    if (instr & MACHINE_INSTR_TIMING) {
+        uint64_t start = perf_ticks();
+        uint32_t hit = machine_instrumented[instr](machine, until);
+        machine->perf->run_ticks += perf_ticks() - start;
+        return hit;
+    }
+    if (instr) {
+        return machine_instrumented[instr](machine, until);
+    }
+    return machine_loops[flags](machine, until);
+}
+
+/**
+ * Add a breakpoint
+ */
+int32_t machine_add_breakpoint(machine_t* machine, const machine_breakpoint_t* bp) {
+    if (!machine || !bp) return -1;
+    if (machine->num_breakpoints >= MACHINE_MAX_BREAKPOINTS) return -1;
+    if (bp->type >= MACHINE_BP_TYPE_COUNT) return -1;
+    if (bp->type == MACHINE_BP_REGISTER && bp->reg >= MACHINE_REG_COUNT) return -1;
+    
+    uint32_t index = machine->num_breakpoints++;
+    machine->breakpoints[index] = *bp;
+    machine->breakpoints[index].hits = 0;
+    if (bp->enabled) {
+        machine->num_enabled++;
+    }
+    return (int32_t)index;
+}
+
+/**
+ * Remove a breakpoint
+ */
+void machine_remove_breakpoint(machine_t* machine, uint32_t index) {
+    if (!machine || index >= machine->num_breakpoints) return;
+    
+    if (machine->breakpoints[index].enabled) {
+        machine->num_enabled--;
+    }
+    machine->num_breakpoints--;
+    memmove(&machine->breakpoints[index], &machine->breakpoints[index + 1],
+            (machine->num_breakpoints - index) * sizeof(machine_breakpoint_t));
+}
+
+/**
+ * Enable or disable a breakpoint
+ */
+void machine_enable_breakpoint(machine_t* machine, uint32_t index, bool enable) {
+    if (!machine || index >= machine->num_breakpoints) return;
+    
+    machine_breakpoint_t* bp = &machine->breakpoints[index];
+    if (bp->enabled != enable) {
+        bp->enabled = enable;
+        if (enable) {
+            machine->num_enabled++;
+        } else {
+            machine->num_enabled--;
+        }
+    }
+}
+
+/**
+ * Remove all breakpoints
+ */
+void machine_clear_breakpoints(machine_t* machine) {
+    if (!machine) return;
+    
+    machine->num_breakpoints = 0;
+    machine->num_enabled = 0;
+}
+
+/**
+ * Set or clear the ROM profiler
+ */
+bool machine_set_profiler(machine_t* machine, profiler_t* profiler) {
+    if (!machine) return false;
+    
+    if (profiler && (!profiler->counts || !machine->cpu || profiler->size < machine->cpu->rom_size)) {
+        return false;
+    }
+    machine->profiler = profiler;
+    return true;
+}
+
+/**
+ * Set or clear the vCPU profiler
+ */
+bool machine_set_vcpu_profiler(machine_t* machine, vcpu_profiler_t* profiler) {
+    if (!machine) return false;
+    
+    if (profiler && !profiler->valid) return false;
+    machine->vcpu_profiler = profiler;
+    return true;
+}
+
+/**
+ * Set or clear the trace writer
+ */
+void machine_set_tracer(machine_t* machine, trace_writer_t* tracer) {
+    if (!machine) return;
+    
+    machine->tracer = tracer;
+}
+
+/**
+ * Set or clear host time accounting
+ */
+void machine_set_perf(machine_t* machine, perf_t* perf) {
+    if (!machine) return;
+    
+    machine->perf = perf;
+}
+
+/**
+ * Set or clear the RAM access counters
+ */
+bool machine_set_access_map(machine_t* machine, access_map_t* map) {
+    if (!machine) return false;
+    
+    if (map && (!map->reads || !map->writes || !machine->cpu || map->size < machine->cpu->ram_size)) {
+        return false;
+    }
+    machine->access_map = map;
+    return true;
+}
+
+/**
+ * Get display name of a breakpoint kind
+ */
+const char* machine_bp_type_name(machine_bp_type_t type) {
+    switch (type) {
+        case MACHINE_BP_PC:       return "PC";
+        case MACHINE_BP_READ:     return "Read";
+        case MACHINE_BP_WRITE:    return "Write";
+        case MACHINE_BP_REGISTER: return "Register";
+        default:                  return "?";
+    }
+}
+
+/**
+ * Get display name of a register
+ */
+const char* machine_reg_name(machine_reg_t reg) {
+    switch (reg) {
+        case MACHINE_REG_AC:   return "AC";
+        case MACHINE_REG_X:    return "X";
+        case MACHINE_REG_Y:    return "Y";
+        case MACHINE_REG_OUT:  return "OUT";
+        case MACHINE_REG_OUTX: return "OUTX";
+        case MACHINE_REG_IN:   return "IN";
+        default:               return "?";
+    }
+}
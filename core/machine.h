@@ -0,0 +1,214 @@
+/**
+ * Gigatron Machine Run Loop
+ *
+ * Runs the CPU together with its per-cycle devices (VGA, loader) until one
+ * of a set of stop conditions is met. Each combination of conditions runs
+ * a loop specialized for it, so unused conditions cost nothing.
+ *
+ * Breakpoints, watchpoints, profiling, tracing, host time accounting and
+ * RAM access counting run separate instrumented loops built from the same
+ * source, used only while they are active.
+ */
+
+#ifndef GIGATRON_MACHINE_H
+#define GIGATRON_MACHINE_H
+
+#include "gigatron.h"
+#include "vga.h"
+#include "loader.h"
+#include "profiler.h"
+#include "vcpu_profiler.h"
+#include "trace.h"
+#include "perf.h"
+#include "access_map.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Stop conditions (combine with |) */
+#define MACHINE_STOP_VSYNC      0x01    /* VSYNC falling edge (start of a frame) */
+#define MACHINE_STOP_PC         0x02    /* Next instruction is at until.pc */
+#define MACHINE_STOP_RAM        0x04    /* RAM byte at until.ram_addr changed */
+#define MACHINE_STOP_OUTX       0x08    /* OUTX changed */
+#define MACHINE_STOP_CYCLES     0x10    /* until.cycles cycles have run */
+#define MACHINE_STOP_ALL        0x1F
+
+/* Reported by machine_run_until when an enabled breakpoint triggers */
+#define MACHINE_STOP_BREAK      0x20
+
+#define MACHINE_MAX_BREAKPOINTS 16
+
+/**
+ * Breakpoint kinds
+ */
+typedef enum machine_bp_type_t {
+    MACHINE_BP_PC = 0,      /* Next instruction is at addr */
+    MACHINE_BP_READ,        /* Instruction read RAM at addr */
+    MACHINE_BP_WRITE,       /* Instruction wrote RAM at addr */
+    MACHINE_BP_REGISTER,    /* (reg & mask) == value became true */
+    MACHINE_BP_TYPE_COUNT
+} machine_bp_type_t;
+
+/**
+ * Registers for register-condition breakpoints
+ */
+typedef enum machine_reg_t {
+    MACHINE_REG_AC = 0,
+    MACHINE_REG_X,
+    MACHINE_REG_Y,
+    MACHINE_REG_OUT,
+    MACHINE_REG_OUTX,
+    MACHINE_REG_IN,
+    MACHINE_REG_COUNT
+} machine_reg_t;
+
+/**
+ * Breakpoint or watchpoint
+ */
+typedef struct machine_breakpoint_t {
+    machine_bp_type_t type;
+    bool enabled;
+    uint16_t addr;          /* ROM address (PC) or RAM address (READ, WRITE) */
+    machine_reg_t reg;      /* For MACHINE_BP_REGISTER */
+    uint8_t mask;
+    uint8_t value;
+    uint32_t hits;
+} machine_breakpoint_t;
+
+/**
+ * Stop conditions for machine_run_until
+ */
+typedef struct machine_until_t {
+    uint32_t flags;         /* MACHINE_STOP_* */
+    uint16_t pc;            /* For MACHINE_STOP_PC */
+    uint16_t ram_addr;      /* For MACHINE_STOP_RAM */
+    uint64_t cycles;        /* For MACHINE_STOP_CYCLES */
+} machine_until_t;
+
+/**
+ * Machine: the CPU and the devices ticked with it.
+ * The machine does not own them.
+ */
+typedef struct machine_t {
+    gigatron_t* cpu;
+    vga_t* vga;             /* NULL if not emulated */
+    loader_t* loader;       /* NULL if not emulated */
+    uint8_t input;          /* Controller input (active low), in_reg while the loader is idle */
+    
+    /* Breakpoints, the fast loops run while none is enabled */
+    machine_breakpoint_t breakpoints[MACHINE_MAX_BREAKPOINTS];
+    uint32_t num_breakpoints;
+    uint32_t num_enabled;
+    int32_t last_break;     /* Index of the breakpoint that stopped the last run, -1 if none */
+    
+    /* Profilers, NULL while not profiling */
+    profiler_t* profiler;
+    vcpu_profiler_t* vcpu_profiler;
+    
+    /* Execution trace, NULL while not tracing */
+    trace_writer_t* tracer;
+    
+    /* Host time accounting, NULL while off */
+    perf_t* perf;
+    
+    /* RAM access counters, NULL while not counting */
+    access_map_t* access_map;
+} machine_t;
+
+/**
+ * Initialize a machine. vga and loader may be NULL.
+ */
+void machine_init(machine_t* machine, gigatron_t* cpu, vga_t* vga, loader_t* loader);
+
+/**
+ * Run until one of the stop conditions is met.
+ * Conditions are checked after each cycle, so at least one cycle runs
+ * unless the cycle budget is 0. Returns the MACHINE_STOP_* flags that were
+ * met (MACHINE_STOP_BREAK for a breakpoint, see last_break), or 0 if no ROM
+ * is present or there is neither a condition nor an enabled breakpoint.
+ */
+uint32_t machine_run_until(machine_t* machine, const machine_until_t* until);
+
+/**
+ * Set the controller input (active low). in_reg takes it at once unless
+ * the loader is sending, in which case it does on the cycle the loader
+ * finishes, as if the input were applied every cycle.
+ */
+void machine_set_input(machine_t* machine, uint8_t input);
+
+/**
+ * Run a number of cycles (machine_run_until with only a cycle budget).
+ */
+static inline void machine_run(machine_t* machine, uint64_t cycles) {
+    machine_until_t until = { MACHINE_STOP_CYCLES, 0, 0, cycles };
+    machine_run_until(machine, &until);
+}
+
+/**
+ * Add a breakpoint.
+ * Returns its index, or -1 if the table is full or the breakpoint invalid.
+ */
+int32_t machine_add_breakpoint(machine_t* machine, const machine_breakpoint_t* bp);
+
+/**
+ * Remove a breakpoint, later ones move down by one index.
+ */
+void machine_remove_breakpoint(machine_t* machine, uint32_t index);
+
+/**
+ * Enable or disable a breakpoint.
+ */
+void machine_enable_breakpoint(machine_t* machine, uint32_t index, bool enable);
+
+/**
+ * Remove all breakpoints.
+ */
+void machine_clear_breakpoints(machine_t* machine);
+
+/**
+ * Count executions per ROM address into profiler, NULL to stop profiling.
+ * Returns false if the profiler has fewer counters than the ROM has words.
+ */
+bool machine_set_profiler(machine_t* machine, profiler_t* profiler);
+
+/**
+ * Profile the vCPU into profiler, NULL to stop profiling.
+ * Returns false if the profiler did not find the interpreter in the ROM.
+ */
+bool machine_set_vcpu_profiler(machine_t* machine, vcpu_profiler_t* profiler);
+
+/**
+ * Record every executed instruction into tracer, NULL to stop tracing.
+ */
+void machine_set_tracer(machine_t* machine, trace_writer_t* tracer);
+
+/**
+ * Account host time per device into perf, NULL to stop. The caller closes
+ * frames with perf_end_frame and adds time spent outside the machine.
+ */
+void machine_set_perf(machine_t* machine, perf_t* perf);
+
+/**
+ * Count reads and writes per RAM address into map, NULL to stop counting.
+ * Returns false if the map has fewer counters than the RAM has bytes.
+ */
+bool machine_set_access_map(machine_t* machine, access_map_t* map);
+
+/**
+ * Get display name of a breakpoint kind.
+ */
+const char* machine_bp_type_name(machine_bp_type_t type);
+
+/**
+ * Get display name of a register.
+ */
+const char* machine_reg_name(machine_reg_t reg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GIGATRON_MACHINE_H */
@@ -0,0 +1,223 @@
+/**
+ * Gigatron Frame Pacer
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L     /* clock_gettime, nanosleep */
+#endif
+
+#include "pacer.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <mmsystem.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <time.h>
+#endif
+
+/**
+ * Monotonic clock in nanoseconds
+ */
+uint64_t pacer_now_ns(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Coarse OS sleep (may overshoot, by a lot on some platforms)
+ */
+static void pacer_sleep_ns(pacer_t* pacer, uint64_t ns) {
+#if defined(_WIN32)
+    if (pacer->timer) {
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)(ns / 100);   /* Relative, 100 ns units */
+        if (SetWaitableTimer((HANDLE)pacer->timer, &due, 0, NULL, NULL, FALSE)) {
+            WaitForSingleObject((HANDLE)pacer->timer, INFINITE);
+            return;
+        }
+    }
+    Sleep((DWORD)((ns + 999999) / 1000000));
+#else
+    (void)pacer;
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000ULL);
+    ts.tv_nsec = (long)(ns % 1000000000ULL);
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/**
+ * Add an observed sleep to its statistics, recent sleeps weigh most
+ */
+static void pacer_record_sleep(pacer_t* pacer, double observed) {
+    pacer->sleep_count++;
+    double weight = 1.0 / (double)pacer->sleep_count;
+    if (weight < PACER_SLEEP_WEIGHT) weight = PACER_SLEEP_WEIGHT;
+    double delta = observed - pacer->sleep_mean;
+    pacer->sleep_mean += weight * delta;
+    pacer->sleep_var = (1.0 - weight) * (pacer->sleep_var + weight * delta * delta);
+}
+
+/**
+ * Initialize pacer
+ */
+void pacer_init(pacer_t* pacer, uint64_t period_ns) {
+    if (!pacer) return;
+    
+    memset(pacer, 0, sizeof(pacer_t));
+    pacer->period_ns = period_ns;
+
+#if defined(_WIN32)
+    /* Sleep(1) lasts a whole 15.6 ms scheduler tick unless asked otherwise */
+    pacer->timer = (void*)CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION,
+                                                 TIMER_ALL_ACCESS);
+    if (!pacer->timer) {
+        pacer->timer_period = timeBeginPeriod(1) == TIMERR_NOERROR;
+    }
+#endif
+    
+    /* The spin margin follows from the measured sleep, not a guess */
+    for (int i = 0; i < PACER_CALIBRATION; i++) {
+        uint64_t start = pacer_now_ns();
+        pacer_sleep_ns(pacer, PACER_SLEEP_NS);
+        pacer_record_sleep(pacer, (double)(pacer_now_ns() - start));
+    }
+}
+
+/**
+ * Release the OS timer resources
+ */
+void pacer_shutdown(pacer_t* pacer) {
+    if (!pacer) return;
+
+#if defined(_WIN32)
+    if (pacer->timer) {
+        CloseHandle((HANDLE)pacer->timer);
+    }
+    if (pacer->timer_period) {
+        timeEndPeriod(1);
+    }
+#endif
+    pacer->timer = NULL;
+    pacer->timer_period = false;
+}
+
+/**
+ * Restart scheduling from now
+ */
+void pacer_reset(pacer_t* pacer) {
+    if (!pacer) return;
+    
+    pacer->next_deadline = 0;
+}
+
+/**
+ * Sleep while that safely ends before the deadline, then spin
+ */
+static void pacer_wait_until(pacer_t* pacer, uint64_t deadline) {
+    for (;;) {
+        uint64_t now = pacer_now_ns();
+        if (now >= deadline) return;
+        
+        /* Worst likely sleep */
+        double estimate = pacer->sleep_mean + PACER_SPIN_SIGMAS * sqrt(pacer->sleep_var);
+        if ((double)(deadline - now) <= estimate) break;
+        
+        pacer_sleep_ns(pacer, PACER_SLEEP_NS);
+        pacer_record_sleep(pacer, (double)(pacer_now_ns() - now));
+    }
+    
+    while (pacer_now_ns() < deadline) {
+        /* Spin */
+    }
+}
+
+/**
+ * Wait for the next deadline
+ */
+uint32_t pacer_wait(pacer_t* pacer) {
+    if (!pacer || pacer->period_ns == 0) return 1;
+    
+    uint64_t now = pacer_now_ns();
+    
+    /* First frame runs immediately */
+    if (pacer->next_deadline == 0) {
+        pacer->next_deadline = now + pacer->period_ns;
+        return 1;
+    }
+    
+    /* Too far behind (debugger, suspended window): drop the backlog */
+    if (now > pacer->next_deadline + PACER_MAX_BEHIND * pacer->period_ns) {
+        pacer->resyncs++;
+        pacer->next_deadline = now + pacer->period_ns;
+        return 1;
+    }
+    
+    pacer_wait_until(pacer, pacer->next_deadline);
+    
+    /* Record how late we woke up */
+    uint64_t woke = pacer_now_ns();
+    uint64_t late = woke - pacer->next_deadline;
+    double late_us = (double)late / 1000.0;
+    pacer->frames++;
+    double delta = late_us - pacer->jitter_mean;
+    pacer->jitter_mean += delta / (double)pacer->frames;
+    pacer->jitter_m2 += delta * (late_us - pacer->jitter_mean);
+    if (late_us > pacer->jitter_max) {
+        pacer->jitter_max = late_us;
+    }
+    if (late > PACER_LATE_NS) {
+        pacer->late_frames++;
+    }
+    
+    /* Periods that have passed, the next deadline stays on the grid */
+    uint32_t due = 1 + (uint32_t)(late / pacer->period_ns);
+    pacer->next_deadline += (uint64_t)due * pacer->period_ns;
+    return due;
+}
+
+/**
+ * Get wake-up jitter statistics
+ */
+void pacer_get_stats(const pacer_t* pacer, pacer_stats_t* stats) {
+    if (!pacer || !stats) return;
+    
+    stats->frames = pacer->frames;
+    stats->late_frames = pacer->late_frames;
+    stats->resyncs = pacer->resyncs;
+    stats->mean_us = pacer->jitter_mean;
+    stats->stddev_us = pacer->frames > 1 ? sqrt(pacer->jitter_m2 / (double)(pacer->frames - 1)) : 0.0;
+    stats->max_us = pacer->jitter_max;
+}
+
+/**
+ * Clear wake-up jitter statistics
+ */
+void pacer_reset_stats(pacer_t* pacer) {
+    if (!pacer) return;
+    
+    pacer->frames = 0;
+    pacer->late_frames = 0;
+    pacer->resyncs = 0;
+    pacer->jitter_mean = 0.0;
+    pacer->jitter_m2 = 0.0;
+    pacer->jitter_max = 0.0;
+}
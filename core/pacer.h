@@ -0,0 +1,117 @@
+/**
+ * Gigatron Frame Pacer
+ * 
+ * Schedules emulated frames against a monotonic clock at the rate derived
+ * from the CPU clock (GIGATRON_CYCLES_PER_FRAME / hz), independent of the
+ * host display. Waits sleep coarsely and spin the last stretch to hit each
+ * deadline within ~100 us.
+ */
+
+#ifndef GIGATRON_PACER_H
+#define GIGATRON_PACER_H
+
+#include "gigatron.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Pacer configuration */
+#define PACER_SLEEP_NS      1000000     /* Length of one coarse sleep */
+#define PACER_LATE_NS       1000000     /* Wake-ups later than this count as late */
+#define PACER_MAX_BEHIND    4           /* Frames to catch up before resyncing */
+#define PACER_SLEEP_WEIGHT  0.05        /* Weight of the latest sleep in its statistics */
+#define PACER_SPIN_SIGMAS   2.0         /* Spin margin in standard deviations above the mean sleep */
+#define PACER_CALIBRATION   4           /* Sleeps measured by pacer_init */
+
+/**
+ * Wake-up jitter statistics (lateness relative to the deadline)
+ */
+typedef struct pacer_stats_t {
+    uint64_t frames;        /* Deadlines waited for */
+    uint64_t late_frames;   /* Woke more than PACER_LATE_NS late */
+    uint64_t resyncs;       /* Fell too far behind and dropped the backlog */
+    double mean_us;
+    double stddev_us;
+    double max_us;
+} pacer_stats_t;
+
+/**
+ * Pacer state
+ */
+typedef struct pacer_t {
+    uint64_t period_ns;
+    uint64_t next_deadline;     /* 0 until the first wait */
+    
+    /*
+     * Observed length of a PACER_SLEEP_NS sleep: running mean/variance at
+     * first, then exponentially weighted so one preemption fades out
+     */
+    uint64_t sleep_count;
+    double sleep_mean;
+    double sleep_var;
+    
+    /* High resolution waitable timer (Windows), NULL if unavailable */
+    void* timer;
+    bool timer_period;          /* timeBeginPeriod(1) in effect instead */
+    
+    /* Jitter accumulators */
+    uint64_t frames;
+    uint64_t late_frames;
+    uint64_t resyncs;
+    double jitter_mean;
+    double jitter_m2;
+    double jitter_max;
+} pacer_t;
+
+/**
+ * Initialize pacer for one deadline every period_ns.
+ */
+void pacer_init(pacer_t* pacer, uint64_t period_ns);
+
+/**
+ * Release the OS timer resources.
+ */
+void pacer_shutdown(pacer_t* pacer);
+
+/**
+ * Restart scheduling from now (e.g. after a pause). Keeps statistics.
+ */
+void pacer_reset(pacer_t* pacer);
+
+/**
+ * Wait for the next deadline.
+ * Returns the number of periods that are due (1 normally, more when the
+ * caller fell behind and should catch up).
+ */
+uint32_t pacer_wait(pacer_t* pacer);
+
+/**
+ * Get wake-up jitter statistics.
+ */
+void pacer_get_stats(const pacer_t* pacer, pacer_stats_t* stats);
+
+/**
+ * Clear wake-up jitter statistics.
+ */
+void pacer_reset_stats(pacer_t* pacer);
+
+/**
+ * Monotonic clock in nanoseconds.
+ */
+uint64_t pacer_now_ns(void);
+
+/**
+ * Get the period of one Gigatron frame at the given clock rate.
+ */
+static inline uint64_t pacer_frame_period_ns(uint32_t hz) {
+    return hz ? (uint64_t)GIGATRON_CYCLES_PER_FRAME * 1000000000ULL / hz : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GIGATRON_PACER_H */
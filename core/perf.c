@@ -0,0 +1,173 @@
+/**
+ * Gigatron Host Performance Accounting
+ */
+
+#include "perf.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PERF_CALIBRATION_READS  1024
+
+static const char* const perf_device_names[PERF_DEVICE_COUNT] = {
+    "CPU", "VGA", "Audio", "Loader"
+};
+
+/**
+ * Initialize accounting
+ */
+void perf_init(perf_t* perf, uint32_t hz) {
+    if (!perf) return;
+    
+    memset(perf, 0, sizeof(perf_t));
+    perf->hz = hz;
+    
+    /* Cost of a counter read: the mean difference of back-to-back reads */
+    uint64_t total = 0;
+    for (int i = 0; i < PERF_CALIBRATION_READS; i++) {
+        uint64_t t0 = perf_ticks();
+        total += perf_ticks() - t0;
+    }
+    perf->read_ticks = (double)total / PERF_CALIBRATION_READS;
+    perf->stage_ticks = perf->read_ticks;
+    
+    /* Ticks are converted with the rate observed since now */
+    perf->calib_ticks = perf_ticks();
+    perf->calib_ns = pacer_now_ns();
+    perf->frame_ns = perf->calib_ns;
+}
+
+/**
+ * Clear the current frame and the history
+ */
+void perf_reset(perf_t* perf) {
+    if (!perf) return;
+    
+    perf->run_ticks = 0;
+    perf->samples = 0;
+    perf->empty_ticks = 0;
+    perf->empty_samples = 0;
+    memset(perf->sample_ticks, 0, sizeof(perf->sample_ticks));
+    memset(perf->device_ticks, 0, sizeof(perf->device_ticks));
+    perf->frame_ns = pacer_now_ns();
+    perf->count = 0;
+    perf->pos = 0;
+}
+
+/**
+ * Close the current frame
+ */
+void perf_end_frame(perf_t* perf, uint64_t cycles) {
+    if (!perf) return;
+    
+    uint64_t now_ns = pacer_now_ns();
+    uint64_t now_ticks = perf_ticks();
+    if (now_ticks > perf->calib_ticks && now_ns > perf->calib_ns) {
+        perf->ns_per_tick = (double)(now_ns - perf->calib_ns) / (double)(now_ticks - perf->calib_ticks);
+    }
+    uint64_t wall_ns = now_ns - perf->frame_ns;
+    
+    if (perf->empty_samples) {
+        perf->stage_ticks = (double)perf->empty_ticks / (double)perf->empty_samples;
+    }
+    
+    /* Stage times of the sampled cycles, without the counter reads */
+    double stage[PERF_DEVICE_COUNT];
+    double stage_total = 0.0;
+    for (int d = 0; d < PERF_DEVICE_COUNT; d++) {
+        uint64_t timed = d == PERF_LOADER ? perf->samples - perf->empty_samples : perf->samples;
+        double cost = (double)perf->sample_ticks[d] - (double)timed * perf->stage_ticks;
+        stage[d] = cost > 0.0 ? cost : 0.0;
+        stage_total += stage[d];
+    }
+    
+    /* Split the machine runs (less the sampling reads) in those proportions */
+    double run = (double)perf->run_ticks - 4.0 * perf->read_ticks * (double)perf->samples;
+    if (run < 0.0) run = 0.0;
+    
+    perf_frame_t frame;
+    frame.busy_us = 0.0f;
+    for (int d = 0; d < PERF_DEVICE_COUNT; d++) {
+        double ticks = (double)perf->device_ticks[d];
+        if (stage_total > 0.0) {
+            ticks += run * stage[d] / stage_total;
+        } else if (d == PERF_CPU) {
+            ticks += run;
+        }
+        frame.device_us[d] = (float)(ticks * perf->ns_per_tick * 1e-3);
+        frame.busy_us += frame.device_us[d];
+    }
+    frame.wall_us = (float)((double)wall_ns * 1e-3);
+    frame.cycles = (uint32_t)cycles;
+    
+    if (wall_ns <= PERF_MAX_FRAME_NS && perf->ns_per_tick > 0.0) {
+        perf->history[perf->pos] = frame;
+        perf->pos = (perf->pos + 1) % PERF_HISTORY;
+        if (perf->count < PERF_HISTORY) perf->count++;
+    }
+    
+    perf->run_ticks = 0;
+    perf->samples = 0;
+    perf->empty_ticks = 0;
+    perf->empty_samples = 0;
+    memset(perf->sample_ticks, 0, sizeof(perf->sample_ticks));
+    memset(perf->device_ticks, 0, sizeof(perf->device_ticks));
+    perf->frame_ns = now_ns;
+}
+
+static int compare_float(const void* a, const void* b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Get the p-th percentile (0..1) of values, sorting them
+ */
+static float perf_percentile(float* values, uint32_t count, double p) {
+    qsort(values, count, sizeof(float), compare_float);
+    return values[(uint32_t)((double)(count - 1) * p + 0.5)];
+}
+
+/**
+ * Get percentiles and speed over the history
+ */
+void perf_get_stats(const perf_t* perf, perf_stats_t* stats) {
+    if (!stats) return;
+    
+    memset(stats, 0, sizeof(perf_stats_t));
+    if (!perf || perf->count == 0) return;
+    
+    uint32_t n = perf->count;
+    float values[PERF_HISTORY];
+    for (int d = 0; d < PERF_DEVICE_COUNT; d++) {
+        for (uint32_t i = 0; i < n; i++) {
+            values[i] = perf->history[i].device_us[d];
+        }
+        stats->p50_us[d] = perf_percentile(values, n, 0.50);
+        stats->p99_us[d] = perf_percentile(values, n, 0.99);
+    }
+    
+    double cycles = 0.0;
+    double wall_us = 0.0;
+    double busy_us = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        values[i] = perf->history[i].busy_us;
+        cycles += perf->history[i].cycles;
+        wall_us += perf->history[i].wall_us;
+        busy_us += perf->history[i].busy_us;
+    }
+    stats->busy_p50_us = perf_percentile(values, n, 0.50);
+    stats->busy_p99_us = perf_percentile(values, n, 0.99);
+    
+    stats->frames = n;
+    stats->emulated_mhz = wall_us > 0.0 ? cycles / wall_us : 0.0;
+    stats->realtime = perf->hz ? stats->emulated_mhz * 1e6 / (double)perf->hz : 0.0;
+    stats->capacity_mhz = busy_us > 0.0 ? cycles / busy_us : 0.0;
+}
+
+/**
+ * Get the name of a device
+ */
+const char* perf_device_name(perf_device_t device) {
+    return (device >= 0 && device < PERF_DEVICE_COUNT) ? perf_device_names[device] : "?";
+}
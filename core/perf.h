@@ -0,0 +1,153 @@
+/**
+ * Gigatron Host Performance Accounting
+ *
+ * Measures the host time spent per emulated frame in each device (CPU,
+ * VGA, audio, loader) with the CPU's timestamp counter. The machine loop
+ * times one cycle in every PERF_SAMPLE_PERIOD stage by stage and splits
+ * the measured time of the whole run by those samples, so accounting costs
+ * two counter reads per run plus four per sampled cycle. A stage costs not
+ * much more than the counter reads around it, so their cost is measured
+ * live on the loader stage while no GT1 is loading, and subtracted.
+ *
+ * Frames are kept in a short history for percentiles and effective speed.
+ */
+
+#ifndef GIGATRON_PERF_H
+#define GIGATRON_PERF_H
+
+#include "pacer.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PERF_SAMPLE_PERIOD  64      /* Cycles per timed cycle, power of two */
+#define PERF_HISTORY        256     /* Frames kept for statistics */
+#define PERF_MAX_FRAME_NS   250000000   /* Longer frames are pauses, not recorded */
+
+/**
+ * Accounted devices
+ */
+typedef enum perf_device_t {
+    PERF_CPU = 0,
+    PERF_VGA,
+    PERF_AUDIO,
+    PERF_LOADER,
+    PERF_DEVICE_COUNT
+} perf_device_t;
+
+/**
+ * Host time of one emulated frame
+ */
+typedef struct perf_frame_t {
+    float device_us[PERF_DEVICE_COUNT];
+    float busy_us;          /* Sum of the devices */
+    float wall_us;          /* Since the previous frame */
+    uint32_t cycles;        /* Emulated cycles */
+} perf_frame_t;
+
+/**
+ * Statistics over the frame history
+ */
+typedef struct perf_stats_t {
+    uint32_t frames;
+    float p50_us[PERF_DEVICE_COUNT];
+    float p99_us[PERF_DEVICE_COUNT];
+    float busy_p50_us;
+    float busy_p99_us;
+    double emulated_mhz;    /* Cycles per wall-clock second */
+    double realtime;        /* emulated_mhz relative to the nominal clock (1.0 = real time) */
+    double capacity_mhz;    /* Cycles per second of busy time (speed limit) */
+} perf_stats_t;
+
+/**
+ * Accounting state
+ */
+typedef struct perf_t {
+    uint32_t hz;                /* Nominal clock */
+    
+    /* Tick calibration against the monotonic clock */
+    uint64_t calib_ticks;
+    uint64_t calib_ns;
+    double ns_per_tick;
+    double read_ticks;          /* Cost of one perf_ticks call */
+    double stage_ticks;         /* Measured time of an empty stage */
+    
+    /* Current frame */
+    uint64_t run_ticks;         /* Whole machine runs */
+    uint64_t sample_ticks[PERF_DEVICE_COUNT];   /* Sampled cycles, split run_ticks */
+    uint64_t samples;           /* Sampled cycles (4 counter reads each) */
+    uint64_t empty_ticks;       /* Loader stage while idle */
+    uint64_t empty_samples;
+    uint64_t device_ticks[PERF_DEVICE_COUNT];   /* Timed outside the machine loop */
+    uint64_t frame_ns;          /* Monotonic time the frame started */
+    
+    /* History ring */
+    perf_frame_t history[PERF_HISTORY];
+    uint32_t count;
+    uint32_t pos;
+} perf_t;
+
+/**
+ * Read the timestamp counter (monotonic clock in ns where there is none).
+ */
+static inline uint64_t perf_ticks(void) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return pacer_now_ns();
+#endif
+}
+
+/**
+ * Initialize accounting for a CPU clocked at hz.
+ */
+void perf_init(perf_t* perf, uint32_t hz);
+
+/**
+ * Clear the current frame and the history (keeps the calibration).
+ */
+void perf_reset(perf_t* perf);
+
+/**
+ * Add host time measured outside the machine loop (e.g. audio rendering).
+ */
+static inline void perf_add(perf_t* perf, perf_device_t device, uint64_t ticks) {
+    perf->device_ticks[device] += ticks;
+}
+
+/**
+ * Close the current frame: convert it to host time and add it to the history.
+ * `cycles` is the number of cycles emulated in it.
+ */
+void perf_end_frame(perf_t* perf, uint64_t cycles);
+
+/**
+ * Get percentiles and speed over the history.
+ */
+void perf_get_stats(const perf_t* perf, perf_stats_t* stats);
+
+/**
+ * Get the name of a device.
+ */
+const char* perf_device_name(perf_device_t device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GIGATRON_PERF_H */
@@ -0,0 +1,118 @@
+/**
+ * Gigatron ROM Execution Profiler
+ */
+
+#include "profiler.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/**
+ * Initialize a profiler
+ */
+bool profiler_init(profiler_t* profiler, uint32_t rom_size) {
+    if (!profiler || rom_size == 0) return false;
+    
+    profiler->counts = (uint64_t*)calloc(rom_size, sizeof(uint64_t));
+    if (!profiler->counts) {
+        profiler->size = 0;
+        return false;
+    }
+    profiler->size = rom_size;
+    
+    return true;
+}
+
+/**
+ * Free the counters
+ */
+void profiler_shutdown(profiler_t* profiler) {
+    if (!profiler) return;
+    
+    free(profiler->counts);
+    profiler->counts = NULL;
+    profiler->size = 0;
+}
+
+/**
+ * Clear all counts
+ */
+void profiler_reset(profiler_t* profiler) {
+    if (!profiler || !profiler->counts) return;
+    
+    memset(profiler->counts, 0, profiler->size * sizeof(uint64_t));
+}
+
+/**
+ * Get the number of instructions counted
+ */
+uint64_t profiler_total(const profiler_t* profiler) {
+    if (!profiler || !profiler->counts) return 0;
+    
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < profiler->size; i++) {
+        total += profiler->counts[i];
+    }
+    return total;
+}
+
+/**
+ * Get the most executed addresses
+ */
+uint32_t profiler_hotspots(const profiler_t* profiler, profiler_hotspot_t* out, uint32_t max) {
+    if (!profiler || !profiler->counts || !out || max == 0) return 0;
+    
+    /* Insertion into a sorted top list, the list is short compared to the ROM */
+    uint32_t n = 0;
+    for (uint32_t addr = 0; addr < profiler->size; addr++) {
+        uint64_t count = profiler->counts[addr];
+        if (count == 0) continue;
+        if (n == max && count <= out[n - 1].count) continue;
+        
+        uint32_t i = (n < max) ? n++ : n - 1;
+        while (i > 0 && out[i - 1].count < count) {
+            out[i] = out[i - 1];
+            i--;
+        }
+        out[i].addr = (uint16_t)addr;
+        out[i].count = count;
+    }
+    
+    return n;
+}
+
+/**
+ * Write a text report of the hot spots
+ */
+bool profiler_write_report(const profiler_t* profiler, const gigatron_t* cpu,
+                           const char* filename, uint32_t max) {
+    if (!profiler || !profiler->counts || !filename || max == 0) return false;
+    
+    profiler_hotspot_t* spots = (profiler_hotspot_t*)malloc(max * sizeof(profiler_hotspot_t));
+    if (!spots) return false;
+    
+    FILE* f = fopen(filename, "w");
+    if (!f) {
+        free(spots);
+        return false;
+    }
+    
+    uint32_t n = profiler_hotspots(profiler, spots, max);
+    uint64_t total = profiler_total(profiler);
+    double scale = total ? 100.0 / (double)total : 0.0;
+    
+    fprintf(f, "# Gigatron ROM profile: %llu instructions\n", (unsigned long long)total);
+    fprintf(f, "# rank  addr   insn  count            %%       cumulative%%\n");
+    
+    uint64_t cumulative = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        cumulative += spots[i].count;
+        uint16_t insn = (cpu && cpu->rom && spots[i].addr < cpu->rom_size) ? cpu->rom[spots[i].addr] : 0;
+        fprintf(f, "%6u  %04X   %04X  %-15llu  %6.2f  %6.2f\n",
+                i + 1, spots[i].addr, insn, (unsigned long long)spots[i].count,
+                (double)spots[i].count * scale, (double)cumulative * scale);
+    }
+    
+    free(spots);
+    return fclose(f) == 0;
+}
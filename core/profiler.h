@@ -0,0 +1,77 @@
+/**
+ * Gigatron ROM Execution Profiler
+ *
+ * Counts executions per ROM address. Counting is done by a separate
+ * machine run loop variant (see machine_set_profiler), so the default
+ * loops are unaffected while profiling is off.
+ */
+
+#ifndef GIGATRON_PROFILER_H
+#define GIGATRON_PROFILER_H
+
+#include "gigatron.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PROFILER_REPORT_TOP     64      /* Default number of hot spots in a report */
+
+/**
+ * ROM address and its execution count
+ */
+typedef struct profiler_hotspot_t {
+    uint16_t addr;
+    uint64_t count;
+} profiler_hotspot_t;
+
+/**
+ * Profiler state
+ */
+typedef struct profiler_t {
+    uint64_t* counts;   /* Executions per ROM address */
+    uint32_t size;      /* Number of counters */
+} profiler_t;
+
+/**
+ * Initialize a profiler for a ROM of rom_size words.
+ * Returns true on success, false on failure.
+ */
+bool profiler_init(profiler_t* profiler, uint32_t rom_size);
+
+/**
+ * Free the counters.
+ */
+void profiler_shutdown(profiler_t* profiler);
+
+/**
+ * Clear all counts.
+ */
+void profiler_reset(profiler_t* profiler);
+
+/**
+ * Get the number of instructions counted.
+ */
+uint64_t profiler_total(const profiler_t* profiler);
+
+/**
+ * Get the most executed addresses, highest count first.
+ * Returns the number of entries written (addresses never executed are skipped).
+ */
+uint32_t profiler_hotspots(const profiler_t* profiler, profiler_hotspot_t* out, uint32_t max);
+
+/**
+ * Write a text report of the top `max` hot spots.
+ * cpu (optional) adds the instruction word at each address.
+ * Returns true on success, false on failure.
+ */
+bool profiler_write_report(const profiler_t* profiler, const gigatron_t* cpu,
+                           const char* filename, uint32_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GIGATRON_PROFILER_H */
@@ -0,0 +1,600 @@
+/**
+ * Gigatron Video and Audio Recorder
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L     /* pthreads, nanosleep, sched_yield */
+#endif
+
+#include "recorder.h"
+#include "gigatron_atomic.h"
+#include "gigatron.h"
+#include "vga.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+/* 64-bit file offsets */
+#if defined(_WIN32)
+#define RECORDER_FSEEK(f, offset, origin)   _fseeki64((f), (__int64)(offset), (origin))
+#else
+#define RECORDER_FSEEK(f, offset, origin)   fseeko((f), (off_t)(offset), (origin))
+#endif
+
+#define RECORDER_MAGIC          "GTVIDEO"
+#define RECORDER_HEADER_SIZE    (24 + 64 * 3)
+#define RECORDER_WAV_HEADER     44
+#define RECORDER_PCM_CHUNK      4096    /* Samples converted per write */
+#define RECORDER_MAX_LINES      (VGA_NATIVE_HEIGHT * VGA_MAX_SCALE)
+
+/*
+ * Little-endian field access
+ */
+
+static inline void recorder_put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void recorder_put32(uint8_t* p, uint32_t v) {
+    recorder_put16(p, (uint16_t)v);
+    recorder_put16(p + 2, (uint16_t)(v >> 16));
+}
+
+/*
+ * Threads
+ */
+
+static void recorder_sleep_ms(uint32_t ms) {
+#if defined(_WIN32)
+    Sleep(ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ms / 1000);
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static void recorder_yield(void) {
+#if defined(_WIN32)
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+static void recorder_thread(recorder_t* recorder);
+
+#if defined(_WIN32)
+static DWORD WINAPI recorder_thread_entry(LPVOID arg) {
+    recorder_thread((recorder_t*)arg);
+    return 0;
+}
+#else
+static void* recorder_thread_entry(void* arg) {
+    recorder_thread((recorder_t*)arg);
+    return NULL;
+}
+#endif
+
+/**
+ * Start the writer thread, returns its handle or NULL
+ */
+static void* recorder_thread_start(recorder_t* recorder) {
+#if defined(_WIN32)
+    return (void*)CreateThread(NULL, 0, recorder_thread_entry, recorder, 0, NULL);
+#else
+    pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
+    if (thread && pthread_create(thread, NULL, recorder_thread_entry, recorder) != 0) {
+        free(thread);
+        thread = NULL;
+    }
+    return thread;
+#endif
+}
+
+/**
+ * Wait for the writer thread to finish
+ */
+static void recorder_thread_join(void* thread) {
+#if defined(_WIN32)
+    WaitForSingleObject((HANDLE)thread, INFINITE);
+    CloseHandle((HANDLE)thread);
+#else
+    pthread_join(*(pthread_t*)thread, NULL);
+    free(thread);
+#endif
+}
+
+/*
+ * Writer thread
+ */
+
+/**
+ * Write the WAV header for data_bytes of samples
+ */
+static bool recorder_write_wav_header(recorder_t* recorder, uint32_t data_bytes) {
+    uint8_t header[RECORDER_WAV_HEADER];
+    memcpy(&header[0], "RIFF", 4);
+    recorder_put32(&header[4], 36 + data_bytes);
+    memcpy(&header[8], "WAVEfmt ", 8);
+    recorder_put32(&header[16], 16);
+    recorder_put16(&header[20], 1);                         /* PCM */
+    recorder_put16(&header[22], 1);                         /* Mono */
+    recorder_put32(&header[24], recorder->sample_rate);
+    recorder_put32(&header[28], recorder->sample_rate * 2);
+    recorder_put16(&header[32], 2);                         /* Block align */
+    recorder_put16(&header[34], 16);                        /* Bits per sample */
+    memcpy(&header[36], "data", 4);
+    recorder_put32(&header[40], data_bytes);
+    return fwrite(header, 1, sizeof(header), recorder->audio_file) == sizeof(header);
+}
+
+/**
+ * Write the indexed video header
+ */
+static bool recorder_write_indexed_header(recorder_t* recorder) {
+    uint8_t header[RECORDER_HEADER_SIZE];
+    memcpy(header, RECORDER_MAGIC, 8);
+    recorder_put32(&header[8], RECORDER_VERSION);
+    recorder_put16(&header[12], VGA_NATIVE_WIDTH);
+    recorder_put16(&header[14], (uint16_t)recorder->lines);
+    recorder_put32(&header[16], recorder->hz);
+    recorder_put32(&header[20], GIGATRON_CYCLES_PER_FRAME);
+    for (uint32_t color = 0; color < 64; color++) {
+        uint8_t* rgb = &header[24 + color * 3];
+        vga_color_to_rgba((uint8_t)color, &rgb[0], &rgb[1], &rgb[2]);
+    }
+    if (fwrite(header, 1, sizeof(header), recorder->video_file) != sizeof(header)) return false;
+    recorder->video_bytes += sizeof(header);
+    return true;
+}
+
+/**
+ * Write the Y4M stream header
+ */
+static bool recorder_write_y4m_header(recorder_t* recorder) {
+    char header[96];
+    int n = snprintf(header, sizeof(header), "YUV4MPEG2 W%u H%u F%u:%u Ip A1:1 C444\n",
+                     VGA_NATIVE_WIDTH * recorder->scale, recorder->lines, recorder->hz,
+                     (uint32_t)GIGATRON_CYCLES_PER_FRAME);
+    if (n <= 0 || fwrite(header, 1, (size_t)n, recorder->video_file) != (size_t)n) return false;
+    recorder->video_bytes += (uint64_t)n;
+    return true;
+}
+
+/**
+ * Convert a frame to Y4M planes, each color widened to `scale` pixels
+ */
+static void recorder_encode_y4m(recorder_t* recorder, const uint8_t* pixels) {
+    const uint32_t scale = recorder->scale;
+    const uint32_t plane = VGA_NATIVE_WIDTH * scale * recorder->lines;
+    for (uint32_t c = 0; c < 3; c++) {
+        uint8_t* out = recorder->encoded + c * plane;
+        for (uint32_t i = 0; i < VGA_NATIVE_WIDTH * recorder->lines; i++) {
+            uint8_t value = recorder->yuv[pixels[i] & 0x3F][c];
+            for (uint32_t s = 0; s < scale; s++) {
+                *out++ = value;
+            }
+        }
+    }
+}
+
+/**
+ * Write one queued frame and the repeats before it
+ */
+static bool recorder_write_frame(recorder_t* recorder, const recorder_frame_t* frame) {
+    FILE* file = recorder->video_file;
+    const uint32_t size = VGA_NATIVE_WIDTH * recorder->lines;
+    
+    if (recorder->video == RECORDER_VIDEO_Y4M) {
+        const uint32_t encoded = size * recorder->scale * 3;
+        static const char tag[] = "FRAME\n";
+        for (uint32_t i = 0; i < frame->repeats; i++) {
+            if (fwrite(tag, 1, sizeof(tag) - 1, file) != sizeof(tag) - 1) return false;
+            if (fwrite(recorder->encoded, 1, encoded, file) != encoded) return false;
+            recorder->video_bytes += sizeof(tag) - 1 + encoded;
+        }
+        if (frame->has_pixels) {
+            recorder_encode_y4m(recorder, frame->pixels);
+            if (fwrite(tag, 1, sizeof(tag) - 1, file) != sizeof(tag) - 1) return false;
+            if (fwrite(recorder->encoded, 1, encoded, file) != encoded) return false;
+            recorder->video_bytes += sizeof(tag) - 1 + encoded;
+        }
+        return true;
+    }
+    
+    if (frame->repeats) {
+        uint8_t record[5] = { 'R' };
+        recorder_put32(&record[1], frame->repeats);
+        if (fwrite(record, 1, sizeof(record), file) != sizeof(record)) return false;
+        recorder->video_bytes += sizeof(record);
+    }
+    if (frame->has_pixels) {
+        if (fputc('F', file) == EOF) return false;
+        if (fwrite(frame->pixels, 1, size, file) != size) return false;
+        recorder->video_bytes += 1 + size;
+    }
+    return true;
+}
+
+/**
+ * Write the converted samples
+ */
+static bool recorder_flush_pcm(recorder_t* recorder) {
+    uint32_t n = recorder->pcm_count;
+    recorder->pcm_count = 0;
+    if (fwrite(recorder->pcm, 2, n, recorder->audio_file) != n) return false;
+    recorder->audio_bytes += n * 2;
+    return true;
+}
+
+/**
+ * Resample one input sample to the nominal rate. Input samples lie period
+ * nominal periods apart; each output instant up to this sample is
+ * interpolated linearly from the previous one. A period of 1.0 passes the
+ * input through unchanged.
+ */
+static bool recorder_resample(recorder_t* recorder, float sample, float period) {
+    float last = recorder->resample_last;
+    double phase = recorder->resample_phase;
+    while (phase <= period) {
+        float value = last + (sample - last) * (float)(phase / period);
+        value = (value > 1.0f) ? 1.0f : ((value < -1.0f) ? -1.0f : value);
+        uint8_t* p = (uint8_t*)&recorder->pcm[recorder->pcm_count];
+        recorder_put16(p, (uint16_t)(int16_t)(value * 32767.0f));
+        if (++recorder->pcm_count == RECORDER_PCM_CHUNK && !recorder_flush_pcm(recorder)) return false;
+        phase += 1.0;
+    }
+    recorder->resample_phase = phase - period;
+    recorder->resample_last = sample;
+    recorder->resample_period = period;
+    return true;
+}
+
+/**
+ * Resample queued samples to 16-bit PCM and write them
+ */
+static bool recorder_write_samples(recorder_t* recorder, uint32_t read, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t index = (read + i) & (RECORDER_RING_SAMPLES - 1);
+        if (!recorder_resample(recorder, recorder->samples[index], recorder->periods[index])) return false;
+    }
+    return recorder_flush_pcm(recorder);
+}
+
+/**
+ * Write samples of silence in place of dropped ones
+ */
+static bool recorder_write_silence(recorder_t* recorder, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (!recorder_resample(recorder, 0.0f, recorder->resample_period)) return false;
+    }
+    return recorder_flush_pcm(recorder);
+}
+
+/**
+ * Writer thread: drain both rings until closed
+ */
+static void recorder_thread(recorder_t* recorder) {
+    for (;;) {
+        bool closing = GIGATRON_LOAD_ACQUIRE(&recorder->closing) != 0;
+        bool idle = true;
+        
+        uint32_t read = recorder->frame_read;
+        uint32_t write = GIGATRON_LOAD_ACQUIRE(&recorder->frame_write);
+        if (read != write) {
+            const recorder_frame_t* frame = &recorder->ring[read & (RECORDER_RING_FRAMES - 1)];
+            if (!recorder->error && !recorder_write_frame(recorder, frame)) {
+                recorder->error = 1;
+            }
+            GIGATRON_STORE_RELEASE(&recorder->frame_read, read + 1);
+            idle = false;
+        }
+        
+        /*
+         * Silence follows the samples queued before the drop. The producer
+         * queues nothing while silence is pending, so once the ring is
+         * empty all of it is due.
+         */
+        uint32_t silence = GIGATRON_LOAD_ACQUIRE(&recorder->silence_write);
+        read = recorder->sample_read;
+        write = GIGATRON_LOAD_ACQUIRE(&recorder->sample_write);
+        if (read != write) {
+            if (!recorder->error && !recorder_write_samples(recorder, read, write - read)) {
+                recorder->error = 1;
+            }
+            GIGATRON_STORE_RELEASE(&recorder->sample_read, write);
+            idle = false;
+        } else if (silence != recorder->silence_read) {
+            if (!recorder->error && !recorder_write_silence(recorder, silence - recorder->silence_read)) {
+                recorder->error = 1;
+            }
+            GIGATRON_STORE_RELEASE(&recorder->silence_read, silence);
+            idle = false;
+        }
+        
+        /* Closing is set after the last frame and samples were published */
+        if (idle) {
+            if (closing) break;
+            recorder_sleep_ms(1);
+        }
+    }
+}
+
+/*
+ * Producer
+ */
+
+/**
+ * Get default settings
+ */
+recorder_config_t recorder_default_config(void) {
+    recorder_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.video = RECORDER_VIDEO_INDEXED;
+    config.scale = VGA_MAX_SCALE;
+    config.sample_rate = 44100;
+    return config;
+}
+
+/**
+ * Free the recorder's buffers
+ */
+static void recorder_free(recorder_t* recorder) {
+    if (recorder->ring) {
+        for (uint32_t i = 0; i < RECORDER_RING_FRAMES; i++) {
+            free(recorder->ring[i].pixels);
+        }
+    }
+    free(recorder->ring);
+    free(recorder->samples);
+    free(recorder->periods);
+    free(recorder->frame);
+    free(recorder->encoded);
+    free(recorder->pcm);
+    recorder->ring = NULL;
+    recorder->samples = NULL;
+    recorder->periods = NULL;
+    recorder->frame = NULL;
+    recorder->encoded = NULL;
+    recorder->pcm = NULL;
+}
+
+/**
+ * Close the files after a failed open
+ */
+static void recorder_abort(recorder_t* recorder) {
+    if (recorder->video_file) fclose(recorder->video_file);
+    if (recorder->audio_file) fclose(recorder->audio_file);
+    recorder->video_file = NULL;
+    recorder->audio_file = NULL;
+    recorder_free(recorder);
+}
+
+/**
+ * Create the files and start the writer thread
+ */
+bool recorder_open(recorder_t* recorder, const recorder_config_t* config, uint32_t hz) {
+    if (!recorder || !config) return false;
+    if (config->scale != 1 && config->scale != 2 && config->scale != 4) return false;
+    if (config->video != RECORDER_VIDEO_NONE && !config->video_path) return false;
+    if (config->video == RECORDER_VIDEO_NONE && !config->audio_path) return false;
+    
+    memset(recorder, 0, sizeof(recorder_t));
+    recorder->video = config->video;
+    recorder->scale = config->scale;
+    recorder->lines = VGA_NATIVE_HEIGHT * config->scale;
+    recorder->hz = hz;
+    recorder->sample_rate = config->sample_rate;
+    recorder->wait = config->wait;
+    recorder->resample_phase = 1.0;
+    recorder->resample_period = 1.0f;
+    
+    /* Palette in BT.601 limited range YCbCr */
+    for (uint32_t color = 0; color < 64; color++) {
+        uint8_t r, g, b;
+        vga_color_to_rgba((uint8_t)color, &r, &g, &b);
+        recorder->yuv[color][0] = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        recorder->yuv[color][1] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+        recorder->yuv[color][2] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+    }
+    
+    const uint32_t size = VGA_NATIVE_WIDTH * recorder->lines;
+    recorder->ring = (recorder_frame_t*)calloc(RECORDER_RING_FRAMES, sizeof(recorder_frame_t));
+    recorder->samples = (float*)malloc(RECORDER_RING_SAMPLES * sizeof(float));
+    recorder->periods = (float*)malloc(RECORDER_RING_SAMPLES * sizeof(float));
+    recorder->frame = (uint8_t*)calloc(size, 1);
+    recorder->encoded = (uint8_t*)malloc(size * recorder->scale * 3);
+    recorder->pcm = (int16_t*)malloc(RECORDER_PCM_CHUNK * sizeof(int16_t));
+    bool ok = recorder->ring && recorder->samples && recorder->periods && recorder->frame &&
+              recorder->encoded && recorder->pcm;
+    for (uint32_t i = 0; ok && i < RECORDER_RING_FRAMES; i++) {
+        recorder->ring[i].pixels = (uint8_t*)malloc(size);
+        ok = recorder->ring[i].pixels != NULL;
+    }
+    if (!ok) {
+        recorder_free(recorder);
+        return false;
+    }
+    
+    if (config->video != RECORDER_VIDEO_NONE) {
+        recorder->video_file = fopen(config->video_path, "wb");
+        ok = recorder->video_file &&
+             (config->video == RECORDER_VIDEO_Y4M ? recorder_write_y4m_header(recorder) :
+                                                    recorder_write_indexed_header(recorder));
+    }
+    if (ok && config->audio_path) {
+        recorder->audio_file = fopen(config->audio_path, "wb");
+        ok = recorder->audio_file && recorder_write_wav_header(recorder, 0);
+        if (ok) recorder->audio_bytes = RECORDER_WAV_HEADER;
+    }
+    if (!ok || !(recorder->thread = recorder_thread_start(recorder))) {
+        recorder_abort(recorder);
+        return false;
+    }
+    
+    return true;
+}
+
+/**
+ * Copy a visible scanline into the frame being drawn
+ */
+void recorder_scanline(void* user_data, uint16_t row, const uint8_t* pixels) {
+    recorder_t* recorder = (recorder_t*)user_data;
+    if (!pixels || row < VGA_V_BACK_PORCH) return;
+    
+    /* Every (4 / scale)-th line of each 4-line group */
+    uint32_t line = row - VGA_V_BACK_PORCH;
+    uint32_t step = VGA_MAX_SCALE / recorder->scale;
+    if (line >= RECORDER_MAX_LINES || line % step) return;
+    memcpy(recorder->frame + (line / step) * VGA_NATIVE_WIDTH, pixels, VGA_NATIVE_WIDTH);
+}
+
+/**
+ * Queue samples
+ */
+void recorder_audio(void* user_data, const float* samples, uint32_t count, float period) {
+    recorder_t* recorder = (recorder_t*)user_data;
+    if (!recorder->audio_file) return;
+    
+    /* Until the writer caught up with earlier silence, new samples join it */
+    uint32_t silence = recorder->silence_write;
+    if (silence != GIGATRON_LOAD_ACQUIRE(&recorder->silence_read)) {
+        recorder->dropped_samples += count;
+        GIGATRON_STORE_RELEASE(&recorder->silence_write, silence + count);
+        return;
+    }
+    
+    uint32_t write = recorder->sample_write;
+    uint32_t space = RECORDER_RING_SAMPLES - (write - GIGATRON_LOAD_ACQUIRE(&recorder->sample_read));
+    while (recorder->wait && count > space) {
+        recorder->stalls++;
+        recorder_yield();
+        space = RECORDER_RING_SAMPLES - (write - GIGATRON_LOAD_ACQUIRE(&recorder->sample_read));
+    }
+    uint32_t dropped = count > space ? count - space : 0;
+    count -= dropped;
+    
+    uint32_t start = write & (RECORDER_RING_SAMPLES - 1);
+    uint32_t first = RECORDER_RING_SAMPLES - start;
+    if (first > count) first = count;
+    memcpy(recorder->samples + start, samples, first * sizeof(float));
+    memcpy(recorder->samples, samples + first, (count - first) * sizeof(float));
+    for (uint32_t i = 0; i < count; i++) {
+        recorder->periods[(write + i) & (RECORDER_RING_SAMPLES - 1)] = period;
+    }
+    
+    recorder->recorded_samples += count;
+    GIGATRON_STORE_RELEASE(&recorder->sample_write, write + count);
+    
+    /* Keep the audio as long as the video: the rest becomes silence */
+    if (dropped) {
+        recorder->dropped_samples += dropped;
+        GIGATRON_STORE_RELEASE(&recorder->silence_write, silence + dropped);
+    }
+}
+
+/**
+ * Queue a frame (has_pixels == false for repeats only), returns false if the ring is full
+ */
+static bool recorder_queue(recorder_t* recorder, bool has_pixels) {
+    uint32_t write = recorder->frame_write;
+    while (write - GIGATRON_LOAD_ACQUIRE(&recorder->frame_read) >= RECORDER_RING_FRAMES) {
+        if (!recorder->wait) return false;
+        recorder->stalls++;
+        recorder_yield();
+    }
+    
+    recorder_frame_t* frame = &recorder->ring[write & (RECORDER_RING_FRAMES - 1)];
+    if (has_pixels) {
+        memcpy(frame->pixels, recorder->frame, VGA_NATIVE_WIDTH * recorder->lines);
+    }
+    frame->has_pixels = has_pixels;
+    frame->repeats = recorder->repeats;
+    recorder->repeats = 0;
+    GIGATRON_STORE_RELEASE(&recorder->frame_write, write + 1);
+    return true;
+}
+
+/**
+ * Close the frame drawn since the last call
+ */
+void recorder_end_frame(recorder_t* recorder, uint64_t frame_hash) {
+    if (!recorder) return;
+    
+    recorder->frames++;
+    if (!recorder->video_file) return;
+    
+    /* A static screen costs a counter, not a queued frame */
+    if (recorder->has_last && frame_hash == recorder->last_hash) {
+        recorder->repeats++;
+        recorder->elided++;
+        return;
+    }
+    
+    /* A frame that does not fit is shown as the previous one */
+    if (!recorder_queue(recorder, true)) {
+        recorder->repeats++;
+        recorder->dropped_frames++;
+        return;
+    }
+    recorder->last_hash = frame_hash;
+    recorder->has_last = true;
+}
+
+/**
+ * Flush, stop the writer thread and close the files
+ */
+bool recorder_close(recorder_t* recorder) {
+    if (!recorder || !recorder->thread) return false;
+    
+    /* The last repeats go out on their own, waiting for room if needed */
+    if (recorder->repeats) {
+        recorder->wait = true;
+        recorder_queue(recorder, false);
+    }
+    GIGATRON_STORE_RELEASE(&recorder->closing, 1);
+    recorder_thread_join(recorder->thread);
+    recorder->thread = NULL;
+    
+    bool ok = !recorder->error;
+    if (recorder->audio_file) {
+        /* Sizes in the WAV header are known now */
+        uint64_t data_bytes = recorder->audio_bytes - RECORDER_WAV_HEADER;
+        if (data_bytes > UINT32_MAX - 36) data_bytes = UINT32_MAX - 36;
+        if (RECORDER_FSEEK(recorder->audio_file, 0, SEEK_SET) != 0 ||
+            !recorder_write_wav_header(recorder, (uint32_t)data_bytes)) {
+            ok = false;
+        }
+        if (fclose(recorder->audio_file) != 0) ok = false;
+        recorder->audio_file = NULL;
+    }
+    if (recorder->video_file) {
+        if (fclose(recorder->video_file) != 0) ok = false;
+        recorder->video_file = NULL;
+    }
+    recorder_free(recorder);
+    return ok;
+}
+
+/**
+ * Get display name of a video format
+ */
+const char* recorder_video_name(recorder_video_t video) {
+    switch (video) {
+        case RECORDER_VIDEO_NONE:    return "None";
+        case RECORDER_VIDEO_Y4M:     return "Y4M";
+        case RECORDER_VIDEO_INDEXED: return "Indexed";
+        default:                     return "?";
+    }
+}
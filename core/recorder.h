@@ -0,0 +1,168 @@
+/**
+ * Gigatron Video and Audio Recorder
+ *
+ * Streams the emulated picture and sound to disk: video as YUV4MPEG2
+ * (raw 4:4:4, readable by ffmpeg and most players) or as indexed frames
+ * (6-bit colors plus a palette), audio as 16-bit mono WAV.
+ *
+ * The emulation hands over scanlines and samples through the VGA scanline
+ * and audio sample callbacks and closes each frame at VSYNC. Frames whose
+ * VGA frame hash equals the previous one are not queued, only counted. Encoding and
+ * file I/O run on a writer thread fed by lock-free rings, so a slow disk
+ * makes the recorder drop (or, for headless recording, wait) instead of
+ * stalling the emulation. Samples arrive at the rate control's output rate
+ * and the writer thread resamples them to the nominal rate, so playback
+ * keeps its rate control while the WAV stays in step with the video.
+ *
+ * Indexed file layout: a header ("GTVIDEO\0", version, width, height,
+ * frame rate as hz / cycles per frame, 64 RGB palette entries), then
+ * records: 'F' and width * height color bytes for a frame, or 'R' and a
+ * 32-bit count for the previous frame shown that many more times.
+ */
+
+#ifndef GIGATRON_RECORDER_H
+#define GIGATRON_RECORDER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RECORDER_VERSION        1
+#define RECORDER_RING_FRAMES    16          /* Frames queued for the writer thread, power of two */
+#define RECORDER_RING_SAMPLES   (1 << 16)   /* Samples queued for the writer thread, power of two */
+#define RECORDER_CACHE_LINE     64
+
+/**
+ * Video file formats
+ */
+typedef enum recorder_video_t {
+    RECORDER_VIDEO_NONE = 0,
+    RECORDER_VIDEO_Y4M,         /* YUV4MPEG2, C444 */
+    RECORDER_VIDEO_INDEXED      /* 6-bit colors with palette, repeats run-length coded */
+} recorder_video_t;
+
+/**
+ * Recording settings
+ */
+typedef struct recorder_config_t {
+    recorder_video_t video;
+    const char* video_path;     /* Ignored for RECORDER_VIDEO_NONE */
+    uint32_t scale;             /* 1 (160x120), 2 (320x240) or 4 (640x480) */
+    const char* audio_path;     /* WAV file, NULL for no audio */
+    uint32_t sample_rate;
+    bool wait;                  /* Wait for the writer instead of dropping (headless) */
+} recorder_config_t;
+
+/**
+ * Queued frame
+ */
+typedef struct recorder_frame_t {
+    uint8_t* pixels;            /* 160 colors per recorded line */
+    uint32_t repeats;           /* Times the previous frame is shown again before this one */
+    bool has_pixels;            /* False for a final run of repeats */
+} recorder_frame_t;
+
+/**
+ * Recorder.
+ * Lock-free single producer (the emulation) / single consumer (the writer
+ * thread) rings of frames and samples, positions as in audio_buffer_t.
+ */
+typedef struct recorder_t {
+    FILE* video_file;
+    FILE* audio_file;
+    void* thread;
+    recorder_video_t video;
+    uint32_t scale;
+    uint32_t lines;             /* Recorded lines per frame (120 * scale) */
+    uint32_t hz;
+    uint32_t sample_rate;
+    bool wait;
+    recorder_frame_t* ring;
+    float* samples;
+    float* periods;             /* Length of each queued sample in nominal periods */
+    uint8_t pad0[RECORDER_CACHE_LINE];
+    uint32_t frame_write;       /* Owned by the producer */
+    uint32_t sample_write;
+    uint32_t silence_write;     /* Samples dropped so far, written as silence */
+    uint8_t pad1[RECORDER_CACHE_LINE - 3 * sizeof(uint32_t)];
+    uint32_t frame_read;        /* Owned by the writer thread */
+    uint32_t sample_read;
+    uint32_t silence_read;
+    uint32_t closing;
+    uint32_t error;             /* Set by the writer thread on a failed write */
+    uint8_t pad2[RECORDER_CACHE_LINE - 5 * sizeof(uint32_t)];
+    
+    /* Frame assembly (producer) */
+    uint8_t* frame;             /* Frame being drawn */
+    uint64_t last_hash;         /* VGA frame hash of the last frame queued */
+    bool has_last;
+    uint32_t repeats;           /* Frames equal to the last, not queued yet */
+    
+    /* Encoder (writer thread) */
+    uint8_t* encoded;           /* Last Y4M frame, written again for repeats */
+    int16_t* pcm;
+    uint32_t pcm_count;         /* Converted samples not written yet */
+    double resample_phase;      /* Next output instant after the last input sample */
+    float resample_last;        /* Last input sample */
+    float resample_period;      /* Its period, also used for silence */
+    uint8_t yuv[64][3];
+    
+    /* Statistics */
+    uint64_t frames;            /* Frames recorded, repeats included */
+    uint64_t elided;            /* Frames recorded as repeats of the previous one */
+    uint64_t dropped_frames;    /* Frames lost to a full queue (recorded as repeats) */
+    uint64_t recorded_samples;
+    uint64_t dropped_samples;   /* Samples lost to a full queue (recorded as silence) */
+    uint64_t stalls;            /* Waits for the writer (wait mode) */
+    uint64_t video_bytes;       /* Updated by the writer thread */
+    uint64_t audio_bytes;       /* Updated by the writer thread */
+} recorder_t;
+
+/**
+ * Default settings: indexed video at full VGA resolution, no audio.
+ */
+recorder_config_t recorder_default_config(void);
+
+/**
+ * Create the files and start the writer thread. hz is the CPU clock rate
+ * (frames last GIGATRON_CYCLES_PER_FRAME cycles).
+ * Returns true on success, false on failure.
+ */
+bool recorder_open(recorder_t* recorder, const recorder_config_t* config, uint32_t hz);
+
+/**
+ * Scanline callback for vga_set_scanline_callback (user_data is the recorder).
+ */
+void recorder_scanline(void* recorder, uint16_t row, const uint8_t* pixels);
+
+/**
+ * Sample callback for audio_set_sample_callback (user_data is the recorder).
+ */
+void recorder_audio(void* recorder, const float* samples, uint32_t count, float period);
+
+/**
+ * Close the frame drawn since the last call (call at each VSYNC).
+ * frame_hash is vga_get_frame_hash() of that frame.
+ */
+void recorder_end_frame(recorder_t* recorder, uint64_t frame_hash);
+
+/**
+ * Flush the queues, stop the writer thread and close the files.
+ * Returns false if any write failed. Statistics stay valid.
+ */
+bool recorder_close(recorder_t* recorder);
+
+/**
+ * Get display name of a video format.
+ */
+const char* recorder_video_name(recorder_video_t video);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GIGATRON_RECORDER_H */
@@ -0,0 +1,83 @@
+/**
+ * Gigatron Emulation Scheduler
+ */
+
+#include "scheduler.h"
+#include <string.h>
+
+/**
+ * Initialize scheduler
+ */
+void scheduler_init(scheduler_t* sched, uint32_t hz, uint32_t sample_rate, uint32_t target_samples) {
+    if (!sched) return;
+    
+    memset(sched, 0, sizeof(scheduler_t));
+    
+    sched->hz = hz;
+    sched->sample_rate = sample_rate;
+    sched->target_samples = target_samples ? target_samples : 1;
+    sched->kp = SCHEDULER_KP;
+    sched->ki = SCHEDULER_KI;
+    
+    scheduler_reset(sched);
+}
+
+/**
+ * Reset controller state
+ */
+void scheduler_reset(scheduler_t* sched) {
+    if (!sched) return;
+    
+    sched->integral = 0.0;
+    sched->fill = 0.0;
+    sched->primed = false;
+    sched->cycle_carry = 0.0;
+    sched->speed = 1.0;
+    sched->fill_error = 0;
+}
+
+/**
+ * Get the number of CPU cycles to run for a host frame
+ */
+uint32_t scheduler_next_cycles(scheduler_t* sched, double elapsed, uint32_t available) {
+    if (!sched || elapsed <= 0.0) return 0;
+    
+    if (elapsed > SCHEDULER_MAX_FRAME_TIME) {
+        elapsed = SCHEDULER_MAX_FRAME_TIME;
+    }
+    
+    /* Produce the target fill at once instead of slowly ramping up */
+    double prefill = 0.0;
+    if (!sched->primed) {
+        sched->primed = true;
+        sched->fill = (double)sched->target_samples;
+        if (available < sched->target_samples) {
+            prefill = (double)(sched->target_samples - available) * sched->hz / sched->sample_rate;
+        }
+    }
+    
+    sched->fill += (elapsed / (SCHEDULER_FILL_TAU + elapsed)) * ((double)available - sched->fill);
+    
+    /* Positive when the buffer runs low and emulation must speed up */
+    sched->fill_error = (int32_t)sched->target_samples - (int32_t)sched->fill;
+    double error = (double)sched->fill_error / (double)sched->target_samples;
+    
+    double adjust = sched->kp * error + sched->ki * sched->integral;
+    
+    /* Only integrate while not saturated (anti-windup) */
+    if (adjust > SCHEDULER_MAX_ADJUST) {
+        adjust = SCHEDULER_MAX_ADJUST;
+    } else if (adjust < -SCHEDULER_MAX_ADJUST) {
+        adjust = -SCHEDULER_MAX_ADJUST;
+    } else {
+        sched->integral += error * elapsed;
+    }
+    
+    /* Cycles the audio device consumed in this frame, corrected for fill */
+    sched->speed = 1.0 + adjust;
+    double cycles = (double)sched->hz * elapsed * sched->speed + prefill + sched->cycle_carry;
+    uint32_t whole = (uint32_t)cycles;
+    sched->cycle_carry = cycles - (double)whole;
+    
+    return whole;
+}
@@ -0,0 +1,97 @@
+/**
+ * Gigatron Emulation Scheduler
+ * 
+ * Audio-clock-driven pacing: decides how many CPU cycles to run per host
+ * frame so that the audio buffer stays at a target fill level. The audio
+ * device's consumption sets the emulation speed, so there is no drift
+ * between the Gigatron's ~59.98 Hz frame rate and the host display.
+ */
+
+#ifndef GIGATRON_SCHEDULER_H
+#define GIGATRON_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Controller defaults */
+#define SCHEDULER_KP                0.01    /* Speed correction per relative fill error */
+#define SCHEDULER_KI                0.005   /* Integral gain (per second) */
+#define SCHEDULER_MAX_ADJUST        0.005   /* Speed limited to 1 +/- this (inaudible pitch shift) */
+#define SCHEDULER_FILL_TAU          0.25    /* Fill smoothing time constant (seconds) */
+#define SCHEDULER_MAX_FRAME_TIME    0.1     /* Longer host frames are not caught up (seconds) */
+
+/**
+ * Scheduler state
+ */
+typedef struct scheduler_t {
+    /* Clocks */
+    uint32_t hz;
+    uint32_t sample_rate;
+    
+    /* Buffer fill the controller aims for (samples) */
+    uint32_t target_samples;
+    
+    /* PI controller on the relative fill error */
+    double kp;
+    double ki;
+    double integral;
+    
+    /*
+     * Smoothed buffer fill: the device drains whole periods at once, the
+     * raw fill is a sawtooth
+     */
+    double fill;
+    bool primed;            /* Initial target fill has been produced */
+    
+    /* Fractional cycles carried to the next frame */
+    double cycle_carry;
+    
+    /* Telemetry */
+    double speed;           /* Last emulation speed relative to real time */
+    int32_t fill_error;     /* Last target - available (samples) */
+} scheduler_t;
+
+/**
+ * Initialize scheduler.
+ * target_samples should cover the audio device's period plus one host frame.
+ * The first frame after init/reset runs ahead to fill the buffer to target.
+ */
+void scheduler_init(scheduler_t* sched, uint32_t hz, uint32_t sample_rate, uint32_t target_samples);
+
+/**
+ * Reset controller state (e.g. after a pause).
+ */
+void scheduler_reset(scheduler_t* sched);
+
+/**
+ * Get the number of CPU cycles to run for a host frame.
+ * elapsed is the host time since the previous call in seconds,
+ * available the number of samples currently buffered.
+ */
+uint32_t scheduler_next_cycles(scheduler_t* sched, double elapsed, uint32_t available);
+
+/**
+ * Set target buffer fill (samples).
+ */
+static inline void scheduler_set_target(scheduler_t* sched, uint32_t target_samples) {
+    if (sched && target_samples > 0) {
+        sched->target_samples = target_samples;
+    }
+}
+
+/**
+ * Get last emulation speed relative to real time.
+ */
+static inline double scheduler_get_speed(const scheduler_t* sched) {
+    return sched ? sched->speed : 0.0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GIGATRON_SCHEDULER_H */
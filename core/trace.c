@@ -0,0 +1,751 @@
+/**
+ * Gigatron Execution Trace
+ */
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L     /* pthreads, nanosleep, sched_yield */
+#endif
+
+#include "trace.h"
+#include "gigatron_atomic.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+/* 64-bit file offsets */
+#if defined(_WIN32)
+#define TRACE_FSEEK(f, offset, origin)  _fseeki64((f), (__int64)(offset), (origin))
+#else
+#define TRACE_FSEEK(f, offset, origin)  fseeko((f), (off_t)(offset), (origin))
+#endif
+
+#define TRACE_MAGIC             "GTTRACE"
+#define TRACE_HEADER_SIZE       16
+#define TRACE_BLOCK_HEADER_SIZE 32
+#define TRACE_BLOCK_MAGIC       0x4B4C4254u     /* "TBLK" */
+#define TRACE_BLOCK_PACKED      0x01            /* Payload is LZ compressed */
+#define TRACE_MAX_RECORD        13              /* Flags, PC, IR, 5 registers, write */
+#define TRACE_PACKED_SIZE       (TRACE_BLOCK_SIZE + TRACE_BLOCK_SIZE / 255 + 16)
+#define TRACE_ADDRESSES         (1 << 16)
+
+/* Record flags: which fields follow the flags byte */
+#define TRACE_F_PC      0x01    /* PC is not the previous PC + 1 */
+#define TRACE_F_IR      0x02    /* IR differs from the last one at this PC in the block */
+#define TRACE_F_AC      0x04
+#define TRACE_F_X       0x08
+#define TRACE_F_Y       0x10
+#define TRACE_F_OUT     0x20
+#define TRACE_F_OUTX    0x40
+#define TRACE_F_WRITE   0x80    /* Address and value follow */
+
+/* LZ compression: 4-byte minimum matches within a 64K window */
+#define TRACE_LZ_MIN_MATCH  4
+#define TRACE_LZ_HASH_BITS  12
+#define TRACE_LZ_LAST       5       /* Bytes at the end always stored as literals */
+
+/*
+ * Little-endian field access
+ */
+
+static inline void trace_put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void trace_put32(uint8_t* p, uint32_t v) {
+    trace_put16(p, (uint16_t)v);
+    trace_put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static inline uint16_t trace_get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t trace_get32(const uint8_t* p) {
+    return (uint32_t)trace_get16(p) | ((uint32_t)trace_get16(p + 2) << 16);
+}
+
+static inline uint32_t trace_read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/*
+ * Threads
+ */
+
+static void trace_sleep_ms(uint32_t ms) {
+#if defined(_WIN32)
+    Sleep(ms);
+#else
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ms / 1000);
+    ts.tv_nsec = (long)(ms % 1000) * 1000000L;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+static void trace_yield(void) {
+#if defined(_WIN32)
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+static void trace_writer_thread(trace_writer_t* writer);
+
+#if defined(_WIN32)
+static DWORD WINAPI trace_thread_entry(LPVOID arg) {
+    trace_writer_thread((trace_writer_t*)arg);
+    return 0;
+}
+#else
+static void* trace_thread_entry(void* arg) {
+    trace_writer_thread((trace_writer_t*)arg);
+    return NULL;
+}
+#endif
+
+/**
+ * Start the writer thread, returns its handle or NULL
+ */
+static void* trace_thread_start(trace_writer_t* writer) {
+#if defined(_WIN32)
+    return (void*)CreateThread(NULL, 0, trace_thread_entry, writer, 0, NULL);
+#else
+    pthread_t* thread = (pthread_t*)malloc(sizeof(pthread_t));
+    if (thread && pthread_create(thread, NULL, trace_thread_entry, writer) != 0) {
+        free(thread);
+        thread = NULL;
+    }
+    return thread;
+#endif
+}
+
+/**
+ * Wait for the writer thread to finish
+ */
+static void trace_thread_join(void* thread) {
+#if defined(_WIN32)
+    WaitForSingleObject((HANDLE)thread, INFINITE);
+    CloseHandle((HANDLE)thread);
+#else
+    pthread_join(*(pthread_t*)thread, NULL);
+    free(thread);
+#endif
+}
+
+/*
+ * Block compression (byte-oriented LZ77 in the LZ4 sequence layout:
+ * token with literal and match length nibbles, literals, 16-bit offset)
+ */
+
+/**
+ * Write a length continuation (nibble was 15)
+ */
+static inline uint32_t trace_lz_put_length(uint8_t* dst, uint32_t op, uint32_t length) {
+    while (length >= 255) {
+        dst[op++] = 255;
+        length -= 255;
+    }
+    dst[op++] = (uint8_t)length;
+    return op;
+}
+
+/**
+ * Emit one sequence, returns the new output position or 0 if it does not fit
+ */
+static uint32_t trace_lz_sequence(uint8_t* dst, uint32_t op, uint32_t capacity,
+                                  const uint8_t* literals, uint32_t num_literals,
+                                  uint32_t offset, uint32_t match) {
+    if (op + 1 + num_literals + num_literals / 255 + 1 + 2 + match / 255 + 1 > capacity) return 0;
+    
+    uint32_t match_code = match ? match - TRACE_LZ_MIN_MATCH : 0;
+    uint8_t* token = &dst[op++];
+    *token = (uint8_t)(((num_literals < 15 ? num_literals : 15) << 4) | (match_code < 15 ? match_code : 15));
+    if (num_literals >= 15) {
+        op = trace_lz_put_length(dst, op, num_literals - 15);
+    }
+    memcpy(&dst[op], literals, num_literals);
+    op += num_literals;
+    
+    if (match) {
+        trace_put16(&dst[op], (uint16_t)offset);
+        op += 2;
+        if (match_code >= 15) {
+            op = trace_lz_put_length(dst, op, match_code - 15);
+        }
+    }
+    return op;
+}
+
+/**
+ * Compress src, returns the compressed size or 0 if it would not be smaller
+ */
+static uint32_t trace_lz_compress(const uint8_t* src, uint32_t size, uint8_t* dst, uint32_t capacity,
+                                  uint32_t* table) {
+    if (capacity > size) capacity = size;
+    memset(table, 0, sizeof(uint32_t) << TRACE_LZ_HASH_BITS);
+    
+    uint32_t ip = 0;
+    uint32_t anchor = 0;
+    uint32_t op = 0;
+    uint32_t limit = size > TRACE_LZ_LAST ? size - TRACE_LZ_LAST : 0;
+    
+    while (ip + TRACE_LZ_MIN_MATCH <= limit) {
+        uint32_t sequence = trace_read32(&src[ip]);
+        uint32_t hash = (sequence * 2654435761u) >> (32 - TRACE_LZ_HASH_BITS);
+        uint32_t candidate = table[hash];       /* Position + 1, 0 if empty */
+        table[hash] = ip + 1;
+        
+        if (candidate == 0 || ip - (candidate - 1) > 0xFFFF ||
+            trace_read32(&src[candidate - 1]) != sequence) {
+            ip++;
+            continue;
+        }
+        
+        uint32_t match_pos = candidate - 1;
+        uint32_t match = TRACE_LZ_MIN_MATCH;
+        while (ip + match < limit && src[match_pos + match] == src[ip + match]) {
+            match++;
+        }
+        
+        op = trace_lz_sequence(dst, op, capacity, &src[anchor], ip - anchor, ip - match_pos, match);
+        if (op == 0) return 0;
+        ip += match;
+        anchor = ip;
+    }
+    
+    op = trace_lz_sequence(dst, op, capacity, &src[anchor], size - anchor, 0, 0);
+    return op < size ? op : 0;
+}
+
+/**
+ * Read a length continuation, returns false past the end of the input
+ */
+static inline bool trace_lz_get_length(const uint8_t* src, uint32_t size, uint32_t* ip, uint32_t* length) {
+    uint8_t byte;
+    do {
+        if (*ip >= size) return false;
+        byte = src[(*ip)++];
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/**
+ * Decompress exactly out_size bytes, returns false on corrupt input
+ */
+static bool trace_lz_decompress(const uint8_t* src, uint32_t size, uint8_t* dst, uint32_t out_size) {
+    uint32_t ip = 0;
+    uint32_t op = 0;
+    
+    while (ip < size) {
+        uint8_t token = src[ip++];
+        
+        uint32_t num_literals = token >> 4;
+        if (num_literals == 15 && !trace_lz_get_length(src, size, &ip, &num_literals)) return false;
+        if (num_literals > size - ip || num_literals > out_size - op) return false;
+        memcpy(&dst[op], &src[ip], num_literals);
+        ip += num_literals;
+        op += num_literals;
+        
+        /* The last sequence has no match */
+        if (ip == size) break;
+        
+        if (size - ip < 2) return false;
+        uint32_t offset = trace_get16(&src[ip]);
+        ip += 2;
+        uint32_t match = token & 0x0F;
+        if (match == 15 && !trace_lz_get_length(src, size, &ip, &match)) return false;
+        match += TRACE_LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || match > out_size - op) return false;
+        
+        /* Byte copy: the match may overlap its own output */
+        const uint8_t* from = &dst[op - offset];
+        for (uint32_t i = 0; i < match; i++) {
+            dst[op + i] = from[i];
+        }
+        op += match;
+    }
+    
+    return op == out_size;
+}
+
+/*
+ * Writer
+ */
+
+/**
+ * Compress and write one block (writer thread)
+ */
+static bool trace_write_block(trace_writer_t* writer, const trace_block_t* block) {
+    uint32_t packed_size = trace_lz_compress(block->data, block->size, writer->packed, TRACE_PACKED_SIZE,
+                                             writer->lz_table);
+    const uint8_t* payload = packed_size ? writer->packed : block->data;
+    uint32_t payload_size = packed_size ? packed_size : block->size;
+    
+    uint8_t header[TRACE_BLOCK_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    trace_put32(&header[0], TRACE_BLOCK_MAGIC);
+    trace_put32(&header[4], block->size);
+    trace_put32(&header[8], payload_size);
+    trace_put32(&header[12], block->count);
+    trace_put32(&header[16], (uint32_t)block->first_cycle);
+    trace_put32(&header[20], (uint32_t)(block->first_cycle >> 32));
+    trace_put16(&header[24], block->base.pc);
+    header[26] = block->base.ac;
+    header[27] = block->base.x;
+    header[28] = block->base.y;
+    header[29] = block->base.out;
+    header[30] = block->base.outx;
+    header[31] = packed_size ? TRACE_BLOCK_PACKED : 0;
+    
+    if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header)) return false;
+    if (fwrite(payload, 1, payload_size, writer->file) != payload_size) return false;
+    writer->file_bytes += sizeof(header) + payload_size;
+    return true;
+}
+
+/**
+ * Writer thread: drain the ring until closed
+ */
+static void trace_writer_thread(trace_writer_t* writer) {
+    const uint32_t mask = TRACE_RING_BLOCKS - 1;
+    
+    for (;;) {
+        uint32_t read = writer->read_pos;
+        uint32_t write = GIGATRON_LOAD_ACQUIRE(&writer->write_pos);
+        
+        if (read == write) {
+            /* Closing is set after the last block was published */
+            if (GIGATRON_LOAD_ACQUIRE(&writer->closing)) {
+                if (GIGATRON_LOAD_ACQUIRE(&writer->write_pos) == read) break;
+                continue;
+            }
+            trace_sleep_ms(1);
+            continue;
+        }
+        
+        if (!writer->error && !trace_write_block(writer, &writer->ring[read & mask])) {
+            writer->error = 1;
+        }
+        GIGATRON_STORE_RELEASE(&writer->read_pos, read + 1);
+    }
+}
+
+/**
+ * Free the writer's buffers
+ */
+static void trace_writer_free(trace_writer_t* writer) {
+    if (writer->ring) {
+        for (uint32_t i = 0; i < TRACE_RING_BLOCKS; i++) {
+            free(writer->ring[i].data);
+        }
+    }
+    free(writer->ring);
+    free(writer->ir_cache);
+    free(writer->ir_generation);
+    free(writer->packed);
+    free(writer->lz_table);
+    writer->ring = NULL;
+    writer->ir_cache = NULL;
+    writer->ir_generation = NULL;
+    writer->packed = NULL;
+    writer->lz_table = NULL;
+}
+
+/**
+ * Create a trace file and start its writer thread
+ */
+bool trace_writer_open(trace_writer_t* writer, const char* filename, uint32_t hz) {
+    if (!writer || !filename) return false;
+    
+    memset(writer, 0, sizeof(trace_writer_t));
+    
+    writer->ring = (trace_block_t*)calloc(TRACE_RING_BLOCKS, sizeof(trace_block_t));
+    writer->ir_cache = (uint16_t*)calloc(TRACE_ADDRESSES, sizeof(uint16_t));
+    writer->ir_generation = (uint32_t*)calloc(TRACE_ADDRESSES, sizeof(uint32_t));
+    writer->packed = (uint8_t*)malloc(TRACE_PACKED_SIZE);
+    writer->lz_table = (uint32_t*)malloc(sizeof(uint32_t) << TRACE_LZ_HASH_BITS);
+    bool ok = writer->ring && writer->ir_cache && writer->ir_generation && writer->packed && writer->lz_table;
+    for (uint32_t i = 0; ok && i < TRACE_RING_BLOCKS; i++) {
+        writer->ring[i].data = (uint8_t*)malloc(TRACE_BLOCK_SIZE);
+        ok = writer->ring[i].data != NULL;
+    }
+    if (!ok) {
+        trace_writer_free(writer);
+        return false;
+    }
+    
+    writer->file = fopen(filename, "wb");
+    if (!writer->file) {
+        trace_writer_free(writer);
+        return false;
+    }
+    
+    uint8_t header[TRACE_HEADER_SIZE];
+    memcpy(header, TRACE_MAGIC, 8);
+    trace_put32(&header[8], TRACE_VERSION);
+    trace_put32(&header[12], hz);
+    writer->file_bytes = sizeof(header);
+    
+    if (fwrite(header, 1, sizeof(header), writer->file) != sizeof(header) ||
+        !(writer->thread = trace_thread_start(writer))) {
+        fclose(writer->file);
+        writer->file = NULL;
+        trace_writer_free(writer);
+        return false;
+    }
+    
+    return true;
+}
+
+/**
+ * Hand the block being filled to the writer thread
+ */
+static void trace_publish_block(trace_writer_t* writer) {
+    if (!writer->block) return;
+    
+    writer->block = NULL;
+    GIGATRON_STORE_RELEASE(&writer->write_pos, writer->write_pos + 1);
+}
+
+/**
+ * Start a new block at record, waiting for a free one if needed
+ */
+static void trace_begin_block(trace_writer_t* writer, const trace_record_t* record) {
+    while (writer->write_pos - GIGATRON_LOAD_ACQUIRE(&writer->read_pos) >= TRACE_RING_BLOCKS) {
+        writer->stalls++;
+        trace_yield();
+    }
+    
+    trace_block_t* block = &writer->ring[writer->write_pos & (TRACE_RING_BLOCKS - 1)];
+    block->size = 0;
+    block->count = 0;
+    block->first_cycle = record->cycle;
+    block->base = writer->prev;
+    writer->block = block;
+    writer->generation++;
+}
+
+/**
+ * Append a record
+ */
+void trace_writer_put(trace_writer_t* writer, const trace_record_t* record) {
+    trace_block_t* block = writer->block;
+    trace_record_t* prev = &writer->prev;
+    
+    /* Blocks hold consecutive cycles and have room for any record */
+    if (block && (record->cycle != block->first_cycle + block->count ||
+                  block->size > TRACE_BLOCK_SIZE - TRACE_MAX_RECORD)) {
+        trace_publish_block(writer);
+        block = NULL;
+    }
+    if (!block) {
+        trace_begin_block(writer, record);
+        block = writer->block;
+    }
+    
+    uint8_t* out = &block->data[block->size];
+    uint8_t* p = out + 1;
+    uint8_t flags = 0;
+    
+    if (record->pc != (uint16_t)(prev->pc + 1)) {
+        flags |= TRACE_F_PC;
+        trace_put16(p, record->pc);
+        p += 2;
+    }
+    if (writer->ir_generation[record->pc] != writer->generation ||
+        writer->ir_cache[record->pc] != record->ir) {
+        flags |= TRACE_F_IR;
+        trace_put16(p, record->ir);
+        p += 2;
+        writer->ir_cache[record->pc] = record->ir;
+        writer->ir_generation[record->pc] = writer->generation;
+    }
+    if (record->ac != prev->ac) {
+        flags |= TRACE_F_AC;
+        *p++ = record->ac;
+    }
+    if (record->x != prev->x) {
+        flags |= TRACE_F_X;
+        *p++ = record->x;
+    }
+    if (record->y != prev->y) {
+        flags |= TRACE_F_Y;
+        *p++ = record->y;
+    }
+    if (record->out != prev->out) {
+        flags |= TRACE_F_OUT;
+        *p++ = record->out;
+    }
+    if (record->outx != prev->outx) {
+        flags |= TRACE_F_OUTX;
+        *p++ = record->outx;
+    }
+    if (record->flags & TRACE_RECORD_WRITE) {
+        flags |= TRACE_F_WRITE;
+        trace_put16(p, record->write_addr);
+        p[2] = record->write_value;
+        p += 3;
+    }
+    *out = flags;
+    
+    uint32_t size = (uint32_t)(p - out);
+    block->size += size;
+    block->count++;
+    writer->raw_bytes += size;
+    writer->records++;
+    *prev = *record;
+}
+
+/**
+ * Flush, stop the writer thread and close the file
+ */
+bool trace_writer_close(trace_writer_t* writer) {
+    if (!writer || !writer->file) return false;
+    
+    trace_publish_block(writer);
+    GIGATRON_STORE_RELEASE(&writer->closing, 1);
+    trace_thread_join(writer->thread);
+    writer->thread = NULL;
+    
+    bool ok = !writer->error;
+    if (fclose(writer->file) != 0) {
+        ok = false;
+    }
+    writer->file = NULL;
+    trace_writer_free(writer);
+    return ok;
+}
+
+/*
+ * Reader
+ */
+
+/**
+ * Open a trace file and index its blocks
+ */
+bool trace_reader_open(trace_reader_t* reader, const char* filename) {
+    if (!reader || !filename) return false;
+    
+    memset(reader, 0, sizeof(trace_reader_t));
+    
+    reader->file = fopen(filename, "rb");
+    if (!reader->file) return false;
+    
+    uint8_t header[TRACE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), reader->file) != sizeof(header) ||
+        memcmp(header, TRACE_MAGIC, 8) != 0 || trace_get32(&header[8]) != TRACE_VERSION) {
+        trace_reader_close(reader);
+        return false;
+    }
+    reader->hz = trace_get32(&header[12]);
+    
+    reader->data = (uint8_t*)malloc(TRACE_BLOCK_SIZE);
+    reader->packed = (uint8_t*)malloc(TRACE_PACKED_SIZE);
+    reader->ir_cache = (uint16_t*)calloc(TRACE_ADDRESSES, sizeof(uint16_t));
+    reader->ir_generation = (uint32_t*)calloc(TRACE_ADDRESSES, sizeof(uint32_t));
+    if (!reader->data || !reader->packed || !reader->ir_cache || !reader->ir_generation) {
+        trace_reader_close(reader);
+        return false;
+    }
+    
+    /* Index: walk the block headers (a truncated last block is dropped) */
+    uint32_t capacity = 0;
+    uint64_t offset = TRACE_HEADER_SIZE;
+    uint8_t block[TRACE_BLOCK_HEADER_SIZE];
+    while (fread(block, 1, sizeof(block), reader->file) == sizeof(block)) {
+        uint32_t stored = trace_get32(&block[8]);
+        if (trace_get32(&block[0]) != TRACE_BLOCK_MAGIC || trace_get32(&block[4]) > TRACE_BLOCK_SIZE ||
+            stored > TRACE_PACKED_SIZE || TRACE_FSEEK(reader->file, stored, SEEK_CUR) != 0) {
+            break;
+        }
+        
+        if (reader->num_blocks == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            trace_block_info_t* blocks = (trace_block_info_t*)realloc(reader->blocks,
+                                                                      capacity * sizeof(trace_block_info_t));
+            if (!blocks) {
+                trace_reader_close(reader);
+                return false;
+            }
+            reader->blocks = blocks;
+        }
+        
+        trace_block_info_t* info = &reader->blocks[reader->num_blocks++];
+        info->offset = offset;
+        info->first_cycle = (uint64_t)trace_get32(&block[16]) | ((uint64_t)trace_get32(&block[20]) << 32);
+        info->count = trace_get32(&block[12]);
+        reader->num_records += info->count;
+        offset += sizeof(block) + stored;
+    }
+    
+    return true;
+}
+
+/**
+ * Close the file and free the reader
+ */
+void trace_reader_close(trace_reader_t* reader) {
+    if (!reader) return;
+    
+    if (reader->file) {
+        fclose(reader->file);
+    }
+    free(reader->blocks);
+    free(reader->data);
+    free(reader->packed);
+    free(reader->ir_cache);
+    free(reader->ir_generation);
+    memset(reader, 0, sizeof(trace_reader_t));
+}
+
+/**
+ * Load and decompress the next block
+ */
+static bool trace_load_block(trace_reader_t* reader) {
+    if (reader->block >= reader->num_blocks) return false;
+    
+    const trace_block_info_t* info = &reader->blocks[reader->block++];
+    uint8_t header[TRACE_BLOCK_HEADER_SIZE];
+    if (TRACE_FSEEK(reader->file, info->offset, SEEK_SET) != 0 ||
+        fread(header, 1, sizeof(header), reader->file) != sizeof(header)) {
+        return false;
+    }
+    
+    uint32_t size = trace_get32(&header[4]);
+    uint32_t stored = trace_get32(&header[8]);
+    if (header[31] & TRACE_BLOCK_PACKED) {
+        if (fread(reader->packed, 1, stored, reader->file) != stored ||
+            !trace_lz_decompress(reader->packed, stored, reader->data, size)) {
+            return false;
+        }
+    } else if (stored != size || fread(reader->data, 1, size, reader->file) != size) {
+        return false;
+    }
+    
+    reader->size = size;
+    reader->pos = 0;
+    reader->remaining = info->count;
+    reader->generation++;
+    
+    trace_record_t* prev = &reader->prev;
+    memset(prev, 0, sizeof(trace_record_t));
+    prev->cycle = info->first_cycle - 1;
+    prev->pc = trace_get16(&header[24]);
+    prev->ac = header[26];
+    prev->x = header[27];
+    prev->y = header[28];
+    prev->out = header[29];
+    prev->outx = header[30];
+    return true;
+}
+
+/**
+ * Position the reader at the first record on or after cycle
+ */
+bool trace_reader_seek(trace_reader_t* reader, uint64_t cycle) {
+    if (!reader || !reader->file) return false;
+    
+    for (uint32_t i = 0; i < reader->num_blocks; i++) {
+        const trace_block_info_t* info = &reader->blocks[i];
+        if (info->count && info->first_cycle + info->count > cycle) {
+            reader->block = i;
+            reader->remaining = 0;
+            reader->skip_until = cycle;
+            return true;
+        }
+    }
+    
+    reader->block = reader->num_blocks;
+    reader->remaining = 0;
+    return false;
+}
+
+/**
+ * Decode one record from the loaded block
+ */
+static bool trace_decode(trace_reader_t* reader, trace_record_t* record) {
+    const uint8_t* data = reader->data;
+    uint32_t pos = reader->pos;
+    if (pos >= reader->size) return false;
+    
+    /* Check the longest record fits, then decode without bounds checks */
+    uint8_t flags = data[pos];
+    uint32_t length = 1 + ((flags & TRACE_F_PC) ? 2 : 0) + ((flags & TRACE_F_IR) ? 2 : 0) +
+                      ((flags & TRACE_F_AC) ? 1 : 0) + ((flags & TRACE_F_X) ? 1 : 0) +
+                      ((flags & TRACE_F_Y) ? 1 : 0) + ((flags & TRACE_F_OUT) ? 1 : 0) +
+                      ((flags & TRACE_F_OUTX) ? 1 : 0) + ((flags & TRACE_F_WRITE) ? 3 : 0);
+    if (length > reader->size - pos) return false;
+    
+    const uint8_t* p = &data[pos + 1];
+    trace_record_t* prev = &reader->prev;
+    
+    *record = *prev;
+    record->cycle = prev->cycle + 1;
+    record->pc = (uint16_t)(prev->pc + 1);
+    record->flags = 0;
+    
+    if (flags & TRACE_F_PC) {
+        record->pc = trace_get16(p);
+        p += 2;
+    }
+    if (flags & TRACE_F_IR) {
+        reader->ir_cache[record->pc] = trace_get16(p);
+        reader->ir_generation[record->pc] = reader->generation;
+        p += 2;
+    } else if (reader->ir_generation[record->pc] != reader->generation) {
+        return false;
+    }
+    record->ir = reader->ir_cache[record->pc];
+    if (flags & TRACE_F_AC) record->ac = *p++;
+    if (flags & TRACE_F_X) record->x = *p++;
+    if (flags & TRACE_F_Y) record->y = *p++;
+    if (flags & TRACE_F_OUT) record->out = *p++;
+    if (flags & TRACE_F_OUTX) record->outx = *p++;
+    if (flags & TRACE_F_WRITE) {
+        record->flags |= TRACE_RECORD_WRITE;
+        record->write_addr = trace_get16(p);
+        record->write_value = p[2];
+    } else {
+        record->write_addr = 0;
+        record->write_value = 0;
+    }
+    
+    reader->pos = pos + length;
+    *prev = *record;
+    return true;
+}
+
+/**
+ * Read the next record
+ */
+bool trace_reader_next(trace_reader_t* reader, trace_record_t* record) {
+    if (!reader || !reader->file || !record) return false;
+    
+    for (;;) {
+        if (reader->remaining == 0 && !trace_load_block(reader)) return false;
+        if (!trace_decode(reader, record)) {
+            reader->remaining = 0;
+            return false;
+        }
+        reader->remaining--;
+        
+        if (record->cycle >= reader->skip_until) {
+            reader->skip_until = 0;
+            return true;
+        }
+    }
+}
@@ -0,0 +1,176 @@
+/**
+ * Gigatron Execution Trace
+ *
+ * Binary instruction traces: one record per cycle with the instruction,
+ * the registers after it and its RAM write. Records are delta encoded
+ * against the previous one (and the last instruction word seen at the same
+ * address) into blocks, which a background thread compresses and writes,
+ * so tracing keeps up with real-time emulation.
+ *
+ * File layout: a 16-byte header ("GTTRACE\0", version, clock rate) and a
+ * sequence of blocks. Each block holds consecutive cycles, starts from the
+ * state stored in its header and decodes on its own, so readers can seek.
+ */
+
+#ifndef GIGATRON_TRACE_H
+#define GIGATRON_TRACE_H
+
+#include "gigatron.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TRACE_VERSION       1
+#define TRACE_BLOCK_SIZE    65536   /* Raw (encoded) bytes per block */
+#define TRACE_RING_BLOCKS   16      /* Blocks queued for the writer thread, power of two */
+#define TRACE_CACHE_LINE    64
+
+/* trace_record_t flags */
+#define TRACE_RECORD_WRITE  0x01    /* The instruction wrote RAM */
+
+/**
+ * One executed instruction
+ */
+typedef struct trace_record_t {
+    uint64_t cycle;         /* Cycle the instruction executed on */
+    uint16_t pc;            /* Address of the instruction */
+    uint16_t ir;            /* Instruction word */
+    uint8_t ac;             /* Registers after the instruction */
+    uint8_t x;
+    uint8_t y;
+    uint8_t out;
+    uint8_t outx;
+    uint8_t flags;          /* TRACE_RECORD_* */
+    uint16_t write_addr;    /* For TRACE_RECORD_WRITE */
+    uint8_t write_value;
+} trace_record_t;
+
+/**
+ * Encoded block and the state its first record is encoded against
+ */
+typedef struct trace_block_t {
+    uint8_t* data;
+    uint32_t size;          /* Encoded bytes */
+    uint32_t count;         /* Records */
+    uint64_t first_cycle;
+    trace_record_t base;
+} trace_block_t;
+
+/**
+ * Trace writer.
+ * Lock-free single producer (the emulation, trace_writer_put) / single
+ * consumer (the writer thread) ring of blocks, positions as in audio_buffer_t.
+ */
+typedef struct trace_writer_t {
+    FILE* file;
+    void* thread;
+    trace_block_t* ring;
+    uint8_t pad0[TRACE_CACHE_LINE];
+    uint32_t write_pos;     /* Owned by the producer */
+    uint8_t pad1[TRACE_CACHE_LINE - sizeof(uint32_t)];
+    uint32_t read_pos;      /* Owned by the writer thread */
+    uint32_t closing;
+    uint32_t error;         /* Set by the writer thread on a failed write */
+    uint8_t pad2[TRACE_CACHE_LINE - 3 * sizeof(uint32_t)];
+    
+    /* Encoder (producer) */
+    trace_block_t* block;   /* Block being filled, NULL if none */
+    trace_record_t prev;
+    uint32_t generation;    /* Block number, tags ir_cache entries */
+    uint16_t* ir_cache;     /* Last instruction word per address */
+    uint32_t* ir_generation;
+    
+    /* Compressor (writer thread) */
+    uint8_t* packed;
+    uint32_t* lz_table;
+    
+    /* Statistics */
+    uint64_t records;
+    uint64_t raw_bytes;
+    uint64_t file_bytes;    /* Updated by the writer thread */
+    uint64_t stalls;        /* Waits for a free block */
+} trace_writer_t;
+
+/**
+ * Index entry of a block in a trace file
+ */
+typedef struct trace_block_info_t {
+    uint64_t offset;        /* File offset of the block header */
+    uint64_t first_cycle;
+    uint32_t count;
+} trace_block_info_t;
+
+/**
+ * Trace reader
+ */
+typedef struct trace_reader_t {
+    FILE* file;
+    uint32_t hz;
+    trace_block_info_t* blocks;
+    uint32_t num_blocks;
+    uint64_t num_records;
+    
+    /* Decoder */
+    uint32_t block;         /* Next block to load */
+    uint8_t* data;
+    uint8_t* packed;
+    uint32_t size;
+    uint32_t pos;
+    uint32_t remaining;     /* Records left in the loaded block */
+    uint64_t skip_until;    /* Records before this cycle are skipped */
+    trace_record_t prev;
+    uint32_t generation;
+    uint16_t* ir_cache;
+    uint32_t* ir_generation;
+} trace_reader_t;
+
+/**
+ * Create a trace file and start its writer thread.
+ * Returns true on success, false on failure.
+ */
+bool trace_writer_open(trace_writer_t* writer, const char* filename, uint32_t hz);
+
+/**
+ * Append a record. A record that does not follow the previous cycle
+ * starts a new block. Waits if the writer thread falls a full ring behind.
+ */
+void trace_writer_put(trace_writer_t* writer, const trace_record_t* record);
+
+/**
+ * Flush the last block, stop the writer thread and close the file.
+ * Returns false if any write failed.
+ */
+bool trace_writer_close(trace_writer_t* writer);
+
+/**
+ * Open a trace file and index its blocks.
+ * Returns true on success, false on failure.
+ */
+bool trace_reader_open(trace_reader_t* reader, const char* filename);
+
+/**
+ * Close the file and free the reader.
+ */
+void trace_reader_close(trace_reader_t* reader);
+
+/**
+ * Position the reader at the first record (in file order) executed on or
+ * after cycle. Returns false if there is none.
+ */
+bool trace_reader_seek(trace_reader_t* reader, uint64_t cycle);
+
+/**
+ * Read the next record.
+ * Returns false at the end of the trace or on a corrupt block.
+ */
+bool trace_reader_next(trace_reader_t* reader, trace_record_t* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GIGATRON_TRACE_H */
@@ -0,0 +1,380 @@
+/**
+ * Gigatron vCPU Profiler
+ */
+
+#include "vcpu_profiler.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/*
+ * Interpreter loop at NEXT, identical in all ROM versions:
+ *   adda [vTicks]; blt EXIT; st [vTicks]; ld [vPC]; adda 2;
+ *   st [vPC],X; ld [Y,X]; st [Y,X++]; bra AC
+ */
+#define VCPU_PATTERN_LENGTH     9
+#define VCPU_DISPATCH_OFFSET    8
+#define VCPU_NEXTY_INSN         0x1517  /* ld [vPC+1],Y */
+
+static const uint16_t vcpu_pattern[VCPU_PATTERN_LENGTH] = {
+    0x8115, 0xE800, 0xC215, 0x0116, 0x8002, 0xD216, 0x0D00, 0xDE00, 0xFE00
+};
+static const uint16_t vcpu_pattern_mask[VCPU_PATTERN_LENGTH] = {
+    0xFFFF, 0xFF00, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF, 0xFFFF
+};
+
+/* vCPU instruction set (ROM v5a) */
+static const struct {
+    uint8_t op;
+    const char* name;
+} vcpu_opcodes[] = {
+    { 0x11, "LDWI" },  { 0x1A, "LD" },    { 0x1F, "CMPHS" }, { 0x21, "LDW" },
+    { 0x2B, "STW" },   { 0x35, "BCC" },   { 0x59, "LDI" },   { 0x5E, "ST" },
+    { 0x63, "POP" },   { 0x75, "PUSH" },  { 0x7F, "LUP" },   { 0x82, "ANDI" },
+    { 0x85, "CALLI" }, { 0x88, "ORI" },   { 0x8C, "XORI" },  { 0x90, "BRA" },
+    { 0x93, "INC" },   { 0x97, "CMPHU" }, { 0x99, "ADDW" },  { 0xAD, "PEEK" },
+    { 0xB4, "SYS" },   { 0xB8, "SUBW" },  { 0xCD, "DEF" },   { 0xCF, "CALL" },
+    { 0xDF, "ALLOC" }, { 0xE3, "ADDI" },  { 0xE6, "SUBI" },  { 0xE9, "LSLW" },
+    { 0xEC, "STLW" },  { 0xEE, "LDLW" },  { 0xF0, "POKE" },  { 0xF3, "DOKE" },
+    { 0xF6, "DEEK" },  { 0xF8, "ANDW" },  { 0xFA, "ORW" },   { 0xFC, "XORW" },
+    { 0xFF, "RET" }
+};
+
+/**
+ * Initialize the profiler
+ */
+bool vcpu_profiler_init(vcpu_profiler_t* profiler, const gigatron_t* cpu) {
+    if (!profiler) return false;
+    
+    memset(profiler, 0, sizeof(vcpu_profiler_t));
+    
+    profiler->counts = (uint64_t*)calloc(1 << 16, sizeof(uint64_t));
+    profiler->cycles = (uint64_t*)calloc(1 << 16, sizeof(uint64_t));
+    profiler->nodes = (vcpu_node_t*)calloc(VCPU_MAX_NODES, sizeof(vcpu_node_t));
+    profiler->node_hash = (uint16_t*)calloc(VCPU_NODE_HASH, sizeof(uint16_t));
+    if (!profiler->counts || !profiler->cycles || !profiler->nodes || !profiler->node_hash) {
+        vcpu_profiler_shutdown(profiler);
+        return false;
+    }
+    
+    vcpu_profiler_reset(profiler);
+    vcpu_profiler_locate(profiler, cpu);
+    
+    return true;
+}
+
+/**
+ * Free the profiler
+ */
+void vcpu_profiler_shutdown(vcpu_profiler_t* profiler) {
+    if (!profiler) return;
+    
+    free(profiler->counts);
+    free(profiler->cycles);
+    free(profiler->nodes);
+    free(profiler->node_hash);
+    profiler->counts = NULL;
+    profiler->cycles = NULL;
+    profiler->nodes = NULL;
+    profiler->node_hash = NULL;
+    profiler->valid = false;
+}
+
+/**
+ * Clear all statistics
+ */
+void vcpu_profiler_reset(vcpu_profiler_t* profiler) {
+    if (!profiler || !profiler->counts) return;
+    
+    memset(profiler->counts, 0, (1 << 16) * sizeof(uint64_t));
+    memset(profiler->cycles, 0, (1 << 16) * sizeof(uint64_t));
+    memset(profiler->op_counts, 0, sizeof(profiler->op_counts));
+    memset(profiler->op_cycles, 0, sizeof(profiler->op_cycles));
+    profiler->num_sys = 0;
+    
+    /* Call tree with only the root */
+    memset(profiler->node_hash, 0, VCPU_NODE_HASH * sizeof(uint16_t));
+    memset(&profiler->nodes[0], 0, sizeof(vcpu_node_t));
+    profiler->num_nodes = 1;
+    profiler->depth = 0;
+    
+    profiler->active = false;
+    profiler->instructions = 0;
+    profiler->total_cycles = 0;
+}
+
+/**
+ * Locate the interpreter in ROM
+ */
+bool vcpu_profiler_locate(vcpu_profiler_t* profiler, const gigatron_t* cpu) {
+    if (!profiler) return false;
+    
+    profiler->valid = false;
+    profiler->active = false;
+    if (!cpu || !cpu->rom) return false;
+    
+    for (uint32_t addr = 1; addr + VCPU_PATTERN_LENGTH <= cpu->rom_size; addr++) {
+        uint32_t i = 0;
+        while (i < VCPU_PATTERN_LENGTH &&
+               (cpu->rom[addr + i] & vcpu_pattern_mask[i]) == vcpu_pattern[i]) {
+            i++;
+        }
+        if (i < VCPU_PATTERN_LENGTH) continue;
+        
+        profiler->next_addr = (uint16_t)addr;
+        profiler->dispatch_addr = (uint16_t)(addr + VCPU_DISPATCH_OFFSET);
+        
+        /* NEXTY reloads Y and falls into NEXT */
+        profiler->nexty_addr = (cpu->rom[addr - 1] == VCPU_NEXTY_INSN) ? (uint16_t)(addr - 1) : (uint16_t)addr;
+        profiler->valid = true;
+        return true;
+    }
+    
+    return false;
+}
+
+/**
+ * Find or add the call tree node for addr below parent.
+ * Falls back to the parent when the tree is full.
+ */
+static uint16_t vcpu_node_child(vcpu_profiler_t* profiler, uint16_t parent, uint16_t addr, bool sys) {
+    uint32_t slot = ((uint32_t)parent * 65537u + (uint32_t)addr * 2u + (sys ? 1u : 0u)) & (VCPU_NODE_HASH - 1);
+    
+    for (;;) {
+        uint16_t entry = profiler->node_hash[slot];
+        if (entry == 0) break;
+        
+        vcpu_node_t* node = &profiler->nodes[entry - 1];
+        if (node->parent == parent && node->addr == addr && node->sys == sys) {
+            return (uint16_t)(entry - 1);
+        }
+        slot = (slot + 1) & (VCPU_NODE_HASH - 1);
+    }
+    
+    if (profiler->num_nodes >= VCPU_MAX_NODES) return parent;
+    
+    uint16_t index = (uint16_t)profiler->num_nodes++;
+    vcpu_node_t* node = &profiler->nodes[index];
+    node->addr = addr;
+    node->parent = parent;
+    node->sys = sys;
+    node->cycles = 0;
+    profiler->node_hash[slot] = (uint16_t)(index + 1);
+    return index;
+}
+
+/**
+ * Node of the routine currently executing
+ */
+static uint16_t vcpu_current_node(const vcpu_profiler_t* profiler) {
+    if (profiler->depth == 0) return 0;
+    uint32_t top = profiler->depth < VCPU_MAX_DEPTH ? profiler->depth : VCPU_MAX_DEPTH;
+    return profiler->stack[top - 1];
+}
+
+/**
+ * Add time to a SYS function's totals
+ */
+static void vcpu_add_sys(vcpu_profiler_t* profiler, uint16_t addr, uint64_t cycles) {
+    for (uint32_t i = 0; i < profiler->num_sys; i++) {
+        if (profiler->sys[i].addr == addr) {
+            profiler->sys[i].count++;
+            profiler->sys[i].cycles += cycles;
+            return;
+        }
+    }
+    if (profiler->num_sys < VCPU_MAX_SYS) {
+        vcpu_sys_stats_t* sys = &profiler->sys[profiler->num_sys++];
+        sys->addr = addr;
+        sys->count = 1;
+        sys->cycles = cycles;
+    }
+}
+
+/**
+ * Close the instruction in flight at cycle `end`
+ */
+static void vcpu_finish(vcpu_profiler_t* profiler, uint64_t end) {
+    uint64_t cycles = end - profiler->start;
+    uint16_t node = vcpu_current_node(profiler);
+    
+    profiler->cycles[profiler->vpc] += cycles;
+    profiler->op_cycles[profiler->op] += cycles;
+    profiler->total_cycles += cycles;
+    
+    switch (profiler->op) {
+        case VCPU_OP_SYS:
+            vcpu_add_sys(profiler, profiler->sys_fn, cycles);
+            profiler->nodes[vcpu_node_child(profiler, node, profiler->sys_fn, true)].cycles += cycles;
+            break;
+        case VCPU_OP_CALL:
+        case VCPU_OP_CALLI:
+            profiler->nodes[node].cycles += cycles;
+            if (profiler->depth < VCPU_MAX_DEPTH) {
+                profiler->stack[profiler->depth] = vcpu_node_child(profiler, node, profiler->target, false);
+            }
+            profiler->depth++;
+            break;
+        case VCPU_OP_RET:
+            profiler->nodes[node].cycles += cycles;
+            if (profiler->depth > 0) {
+                profiler->depth--;
+            }
+            break;
+        default:
+            profiler->nodes[node].cycles += cycles;
+            break;
+    }
+    
+    profiler->active = false;
+}
+
+/**
+ * Record an interpreter event
+ */
+void vcpu_profiler_event(vcpu_profiler_t* profiler, const gigatron_t* cpu) {
+    if (!profiler || !profiler->valid || !cpu) return;
+    
+    /* Back at NEXT: the instruction is done */
+    if (cpu->pc != profiler->dispatch_addr) {
+        if (profiler->active) {
+            vcpu_finish(profiler, cpu->cycles);
+        }
+        return;
+    }
+    
+    /* Resumed through ENTER after a time slice ran out */
+    if (profiler->active) {
+        vcpu_finish(profiler, cpu->cycles);
+    }
+    
+    /* Dispatch: vPC is already advanced to the instruction, AC holds the opcode */
+    const uint8_t* ram = cpu->ram;
+    uint32_t mask = cpu->ram_mask;
+    uint8_t lo = ram[VCPU_VPC & mask];
+    uint8_t hi = ram[(VCPU_VPC + 1) & mask];
+    uint16_t vpc = (uint16_t)((hi << 8) | lo);
+    uint8_t op = cpu->ac;
+    
+    profiler->active = true;
+    profiler->vpc = vpc;
+    profiler->op = op;
+    profiler->start = cpu->cycles;
+    profiler->counts[vpc]++;
+    profiler->op_counts[op]++;
+    profiler->instructions++;
+    
+    if (op == VCPU_OP_SYS) {
+        profiler->sys_fn = (uint16_t)(ram[VCPU_SYSFN & mask] | (ram[(VCPU_SYSFN + 1) & mask] << 8));
+    } else if (op == VCPU_OP_CALL || op == VCPU_OP_CALLI) {
+        /* Operands follow the opcode, vPC wraps within its page */
+        uint16_t page = (uint16_t)(hi << 8);
+        uint8_t d = ram[(page | (uint8_t)(lo + 1)) & mask];
+        if (op == VCPU_OP_CALL) {
+            /* CALL d: target is the word at zero page d */
+            profiler->target = (uint16_t)(ram[d & mask] | (ram[(uint8_t)(d + 1) & mask] << 8));
+        } else {
+            profiler->target = (uint16_t)(d | (ram[(page | (uint8_t)(lo + 2)) & mask] << 8));
+        }
+    }
+}
+
+/**
+ * Get the mnemonic of an opcode
+ */
+const char* vcpu_opcode_name(uint8_t op) {
+    for (size_t i = 0; i < sizeof(vcpu_opcodes) / sizeof(vcpu_opcodes[0]); i++) {
+        if (vcpu_opcodes[i].op == op) return vcpu_opcodes[i].name;
+    }
+    return NULL;
+}
+
+/**
+ * Write a text report
+ */
+bool vcpu_profiler_write_report(const vcpu_profiler_t* profiler, const char* filename, uint32_t max_vpc) {
+    if (!profiler || !profiler->counts || !filename) return false;
+    
+    FILE* f = fopen(filename, "w");
+    if (!f) return false;
+    
+    double scale = profiler->total_cycles ? 100.0 / (double)profiler->total_cycles : 0.0;
+    
+    fprintf(f, "# vCPU profile: %llu instructions, %llu cycles\n",
+            (unsigned long long)profiler->instructions, (unsigned long long)profiler->total_cycles);
+    
+    fprintf(f, "\n# Opcodes\n# op  name    count            cycles           cycles%%  avg\n");
+    for (uint32_t op = 0; op < 256; op++) {
+        uint64_t count = profiler->op_counts[op];
+        if (count == 0) continue;
+        const char* name = vcpu_opcode_name((uint8_t)op);
+        fprintf(f, "  %02X  %-6s  %-15llu  %-15llu  %6.2f  %.1f\n", op, name ? name : "?",
+                (unsigned long long)count, (unsigned long long)profiler->op_cycles[op],
+                (double)profiler->op_cycles[op] * scale, (double)profiler->op_cycles[op] / (double)count);
+    }
+    
+    fprintf(f, "\n# SYS functions\n# addr  count            cycles           cycles%%  avg\n");
+    for (uint32_t i = 0; i < profiler->num_sys; i++) {
+        const vcpu_sys_stats_t* sys = &profiler->sys[i];
+        fprintf(f, "  %04X  %-15llu  %-15llu  %6.2f  %.1f\n", sys->addr,
+                (unsigned long long)sys->count, (unsigned long long)sys->cycles,
+                (double)sys->cycles * scale, (double)sys->cycles / (double)sys->count);
+    }
+    
+    /* Top vPC by cycles, insertion into a short sorted list */
+    fprintf(f, "\n# Hot instructions\n# vpc   count            cycles           cycles%%\n");
+    uint16_t* top = max_vpc ? (uint16_t*)malloc(max_vpc * sizeof(uint16_t)) : NULL;
+    if (top) {
+        uint32_t n = 0;
+        for (uint32_t vpc = 0; vpc < (1 << 16); vpc++) {
+            uint64_t cycles = profiler->cycles[vpc];
+            if (cycles == 0) continue;
+            if (n == max_vpc && cycles <= profiler->cycles[top[n - 1]]) continue;
+            
+            uint32_t i = (n < max_vpc) ? n++ : n - 1;
+            while (i > 0 && profiler->cycles[top[i - 1]] < cycles) {
+                top[i] = top[i - 1];
+                i--;
+            }
+            top[i] = (uint16_t)vpc;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            fprintf(f, "  %04X  %-15llu  %-15llu  %6.2f\n", top[i],
+                    (unsigned long long)profiler->counts[top[i]], (unsigned long long)profiler->cycles[top[i]],
+                    (double)profiler->cycles[top[i]] * scale);
+        }
+        free(top);
+    }
+    
+    return fclose(f) == 0;
+}
+
+/**
+ * Write the call stacks in folded format
+ */
+bool vcpu_profiler_write_folded(const vcpu_profiler_t* profiler, const char* filename) {
+    if (!profiler || !profiler->nodes || !filename) return false;
+    
+    FILE* f = fopen(filename, "w");
+    if (!f) return false;
+    
+    for (uint32_t i = 0; i < profiler->num_nodes; i++) {
+        if (profiler->nodes[i].cycles == 0) continue;
+        
+        /* Walk up to the root, then print root first */
+        uint16_t path[VCPU_MAX_DEPTH + 2];
+        uint32_t len = 0;
+        for (uint16_t node = (uint16_t)i; node != 0 && len < VCPU_MAX_DEPTH + 1; node = profiler->nodes[node].parent) {
+            path[len++] = node;
+        }
+        
+        fprintf(f, "vCPU");
+        while (len > 0) {
+            const vcpu_node_t* node = &profiler->nodes[path[--len]];
+            fprintf(f, node->sys ? ";SYS_%04X" : ";%04X", node->addr);
+        }
+        fprintf(f, " %llu\n", (unsigned long long)profiler->nodes[i].cycles);
+    }
+    
+    return fclose(f) == 0;
+}
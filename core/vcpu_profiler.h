@@ -0,0 +1,158 @@
+/**
+ * Gigatron vCPU Profiler
+ *
+ * Profiles the ROM's 16-bit virtual CPU (the interpreter GT1 programs run
+ * on): executions and native cycles per vPC, an opcode histogram, time per
+ * SYS function, and call stacks (CALL/CALLI/RET) for flame graphs.
+ *
+ * Instructions are observed at the interpreter's dispatch, which is found
+ * in the ROM by its code pattern, and end when control returns to NEXT.
+ */
+
+#ifndef GIGATRON_VCPU_PROFILER_H
+#define GIGATRON_VCPU_PROFILER_H
+
+#include "gigatron.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* vCPU state in zero page */
+#define VCPU_VPC            0x16    /* vPC (2 bytes) */
+#define VCPU_SYSFN          0x22    /* sysFn (2 bytes) */
+
+/* Opcodes that shape the profile */
+#define VCPU_OP_CALLI       0x85
+#define VCPU_OP_SYS         0xB4
+#define VCPU_OP_CALL        0xCF
+#define VCPU_OP_RET         0xFF
+
+#define VCPU_MAX_DEPTH      32      /* Tracked call depth */
+#define VCPU_MAX_SYS        64      /* Distinct SYS functions */
+#define VCPU_MAX_NODES      4096    /* Distinct call stacks (incl. SYS leaves) */
+#define VCPU_NODE_HASH      8192    /* Power of two, > VCPU_MAX_NODES */
+
+/**
+ * Totals for one SYS function
+ */
+typedef struct vcpu_sys_stats_t {
+    uint16_t addr;
+    uint64_t count;
+    uint64_t cycles;
+} vcpu_sys_stats_t;
+
+/**
+ * Call tree node: a routine (or SYS function) reached through its parent
+ */
+typedef struct vcpu_node_t {
+    uint16_t addr;      /* Routine entry or SYS function */
+    uint16_t parent;    /* Node index; node 0 is the root, walks stop there */
+    bool sys;
+    uint64_t cycles;    /* Self time in native cycles */
+} vcpu_node_t;
+
+/**
+ * vCPU profiler state
+ */
+typedef struct vcpu_profiler_t {
+    /* Interpreter addresses in ROM (valid == false if not found) */
+    bool valid;
+    uint16_t nexty_addr;
+    uint16_t next_addr;
+    uint16_t dispatch_addr;
+    
+    /* Per vPC */
+    uint64_t* counts;
+    uint64_t* cycles;
+    
+    /* Per opcode */
+    uint64_t op_counts[256];
+    uint64_t op_cycles[256];
+    
+    /* Per SYS function */
+    vcpu_sys_stats_t sys[VCPU_MAX_SYS];
+    uint32_t num_sys;
+    
+    /* Call tree, node 0 is the root */
+    vcpu_node_t* nodes;
+    uint32_t num_nodes;
+    uint16_t* node_hash;    /* Node index + 1, 0 = empty */
+    uint16_t stack[VCPU_MAX_DEPTH];
+    uint32_t depth;         /* Call depth, may exceed VCPU_MAX_DEPTH */
+    
+    /* Instruction in flight */
+    bool active;
+    uint16_t vpc;
+    uint8_t op;
+    uint16_t sys_fn;
+    uint16_t target;        /* Callee of CALL/CALLI */
+    uint64_t start;
+    
+    uint64_t instructions;
+    uint64_t total_cycles;
+} vcpu_profiler_t;
+
+/**
+ * Initialize the profiler and locate the vCPU interpreter in the CPU's ROM.
+ * Returns false on allocation failure; valid stays false if the ROM has
+ * no recognizable interpreter.
+ */
+bool vcpu_profiler_init(vcpu_profiler_t* profiler, const gigatron_t* cpu);
+
+/**
+ * Free the profiler.
+ */
+void vcpu_profiler_shutdown(vcpu_profiler_t* profiler);
+
+/**
+ * Clear all statistics (keeps the interpreter addresses).
+ */
+void vcpu_profiler_reset(vcpu_profiler_t* profiler);
+
+/**
+ * Locate the interpreter again, e.g. after loading another ROM.
+ * Returns true if found.
+ */
+bool vcpu_profiler_locate(vcpu_profiler_t* profiler, const gigatron_t* cpu);
+
+/**
+ * Record an interpreter event. Called by the machine's profiling loop
+ * before executing the instruction at cpu->pc, which is one of the
+ * NEXTY, NEXT or dispatch addresses.
+ */
+void vcpu_profiler_event(vcpu_profiler_t* profiler, const gigatron_t* cpu);
+
+/**
+ * Check if cpu->pc is an address vcpu_profiler_event needs to see.
+ */
+static inline bool vcpu_profiler_watches(const vcpu_profiler_t* profiler, uint16_t pc) {
+    return pc == profiler->dispatch_addr || pc == profiler->next_addr || pc == profiler->nexty_addr;
+}
+
+/**
+ * Get the mnemonic of an opcode (NULL if unknown).
+ */
+const char* vcpu_opcode_name(uint8_t op);
+
+/**
+ * Write a text report: opcode histogram, SYS functions and the top
+ * `max_vpc` instruction addresses.
+ * Returns true on success, false on failure.
+ */
+bool vcpu_profiler_write_report(const vcpu_profiler_t* profiler, const char* filename, uint32_t max_vpc);
+
+/**
+ * Write the call stacks in folded format ("frame;frame;frame cycles" per
+ * line), the input of flamegraph.pl and compatible viewers.
+ * Returns true on success, false on failure.
+ */
+bool vcpu_profiler_write_folded(const vcpu_profiler_t* profiler, const char* filename);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GIGATRON_VCPU_PROFILER_H */
@@ -6,6 +6,42 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* FNV-1a style constants for the frame hash (applied per 64-bit word) */
+#define VGA_HASH_SEED       0xCBF29CE484222325ULL
+#define VGA_HASH_PRIME      0x00000100000001B3ULL
+
+/**
+ * Build the color lookup table for the current pixel format
+ */
+static void vga_build_palette(vga_t* vga) {
+    for (uint32_t color = 0; color < 64; color++) {
+        uint8_t r, g, b;
+        vga_color_to_rgba((uint8_t)color, &r, &g, &b);
+        
+        switch (vga->format) {
+            case VGA_FORMAT_RGBA8888:
+            case VGA_FORMAT_BGRA8888: {
+                /* Store as bytes so the packed value is endian-neutral */
+                uint8_t bytes[4] = { r, g, b, 255 };
+                if (vga->format == VGA_FORMAT_BGRA8888) {
+                    bytes[0] = b;
+                    bytes[2] = r;
+                }
+                memcpy(&vga->palette[color], bytes, 4);
+                break;
+            }
+            case VGA_FORMAT_RGB565:
+                vga->palette[color] = ((uint32_t)(r >> 3) << 11) |
+                                      ((uint32_t)(g >> 2) << 5) |
+                                      (uint32_t)(b >> 3);
+                break;
+            case VGA_FORMAT_INDEX8:
+                vga->palette[color] = color;
+                break;
+        }
+    }
+}
+
 /**
  * Initialize VGA emulation
  */
@@ -15,24 +51,24 @@ bool vga_init(vga_t* vga, gigatron_t* cpu) {
     memset(vga, 0, sizeof(vga_t));
     
     vga->cpu = cpu;
-    vga->width = VGA_WIDTH;
-    vga->height = VGA_HEIGHT;
     
-    /* Allocate framebuffer (RGBA) */
-    size_t fb_size = (size_t)vga->width * vga->height * 4;
-    vga->pixels = (uint8_t*)malloc(fb_size);
-    if (!vga->pixels) {
+    /* Allocate default framebuffer (RGBA) */
+    size_t fb_size = (size_t)VGA_WIDTH * VGA_HEIGHT * 4;
+    vga->own_pixels = (uint8_t*)malloc(fb_size);
+    if (!vga->own_pixels) {
         return false;
     }
     
     /* Initialize to black with full alpha */
     for (size_t i = 0; i < fb_size; i += 4) {
-        vga->pixels[i + 0] = 0;     /* R */
-        vga->pixels[i + 1] = 0;     /* G */
-        vga->pixels[i + 2] = 0;     /* B */
-        vga->pixels[i + 3] = 255;   /* A */
+        vga->own_pixels[i + 0] = 0;     /* R */
+        vga->own_pixels[i + 1] = 0;     /* G */
+        vga->own_pixels[i + 2] = 0;     /* B */
+        vga->own_pixels[i + 3] = 255;   /* A */
     }
     
+    vga_set_framebuffer(vga, NULL, 0, VGA_FORMAT_RGBA8888, VGA_MAX_SCALE);
+    
     /* Set timing boundaries */
     vga->min_row = VGA_V_BACK_PORCH;
     vga->max_row = VGA_V_BACK_PORCH + VGA_V_VISIBLE;
@@ -50,10 +86,11 @@ bool vga_init(vga_t* vga, gigatron_t* cpu) {
 void vga_shutdown(vga_t* vga) {
     if (!vga) return;
     
-    if (vga->pixels) {
-        free(vga->pixels);
-        vga->pixels = NULL;
+    if (vga->own_pixels) {
+        free(vga->own_pixels);
+        vga->own_pixels = NULL;
     }
+    vga->pixels = NULL;
 }
 
 /**
@@ -64,9 +101,176 @@ void vga_reset(vga_t* vga) {
     
     vga->row = 0;
     vga->col = 0;
-    vga->pixel_index = 0;
     vga->prev_out = 0;
+    vga->line_pending = false;
     vga->frame_complete = false;
+    vga->group_has_pixels = false;
+    vga->group_pixel_lines = 0;
+    memset(vga->mode_votes, 0, sizeof(vga->mode_votes));
+    vga->line_hash = VGA_HASH_SEED;
+}
+
+/**
+ * Select the framebuffer the VGA emulation renders into
+ */
+bool vga_set_framebuffer(vga_t* vga, void* pixels, uint32_t stride,
+                         vga_format_t format, uint32_t scale) {
+    if (!vga) return false;
+    
+    if (!pixels) {
+        /* Back to the internal buffer */
+        if (!vga->own_pixels) return false;
+        pixels = vga->own_pixels;
+        format = VGA_FORMAT_RGBA8888;
+        scale = VGA_MAX_SCALE;
+        stride = VGA_WIDTH * 4;
+    }
+    
+    if (scale != 1 && scale != 2 && scale != 4) return false;
+    if (format > VGA_FORMAT_INDEX8) return false;
+    
+    uint32_t width = VGA_NATIVE_WIDTH * scale;
+    if (stride < width * vga_format_bytes_per_pixel(format)) return false;
+    
+    vga->pixels = (uint8_t*)pixels;
+    vga->width = width;
+    vga->height = VGA_NATIVE_HEIGHT * scale;
+    vga->stride = stride;
+    vga->format = format;
+    vga->scale = scale;
+    vga_build_palette(vga);
+    
+    return true;
+}
+
+/**
+ * Add the buffered scanline to the frame hash.
+ * Returns true if the line has no pixel burst (all black).
+ */
+static bool vga_scan_line(vga_t* vga) {
+    uint64_t hash = vga->line_hash;
+    uint64_t bits = 0;
+    for (uint32_t x = 0; x < VGA_NATIVE_WIDTH; x += 8) {
+        uint64_t word;
+        memcpy(&word, vga->line + x, 8);
+        hash = (hash ^ word) * VGA_HASH_PRIME;
+        bits |= word;
+    }
+    vga->line_hash = hash;
+    return bits == 0;
+}
+
+/**
+ * Convert the buffered scanline into the framebuffer
+ */
+static void vga_flush_line(vga_t* vga) {
+    vga->line_pending = false;
+    
+    uint32_t y = (uint32_t)(vga->row - vga->min_row);
+    uint32_t group_line = y & 3;
+    bool blank = vga_scan_line(vga);
+    
+    /*
+     * The first line of each group always carries pixels, the ROM's video
+     * modes blank some of the other three. Only groups whose first line is
+     * not black tell the mode apart from black image content.
+     */
+    if (group_line == 0) {
+        vga->group_has_pixels = !blank;
+        vga->group_pixel_lines = 1;
+    } else if (!blank) {
+        vga->group_pixel_lines++;
+    }
+    if (group_line == 3 && vga->group_has_pixels) {
+        vga->mode_votes[vga->group_pixel_lines - 1]++;
+    }
+    
+    /* Each output row covers (4 / scale) VGA lines, use the first of them */
+    uint32_t lines_per_row = VGA_MAX_SCALE / vga->scale;
+    if (y % lines_per_row) return;
+    
+    uint8_t* dst = vga->pixels + (size_t)(y / lines_per_row) * vga->stride;
+    
+    /* Blank line inside a group: one bulk copy of the row above */
+    if (blank && group_line != 0 && vga->replicate_lines) {
+        memcpy(dst, dst - vga->stride, vga->width * vga_format_bytes_per_pixel(vga->format));
+        vga->replicated_lines++;
+        return;
+    }
+    
+    const uint8_t* src = vga->line;
+    const uint32_t* palette = vga->palette;
+    const uint32_t scale = vga->scale;
+    
+    switch (vga->format) {
+        case VGA_FORMAT_RGBA8888:
+        case VGA_FORMAT_BGRA8888:
+            for (uint32_t x = 0; x < VGA_NATIVE_WIDTH; x++) {
+                uint32_t pixel = palette[src[x]];
+                for (uint32_t i = 0; i < scale; i++) {
+                    memcpy(dst, &pixel, 4);
+                    dst += 4;
+                }
+            }
+            break;
+        case VGA_FORMAT_RGB565:
+            for (uint32_t x = 0; x < VGA_NATIVE_WIDTH; x++) {
+                uint16_t pixel = (uint16_t)palette[src[x]];
+                for (uint32_t i = 0; i < scale; i++) {
+                    memcpy(dst, &pixel, 2);
+                    dst += 2;
+                }
+            }
+            break;
+        case VGA_FORMAT_INDEX8:
+            if (scale == 1) {
+                memcpy(dst, src, VGA_NATIVE_WIDTH);
+                break;
+            }
+            for (uint32_t x = 0; x < VGA_NATIVE_WIDTH; x++) {
+                memset(dst, src[x], scale);
+                dst += scale;
+            }
+            break;
+    }
+}
+
+/**
+ * Pass the line that just ended to the scanline callback
+ */
+static void vga_emit_scanline(vga_t* vga) {
+    bool visible = vga->row >= vga->min_row && vga->row < vga->max_row;
+    vga->scanline_cb(vga->scanline_user_data, vga->row, visible ? vga->line : NULL);
+}
+
+/**
+ * Update video mode statistics at the end of a frame
+ */
+static void vga_end_frame(vga_t* vga) {
+    uint32_t best = 0;
+    for (uint32_t i = 1; i < 4; i++) {
+        if (vga->mode_votes[i] > vga->mode_votes[best]) {
+            best = i;
+        }
+    }
+    
+    /* Keep the previous mode for frames without pixels */
+    if (vga->mode_votes[best] > 0) {
+        vga->pixel_lines = (uint8_t)(best + 1);
+    }
+    if (vga->pixel_lines) {
+        vga->mode_frames[vga->pixel_lines - 1]++;
+    }
+    
+    memset(vga->mode_votes, 0, sizeof(vga->mode_votes));
+    
+    /* Publish the frame hash */
+    vga->frame_changed = (vga->line_hash != vga->frame_hash);
+    if (!vga->frame_changed) {
+        vga->duplicate_frames++;
+    }
+    vga->frame_hash = vga->line_hash;
+    vga->line_hash = VGA_HASH_SEED;
 }
 
 /**
@@ -80,14 +284,23 @@ void vga_tick(vga_t* vga) {
     
     /* Detect falling edge of VSYNC */
     if (falling & GIGATRON_OUT_VSYNC) {
+        if (vga->line_pending) {
+            vga_flush_line(vga);
+        }
+        vga_end_frame(vga);
         vga->row = 0;
-        vga->pixel_index = 0;
         vga->frame_complete = true;
         vga->frame_count++;
     }
     
     /* Detect falling edge of HSYNC */
     if (falling & GIGATRON_OUT_HSYNC) {
+        if (vga->line_pending) {
+            vga_flush_line(vga);
+        }
+        if (vga->scanline_cb) {
+            vga_emit_scanline(vga);
+        }
         vga->col = 0;
         vga->row++;
     }
@@ -104,23 +317,9 @@ void vga_tick(vga_t* vga) {
     if (vga->row >= vga->min_row && vga->row < vga->max_row &&
         vga->col >= vga->min_col && vga->col < vga->max_col) {
         
-        /* Get color from OUT register */
-        uint8_t color = out & 0x3F;
-        uint8_t r, g, b;
-        vga_color_to_rgba(color, &r, &g, &b);
-        
-        /* Each Gigatron pixel is 4 VGA pixels wide */
-        uint8_t* pixels = vga->pixels;
-        uint32_t idx = vga->pixel_index;
-        
-        for (int i = 0; i < 4; i++) {
-            pixels[idx++] = r;
-            pixels[idx++] = g;
-            pixels[idx++] = b;
-            pixels[idx++] = 255;
-        }
-        
-        vga->pixel_index = idx;
+        /* Buffer the 6-bit color, the line is converted on HSYNC */
+        vga->line[(vga->col - vga->min_col) >> 2] = out & 0x3F;
+        vga->line_pending = true;
     }
     
     /* Advance by 4 columns (Gigatron outputs 1 pixel per tick, 4x VGA) */
@@ -28,6 +28,28 @@ extern "C" {
 #define VGA_WIDTH           VGA_H_VISIBLE
 #define VGA_HEIGHT          VGA_V_VISIBLE
 
+/* Native Gigatron resolution (1 pixel per tick, 4 VGA lines per pixel row) */
+#define VGA_NATIVE_WIDTH    160
+#define VGA_NATIVE_HEIGHT   120
+#define VGA_MAX_SCALE       4
+
+/**
+ * Framebuffer pixel formats
+ */
+typedef enum vga_format_t {
+    VGA_FORMAT_RGBA8888 = 0,    /* Bytes R, G, B, A (default) */
+    VGA_FORMAT_BGRA8888,        /* Bytes B, G, R, A */
+    VGA_FORMAT_RGB565,          /* 16-bit host-endian, R in high bits */
+    VGA_FORMAT_INDEX8           /* Raw 6-bit BBGGRR color, 1 byte per pixel */
+} vga_format_t;
+
+/**
+ * Scanline callback, called on each HSYNC falling edge.
+ * row:    VGA line that just ended, counted from VSYNC (visible: 34-513)
+ * pixels: the line's 160 6-bit colors (BBGGRR), NULL outside the visible area
+ */
+typedef void (*vga_scanline_cb_t)(void* user_data, uint16_t row, const uint8_t* pixels);
+
 /**
  * VGA state
  */
@@ -35,15 +57,44 @@ typedef struct vga_t {
     /* Reference to CPU */
     gigatron_t* cpu;
     
-    /* Framebuffer (RGBA format, 4 bytes per pixel) */
+    /* Framebuffer (see vga_set_framebuffer, RGBA 640x480 by default) */
     uint8_t* pixels;
-    uint32_t width;
-    uint32_t height;
+    uint32_t width;         /* Output width in pixels (160 * scale) */
+    uint32_t height;        /* Output height in pixels (120 * scale) */
+    uint32_t stride;        /* Bytes per output row */
+    vga_format_t format;
+    uint32_t scale;         /* 1, 2 or 4 */
+    
+    /* Default framebuffer owned by the VGA emulation */
+    uint8_t* own_pixels;
+    
+    /* Color lookup for the current format (6-bit color -> packed pixel) */
+    uint32_t palette[64];
+    
+    /* Current scanline as 6-bit colors, converted to the framebuffer on HSYNC */
+    uint8_t line[VGA_NATIVE_WIDTH];
+    bool line_pending;
+    
+    /* Fill lines without pixel burst with a copy of the line above */
+    bool replicate_lines;
+    
+    /* Video mode detection (the ROM can blank 1-3 of each 4 lines) */
+    bool group_has_pixels;          /* First line of current 4-line group had pixels */
+    uint8_t group_pixel_lines;      /* Pixel lines seen in current group */
+    uint32_t mode_votes[4];         /* Groups per pixel line count, current frame */
+    uint8_t pixel_lines;            /* Pixel lines per group in last frame (0 = unknown) */
+    uint32_t mode_frames[4];        /* Frames seen with 1, 2, 3 or 4 pixel lines per group */
+    uint32_t replicated_lines;      /* Lines filled by replication */
+    
+    /* Rolling hash over the 6-bit pixels of each frame */
+    uint64_t line_hash;             /* Accumulator for the current frame */
+    uint64_t frame_hash;            /* Hash of the last completed frame */
+    bool frame_changed;             /* Last frame differs from the one before */
+    uint32_t duplicate_frames;      /* Frames identical to their predecessor */
     
     /* Timing state */
     uint16_t row;           /* Current scanline */
     uint16_t col;           /* Current column (in Gigatron pixels, 4x horizontal) */
-    uint32_t pixel_index;   /* Current pixel index in framebuffer */
     
     /* Previous OUT register value for edge detection */
     uint8_t prev_out;
@@ -54,6 +105,10 @@ typedef struct vga_t {
     uint16_t min_col;
     uint16_t max_col;
     
+    /* Scanline callback (NULL if unused) */
+    vga_scanline_cb_t scanline_cb;
+    void* scanline_user_data;
+    
     /* Frame counter */
     uint32_t frame_count;
     
@@ -77,6 +132,40 @@ void vga_shutdown(vga_t* vga);
  */
 void vga_reset(vga_t* vga);
 
+/**
+ * Render into caller-provided memory instead of the internal buffer.
+ * The buffer must hold (120 * scale) rows of `stride` bytes, each row at
+ * least (160 * scale) pixels in `format`. Scale is 1 (160x120), 2 (320x240)
+ * or 4 (640x480). Pass NULL to return to the internal RGBA 640x480 buffer.
+ * The buffer is not cleared. Returns false on invalid arguments.
+ */
+bool vga_set_framebuffer(vga_t* vga, void* pixels, uint32_t stride,
+                         vga_format_t format, uint32_t scale);
+
+/**
+ * Register a callback for every HSYNC falling edge, NULL to remove it.
+ * The callback is only checked on the edge itself, not per tick, so an
+ * unused hook costs nothing in the per-cycle loop.
+ */
+static inline void vga_set_scanline_callback(vga_t* vga, vga_scanline_cb_t cb, void* user_data) {
+    if (vga) {
+        vga->scanline_cb = cb;
+        vga->scanline_user_data = user_data;
+    }
+}
+
+/**
+ * Enable or disable replication of blank lines.
+ * In video modes that emit pixels on only some of each 4 scanlines, the
+ * blank lines are filled by one bulk copy of the line above instead of
+ * being converted as black pixels.
+ */
+static inline void vga_set_line_replication(vga_t* vga, bool enable) {
+    if (vga) {
+        vga->replicate_lines = enable;
+    }
+}
+
 /**
  * Advance VGA simulation by one tick.
  * Should be called once per CPU cycle.
@@ -85,7 +174,7 @@ void vga_tick(vga_t* vga);
 
 /**
  * Get pointer to framebuffer.
- * Format: RGBA, width * height * 4 bytes
+ * Format: vga->format, vga->height rows of vga->stride bytes
  */
 static inline const uint8_t* vga_get_framebuffer(const vga_t* vga) {
     return vga->pixels;
@@ -108,6 +197,43 @@ static inline uint32_t vga_get_frame_count(const vga_t* vga) {
     return vga->frame_count;
 }
 
+/**
+ * Get the pixel hash of the last completed frame.
+ * Equal hashes mean identical frames, downstream consumers can skip work.
+ * The hash covers the 6-bit pixels, not the framebuffer format or line
+ * replication setting.
+ */
+static inline uint64_t vga_get_frame_hash(const vga_t* vga) {
+    return vga->frame_hash;
+}
+
+/**
+ * Check if the last completed frame differs from the one before it.
+ */
+static inline bool vga_frame_changed(const vga_t* vga) {
+    return vga->frame_changed;
+}
+
+/**
+ * Get the detected video mode as pixel lines per 4-line group.
+ * Returns 4 for full resolution, 1-3 for the ROM's faster modes,
+ * 0 if no frame with pixels was seen yet.
+ */
+static inline uint8_t vga_get_pixel_lines(const vga_t* vga) {
+    return vga->pixel_lines;
+}
+
+/**
+ * Get bytes per pixel for a framebuffer format.
+ */
+static inline uint32_t vga_format_bytes_per_pixel(vga_format_t format) {
+    switch (format) {
+        case VGA_FORMAT_RGB565: return 2;
+        case VGA_FORMAT_INDEX8: return 1;
+        default:                return 4;
+    }
+}
+
 /**
  * Convert 6-bit Gigatron color to RGBA.
  * Input: BBGGRR (2 bits each, R in low bits)
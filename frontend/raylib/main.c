@@ -9,6 +9,8 @@
 #include "vga.h"
 #include "audio.h"
 #include "loader.h"
+#include "pacer.h"
+#include "machine.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -40,10 +42,14 @@ typedef struct {
     vga_t vga;
     audio_t audio;
     loader_t loader;
+    machine_t machine;
+    pacer_t pacer;
     
     /* Graphics */
     Texture2D screen_texture;
     Image screen_image;
+    uint64_t uploaded_hash;     /* Frame hash of the screen texture contents */
+    bool screen_dirty;          /* Framebuffer changed outside a frame (stepping) */
     
     /* State flags */
     bool rom_loaded;
@@ -243,20 +249,14 @@ static void update_input(void) {
         }
     }
     if (IsKeyPressed(KEY_F6)) {
-        /* Step one frame */
+        /* Step to the start of the next frame (bounded in case there is no VSYNC) */
         if (state.rom_loaded && !state.emulator_running) {
-            const uint32_t cycles_per_frame = state.cpu.hz / 60;
-            for (uint32_t i = 0; i < cycles_per_frame; i++) {
-                if (!loader_is_active(&state.loader)) {
-                    state.cpu.in_reg = state.button_state ^ 0xFF;
-                }
-                gigatron_tick(&state.cpu);
-                vga_tick(&state.vga);
-                audio_tick(&state.audio);
-                if (loader_is_active(&state.loader)) {
-                    loader_tick(&state.loader);
-                }
-            }
+            machine_set_input(&state.machine, state.button_state ^ 0xFF);
+            machine_until_t until = { MACHINE_STOP_VSYNC | MACHINE_STOP_CYCLES, 0, 0,
+                                      2 * GIGATRON_CYCLES_PER_FRAME };
+            machine_run_until(&state.machine, &until);
+            audio_update(&state.audio);
+            state.screen_dirty = true;
             set_status("Stepped 1 frame");
         }
     }
@@ -266,27 +266,20 @@ static void update_input(void) {
  * Emulator Core
  * ============================================================================ */
 
-static void run_emulator_frame(void) {
+static void run_emulator_frames(uint32_t frames) {
     if (!state.rom_loaded || !state.emulator_running) return;
     
-    /* Run enough cycles for ~60fps (6.25MHz / 60 = ~104166 cycles per frame) */
-    const uint32_t cycles_per_frame = state.cpu.hz / 60;
-    
-    for (uint32_t i = 0; i < cycles_per_frame; i++) {
-        /* Only update input from user when loader is not active */
-        if (!loader_is_active(&state.loader)) {
-            state.cpu.in_reg = state.button_state ^ 0xFF;  /* Active low */
-        }
-        
-        gigatron_tick(&state.cpu);
-        vga_tick(&state.vga);
-        audio_tick(&state.audio);
+    /* One Gigatron frame per pacer period (521 lines of 200 cycles) */
+    for (uint32_t i = 0; i < frames; i++) {
+        /* Only reaches in_reg while the loader is not active */
+        machine_set_input(&state.machine, state.button_state ^ 0xFF);  /* Active low */
         
-        if (loader_is_active(&state.loader)) {
-            loader_tick(&state.loader);
-        }
+        machine_run(&state.machine, GIGATRON_CYCLES_PER_FRAME);
     }
     
+    /* Render the frame's audio in one batch */
+    audio_update(&state.audio);
+    
     /* Check loader status */
     if (loader_is_complete(&state.loader)) {
         set_status("GT1 loaded successfully");
@@ -302,6 +295,9 @@ static void update_screen_texture(void) {
     
     /* Update image data from VGA framebuffer */
     UpdateTexture(state.screen_texture, state.vga.pixels);
+    
+    state.uploaded_hash = vga_get_frame_hash(&state.vga);
+    state.screen_dirty = false;
 }
 
 /* ============================================================================
@@ -345,8 +341,8 @@ static void draw_debug_panel(void) {
     int y = panel_y + 10;
     
     /* Panel background */
-    DrawRectangle(panel_x, panel_y, panel_width, 400, (Color){30, 30, 45, 230});
-    DrawRectangleLines(panel_x, panel_y, panel_width, 400, COLOR_ACCENT);
+    DrawRectangle(panel_x, panel_y, panel_width, 496, (Color){30, 30, 45, 230});
+    DrawRectangleLines(panel_x, panel_y, panel_width, 496, COLOR_ACCENT);
     
     /* Title */
     DrawText("Debug Info", panel_x + 10, y, 18, COLOR_ACCENT);
@@ -359,7 +355,25 @@ static void draw_debug_panel(void) {
     y += line_height;
     DrawText(TextFormat("VGA Frames: %u", state.vga.frame_count), panel_x + 10, y, 14, COLOR_TEXT);
     y += line_height;
+    DrawText(TextFormat("Video Mode: %u/4 lines", vga_get_pixel_lines(&state.vga)), panel_x + 10, y, 14, COLOR_TEXT);
+    y += line_height;
+    DrawText(TextFormat("Duplicate Frames: %u", state.vga.duplicate_frames), panel_x + 10, y, 14, COLOR_TEXT);
+    y += line_height;
     DrawText(TextFormat("CPU Cycles: %llu", (unsigned long long)state.cpu.cycles), panel_x + 10, y, 14, COLOR_TEXT);
+    y += line_height;
+    DrawText(TextFormat("Audio Latency: %.1f ms (x%.4f)", audio_get_latency_ms(&state.audio),
+                        audio_get_rate_ratio(&state.audio)), panel_x + 10, y, 14, COLOR_TEXT);
+    y += line_height;
+    DrawText(TextFormat("Underruns: %u  Overruns: %u", audio_get_underruns(&state.audio),
+                        audio_get_overruns(&state.audio)), panel_x + 10, y, 14, COLOR_TEXT);
+    y += line_height;
+    pacer_stats_t pacing;
+    pacer_get_stats(&state.pacer, &pacing);
+    DrawText(TextFormat("Jitter: %.0f us avg, %.0f max", pacing.mean_us, pacing.max_us),
+             panel_x + 10, y, 14, COLOR_TEXT);
+    y += line_height;
+    DrawText(TextFormat("Late Frames: %llu", (unsigned long long)pacing.late_frames),
+             panel_x + 10, y, 14, COLOR_TEXT);
     y += line_height + 10;
     
     /* CPU Registers */
@@ -470,9 +484,9 @@ static void draw_controls_help(void) {
 
 int main(int argc, char* argv[]) {
     /* Initialize window */
-    SetConfigFlags(FLAG_WINDOW_RESIZABLE | FLAG_VSYNC_HINT);
+    /* No vsync or target FPS: the pacer runs the loop at the Gigatron's frame rate */
+    SetConfigFlags(FLAG_WINDOW_RESIZABLE);
     InitWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Gigatron TTL Emulator");
-    SetTargetFPS(60);
     
     /* Initialize audio */
     InitAudioDevice();
@@ -487,6 +501,12 @@ int main(int argc, char* argv[]) {
     vga_init(&state.vga, &state.cpu);
     audio_init(&state.audio, &state.cpu);
     loader_init(&state.loader, &state.cpu);
+    machine_init(&state.machine, &state.cpu, &state.vga, &state.loader);
+    
+    /* Host clock vs audio clock: let the output rate absorb the drift */
+    audio_set_rate_control(&state.audio, true, 2048 + AUDIO_SAMPLE_RATE / 60);
+    
+    pacer_init(&state.pacer, pacer_frame_period_ns(state.cpu.hz));
     
     /* Create screen texture */
     state.screen_image = GenImageColor(VGA_WIDTH, VGA_HEIGHT, BLACK);
@@ -498,6 +518,7 @@ int main(int argc, char* argv[]) {
     state.emulator_running = false;
     state.show_debug = false;
     state.button_state = 0;
+    state.screen_dirty = true;
     
     /* Try to load default ROM */
     if (load_rom("roms/gigatron.rom")) {
@@ -516,6 +537,9 @@ int main(int argc, char* argv[]) {
     
     /* Main loop */
     while (!WindowShouldClose()) {
+        /* Sleep/spin until the next Gigatron frame is due */
+        uint32_t due = pacer_wait(&state.pacer);
+        
         /* Timing */
         state.frame_time = GetFrameTime();
         state.fps = GetFPS();
@@ -539,10 +563,12 @@ int main(int argc, char* argv[]) {
         }
         
         /* Run emulator */
-        run_emulator_frame();
+        run_emulator_frames(due);
         
-        /* Update screen texture */
-        if (vga_frame_ready(&state.vga) || !state.emulator_running) {
+        /* Update screen texture, frames identical to the uploaded one are skipped */
+        bool new_frame = vga_frame_ready(&state.vga) &&
+                         vga_get_frame_hash(&state.vga) != state.uploaded_hash;
+        if (new_frame || state.screen_dirty) {
             update_screen_texture();
         }
         
@@ -585,6 +611,7 @@ int main(int argc, char* argv[]) {
     }
     
     /* Cleanup */
+    pacer_shutdown(&state.pacer);
     loader_shutdown(&state.loader);
     audio_shutdown(&state.audio);
     vga_shutdown(&state.vga);
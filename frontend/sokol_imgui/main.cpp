@@ -24,35 +24,232 @@ extern "C" {
 #include "vga.h"
 #include "audio.h"
 #include "loader.h"
+#include "scheduler.h"
+#include "pacer.h"
+#include "machine.h"
+#include "profiler.h"
+#include "vcpu_profiler.h"
+#include "access_map.h"
+#include "trace.h"
+#include "perf.h"
+#include "disasm.h"
+#include "recorder.h"
 }
 
 #include <cstdio>
 #include <cstring>
 #include <cmath>
+#include <atomic>
+#include <thread>
+
+/* ============================================================================
+ * Thread Handoff
+ * ============================================================================ */
+
+#define FRAME_SIZE          (VGA_WIDTH * VGA_HEIGHT * 4)
+#define FRAME_INDEX_MASK    0x3u
+#define FRAME_FRESH         0x4u    /* Middle buffer holds a frame the UI hasn't taken */
+#define HEATMAP_SIZE        256     /* ROM heatmap: one row per 256-word page */
+#define HEATMAP_REFRESH     0.5     /* Seconds between heatmap updates */
+#define PROFILER_UI_TOP     20      /* Hot spots listed in the profiler window */
+#define VCPU_UI_TOP         12      /* Opcodes listed in the vCPU section */
+#define EMU_MAX_SLICE       0.1     /* Longer stalls are not caught up (seconds) */
+#define RAM_HEATMAP_WIDTH   256     /* RAM heatmap: one row per 256-byte page */
+#define RAM_HEATMAP_DECAY   0.9f    /* Heat kept from one UI frame to the next */
+#define DISASM_FOLLOW_MARGIN 3     /* Rows kept between a followed PC and the window edge */
+#define MEMVIEW_BYTES_PER_ROW 16
+#define MEMVIEW_LINE_SIZE   128
+#define MEMVIEW_FADE_FRAMES 30      /* Frames a changed byte stays highlighted */
+#define SPEED_SMOOTHING     0.05    /* Weight of the newest sample in emulator_speed */
+
+/* Lock-free single producer / single consumer queue */
+template <typename T, uint32_t N>
+struct spsc_queue {
+    static_assert((N & (N - 1)) == 0, "Queue size must be a power of two");
+    
+    T items[N];
+    alignas(64) std::atomic<uint32_t> head{0};  /* Written by the producer */
+    alignas(64) std::atomic<uint32_t> tail{0};  /* Written by the consumer */
+    
+    bool push(const T& item) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N) return false;
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    
+    bool pop(T& item) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        item = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+/* Requests from the UI, executed on the emulation thread */
+enum emu_command_type_t {
+    EMU_CMD_LOAD_ROM,
+    EMU_CMD_LOAD_GT1,
+    EMU_CMD_RESET,
+    EMU_CMD_SET_RUNNING,
+    EMU_CMD_STEP_CYCLE,
+    EMU_CMD_STEP_FRAME,
+    EMU_CMD_SET_SYNC_AUDIO,
+    EMU_CMD_SET_REPLICATE,
+    EMU_CMD_SET_AUDIO_QUALITY,
+    EMU_CMD_ADD_BREAKPOINT,
+    EMU_CMD_REMOVE_BREAKPOINT,
+    EMU_CMD_ENABLE_BREAKPOINT,
+    EMU_CMD_DISABLE_BREAKPOINT,
+    EMU_CMD_SET_PROFILING,
+    EMU_CMD_RESET_PROFILE,
+    EMU_CMD_EXPORT_PROFILE,
+    EMU_CMD_SET_VCPU_PROFILING,
+    EMU_CMD_EXPORT_VCPU_PROFILE,    /* arg: 0 = report, 1 = folded stacks */
+    EMU_CMD_START_TRACE,
+    EMU_CMD_STOP_TRACE,
+    EMU_CMD_SET_PERF,
+    EMU_CMD_SET_ACCESS_MAP,
+    EMU_CMD_START_RECORDING,
+    EMU_CMD_STOP_RECORDING,
+};
+
+struct emu_command_t {
+    emu_command_type_t type;
+    int32_t arg;
+    char path[512];
+    machine_breakpoint_t breakpoint;
+};
+
+/* Emulator state published to the UI after every slice */
+struct emu_snapshot_t {
+    gigatron_t cpu;             /* In the UI's copy cpu.ram points to ram below */
+    uint8_t ram[1 << 16];       /* RAM at the frame handoff */
+    bool rom_loaded;
+    bool running;
+    uint32_t frame_count;
+    uint8_t pixel_lines;
+    uint32_t replicated_lines;
+    uint32_t duplicate_frames;
+    uint32_t audio_overruns;
+    double audio_rate_ratio;
+    double speed;
+    int32_t fill_error;
+    pacer_stats_t pacing;
+    machine_breakpoint_t breakpoints[MACHINE_MAX_BREAKPOINTS];
+    uint32_t num_breakpoints;
+    int32_t break_index;
+    bool profiling;
+    bool vcpu_profiling;
+    bool vcpu_found;            /* Interpreter located in the ROM */
+    bool tracing;
+    bool recording;
+    uint64_t rec_frames;
+    uint64_t rec_elided;
+    uint64_t rec_dropped_frames;
+    uint64_t rec_dropped_samples;
+    bool perf_on;
+    perf_stats_t perf;
+    uint32_t rom_generation;
+    int loader_state;
+    char rom_path[512];
+};
 
 /* ============================================================================
  * Application State
  * ============================================================================ */
 
 static struct {
-    /* Emulator core */
+    /* Emulator core, owned by the emulation thread once it runs */
     gigatron_t cpu;
     vga_t vga;
     audio_t audio;
     loader_t loader;
+    machine_t machine;
+    profiler_t profiler;        /* Counters are read live by the profiler window */
+    vcpu_profiler_t vcpu_profiler;
+    trace_writer_t tracer;      /* Open while machine.tracer is set */
+    recorder_t recorder;        /* Fed by the VGA and audio callbacks while recording */
+    bool recording;
+    bool recording_started;     /* Callbacks attached, from the first VSYNC after opening */
+    perf_t perf;                /* Host time per device, attached while the overlay shows */
+    access_map_t access_map;    /* RAM access counters, read live by the RAM heatmap */
+    uint64_t perf_frame_cycle;  /* Cycle count at the last frame boundary */
+    scheduler_t scheduler;
+    pacer_t pacer;
+    bool sync_to_audio;         /* Pace emulation by audio demand instead of real time */
+    bool audio_valid;
+    bool emulator_running;
+    bool rom_loaded;
+    uint32_t rom_generation;    /* Incremented on every ROM load */
+    char rom_path[512];
+    uint8_t emu_buttons;        /* Button state applied to the CPU */
+    double cycle_carry;         /* Fractional cycles of real-time pacing */
+    bool force_publish;         /* Next frame changed without changing its hash */
+    int32_t break_index;        /* Breakpoint that paused emulation, -1 if none */
+    
+    /* Emulation thread and its queues */
+    std::thread emu_thread;
+    std::atomic<bool> emu_quit;
+    spsc_queue<emu_command_t, 16> commands;     /* UI -> emulation */
+    spsc_queue<uint8_t, 64> input_queue;        /* UI -> emulation, button states */
+    bool input_pending;                         /* button_state did not fit, retried next frame */
+    std::atomic<const char*> emu_status;        /* Emulation -> UI, static strings only */
+    
+    /* Snapshot published with a seqlock, and the UI's copy of it */
+    std::atomic<uint32_t> snapshot_seq;
+    emu_snapshot_t snapshot;
+    emu_snapshot_t view;
+    
+    /* Triple-buffered framebuffer: back (emulation), middle (handoff), front (UI) */
+    uint8_t frame_buffers[3][FRAME_SIZE];
+    uint64_t frame_hash[3];
+    bool frame_forced[3];       /* Upload even if the hash matches */
+    uint32_t frame_back;
+    std::atomic<uint32_t> frame_middle;
+    uint32_t frame_front;
     
     /* Graphics */
     sg_pass_action pass_action;
     sg_image screen_texture;
     sg_sampler screen_sampler;
     sg_view screen_view;
+    sg_image heatmap_texture;
+    sg_view heatmap_view;
+    sg_image ram_heatmap_texture;
+    sg_view ram_heatmap_view;
+    uint64_t uploaded_hash;     /* Frame hash of the screen texture contents */
+    bool screen_dirty;          /* Framebuffer changed outside a frame (stepping) */
     
     /* UI state */
     bool show_debug_window;
     bool show_cpu_state;
     bool show_memory_viewer;
-    bool emulator_running;
-    bool rom_loaded;
+    bool show_profiler;
+    bool show_perf_overlay;
+    bool show_ram_heatmap;
+    bool show_disassembly;
+    
+    /* Disassembly cache, its native lines belong to ROM generation disasm_rom */
+    disasm_cache_t disasm;
+    uint32_t disasm_rom;
+    
+    /* RAM heatmap: counters at the previous UI frame and decayed heat */
+    uint32_t heat_prev_reads[1 << 16];
+    uint32_t heat_prev_writes[1 << 16];
+    float heat_reads[1 << 16];
+    float heat_writes[1 << 16];
+    bool heat_primed;
+    
+    /* Memory viewer change highlighting */
+    uint8_t mem_prev[1 << 16];  /* RAM at the previous UI frame */
+    uint8_t mem_age[1 << 16];   /* Frames left to highlight each byte */
+    bool mem_primed;            /* mem_prev holds the previous frame */
+    bool ui_sync_to_audio;
+    bool ui_replicate_lines;
+    audio_quality_t ui_audio_quality;
     
     /* Input state */
     uint8_t button_state;
@@ -63,14 +260,12 @@ static struct {
     /* Performance metrics */
     uint64_t last_time;
     double frame_time_ms;
-    double emulator_speed;
+    double emulator_speed;      /* Emulated cycles per second relative to the nominal clock */
+    uint64_t speed_cycles;      /* CPU cycles at the previous UI frame */
     
     /* Status message */
     char status_message[256];
     float status_timeout;
-    
-    /* ROM path */
-    char rom_path[512];
 } state;
 
 /* ============================================================================
@@ -82,6 +277,46 @@ static void set_status(const char* msg) {
     state.status_timeout = 3.0f;
 }
 
+/* Status from the emulation thread, shown by the UI on its next frame */
+static void emu_set_status(const char* msg) {
+    state.emu_status.store(msg, std::memory_order_release);
+}
+
+/* Queue a request for the emulation thread */
+static void send_command(emu_command_type_t type, int32_t arg = 0, const char* path = nullptr) {
+    emu_command_t cmd = {};
+    cmd.type = type;
+    cmd.arg = arg;
+    if (path) {
+        strncpy(cmd.path, path, sizeof(cmd.path) - 1);
+    }
+    if (!state.commands.push(cmd)) {
+        set_status("Emulator busy, request dropped");
+    }
+}
+
+static void send_breakpoint(const machine_breakpoint_t& bp) {
+    emu_command_t cmd = {};
+    cmd.type = EMU_CMD_ADD_BREAKPOINT;
+    cmd.breakpoint = bp;
+    if (!state.commands.push(cmd)) {
+        set_status("Emulator busy, request dropped");
+    }
+}
+
+/* Show or hide the performance overlay, host time accounting runs only while it shows */
+static void set_perf_overlay(bool show) {
+    state.show_perf_overlay = show;
+    send_command(EMU_CMD_SET_PERF, show);
+}
+
+/* Show or hide the RAM heatmap, accesses are counted only while it shows */
+static void set_ram_heatmap(bool show) {
+    state.show_ram_heatmap = show;
+    state.heat_primed = false;
+    send_command(EMU_CMD_SET_ACCESS_MAP, show);
+}
+
 /* ============================================================================
  * Audio Callback
  * ============================================================================ */
@@ -103,6 +338,7 @@ static void audio_callback(float* buffer, int num_frames, int num_channels) {
  * File Operations
  * ============================================================================ */
 
+/* Runs on the emulation thread (or before it starts) */
 static bool load_rom(const char* path) {
     if (gigatron_load_rom_file(&state.cpu, path)) {
         gigatron_reset(&state.cpu);
@@ -110,25 +346,33 @@ static bool load_rom(const char* path) {
         audio_reset(&state.audio);
         loader_reset(&state.loader);
         state.rom_loaded = true;
+        state.rom_generation++;
         state.emulator_running = true;
+        scheduler_reset(&state.scheduler);
+        
+        /* The interpreter may sit elsewhere in another ROM version */
+        if (!vcpu_profiler_locate(&state.vcpu_profiler, &state.cpu)) {
+            machine_set_vcpu_profiler(&state.machine, nullptr);
+        }
         strncpy(state.rom_path, path, sizeof(state.rom_path) - 1);
-        set_status("ROM loaded successfully");
+        emu_set_status("ROM loaded successfully");
         return true;
     }
-    set_status("Failed to load ROM");
+    emu_set_status("Failed to load ROM");
     return false;
 }
 
+/* Runs on the emulation thread */
 static bool load_gt1(const char* path) {
     gt1_file_t* gt1 = loader_load_gt1_file(path);
     if (gt1) {
         if (loader_start(&state.loader, gt1)) {
-            set_status("Loading GT1 file...");
+            emu_set_status("Loading GT1 file...");
             return true;
         }
         loader_free_gt1(gt1);
     }
-    set_status("Failed to load GT1 file");
+    emu_set_status("Failed to load GT1 file");
     return false;
 }
 
@@ -138,7 +382,7 @@ static void open_rom_dialog() {
     nfdresult_t result = NFD_OpenDialog(&path, filters, 1, NULL);
     
     if (result == NFD_OKAY) {
-        load_rom(path);
+        send_command(EMU_CMD_LOAD_ROM, 0, path);
         NFD_FreePath(path);
     }
 }
@@ -149,7 +393,29 @@ static void open_gt1_dialog() {
     nfdresult_t result = NFD_OpenDialog(&path, filters, 1, NULL);
     
     if (result == NFD_OKAY) {
-        load_gt1(path);
+        send_command(EMU_CMD_LOAD_GT1, 0, path);
+        NFD_FreePath(path);
+    }
+}
+
+static void start_trace_dialog() {
+    nfdchar_t* path = NULL;
+    nfdfilteritem_t filters[1] = { { "Gigatron Traces", "gtt" } };
+    nfdresult_t result = NFD_SaveDialog(&path, filters, 1, NULL, "trace.gtt");
+    
+    if (result == NFD_OKAY) {
+        send_command(EMU_CMD_START_TRACE, 0, path);
+        NFD_FreePath(path);
+    }
+}
+
+static void start_recording_dialog() {
+    nfdchar_t* path = NULL;
+    nfdfilteritem_t filters[2] = { { "Y4M Video", "y4m" }, { "Indexed Video", "gtv" } };
+    nfdresult_t result = NFD_SaveDialog(&path, filters, 2, NULL, "recording.y4m");
+    
+    if (result == NFD_OKAY) {
+        send_command(EMU_CMD_START_RECORDING, 0, path);
         NFD_FreePath(path);
     }
 }
@@ -158,60 +424,435 @@ static void open_gt1_dialog() {
  * Emulator Core
  * ============================================================================ */
 
-/* Execute one frame of emulation (used by step function) */
-static void run_one_frame() {
-    if (!state.rom_loaded) return;
+/* Hand the finished frame to the UI and continue in the free buffer */
+static void emu_publish_frame(bool forced) {
+    state.frame_hash[state.frame_back] = vga_get_frame_hash(&state.vga);
+    state.frame_forced[state.frame_back] = forced || state.force_publish;
+    state.force_publish = false;
+    
+    uint32_t prev = state.frame_middle.exchange(state.frame_back | FRAME_FRESH, std::memory_order_acq_rel);
+    state.frame_back = prev & FRAME_INDEX_MASK;
+    vga_set_framebuffer(&state.vga, state.frame_buffers[state.frame_back], VGA_WIDTH * 4,
+                        VGA_FORMAT_RGBA8888, VGA_MAX_SCALE);
+}
+
+/* Publish the frame in progress (stepping), the beam continues on a copy */
+static void emu_publish_partial() {
+    const uint8_t* current = state.frame_buffers[state.frame_back];
+    emu_publish_frame(true);
+    memcpy(state.frame_buffers[state.frame_back], current, FRAME_SIZE);
+}
+
+/* Apply the next queued button state, one change per frame so taps aren't lost */
+static void emu_apply_input() {
+    uint8_t buttons;
+    if (state.input_queue.pop(buttons)) {
+        state.emu_buttons = buttons;
+    }
+}
+
+/* Close the recorded frame at VSYNC; the first one attaches the callbacks so audio and video start together */
+static void record_frame() {
+    if (state.recording_started) {
+        recorder_end_frame(&state.recorder, vga_get_frame_hash(&state.vga));
+        return;
+    }
     
-    /* Run enough cycles for ~60fps (6.25MHz / 60 = ~104166 cycles per frame) */
-    const uint32_t cycles_per_frame = state.cpu.hz / 60;
+    /* Audio up to the boundary is rendered untapped */
+    audio_update(&state.audio);
+    vga_set_scanline_callback(&state.vga, recorder_scanline, &state.recorder);
+    audio_set_sample_callback(&state.audio, recorder_audio, &state.recorder);
+    state.recording_started = true;
+}
+
+/* Run until a MACHINE_STOP_* condition or the cycle budget, handing over a frame at each VSYNC */
+static uint32_t run_until(uint32_t stop, uint64_t cycles) {
+    if (!state.rom_loaded) return 0;
+    
+    machine_until_t until = {};
+    until.flags = stop | MACHINE_STOP_VSYNC | MACHINE_STOP_CYCLES;
+    const uint64_t end = state.cpu.cycles + cycles;
+    uint32_t hit = 0;
     
-    for (uint32_t i = 0; i < cycles_per_frame; i++) {
+    while (!(hit & (stop | MACHINE_STOP_CYCLES | MACHINE_STOP_BREAK))) {
         /* 
          * IMPORTANT: Only update input from user when loader is not active!
          * The loader controls in_reg to send data bits via the serial protocol.
          * This matches jsemu behavior where gamepad.stop() is called during loading.
+         * Buttons only change at VSYNC; the machine hands them to in_reg on the
+         * cycle the loader finishes.
          */
-        if (!loader_is_active(&state.loader)) {
-            state.cpu.in_reg = state.button_state ^ 0xFF;  /* Active low */
-        }
+        machine_set_input(&state.machine, state.emu_buttons ^ 0xFF);  /* Active low */
         
-        gigatron_tick(&state.cpu);
-        vga_tick(&state.vga);
-        audio_tick(&state.audio);
+        until.cycles = end - state.cpu.cycles;
+        hit = machine_run_until(&state.machine, &until);
         
-        if (loader_is_active(&state.loader)) {
-            loader_tick(&state.loader);
+        /* Frame boundary: hand over the picture */
+        if ((hit & MACHINE_STOP_VSYNC) && vga_frame_ready(&state.vga)) {
+            emu_publish_frame(false);
+            emu_apply_input();
+            if (state.recording) {
+                record_frame();
+            }
+            if (state.machine.perf) {
+                /* A reset (also by the loader) restarts the cycle count */
+                uint64_t start = state.cpu.cycles >= state.perf_frame_cycle ? state.perf_frame_cycle : 0;
+                perf_end_frame(&state.perf, state.cpu.cycles - start);
+                state.perf_frame_cycle = state.cpu.cycles;
+            }
         }
     }
     
+    /* Breakpoint: pause where it triggered */
+    if (hit & MACHINE_STOP_BREAK) {
+        state.emulator_running = false;
+        state.break_index = state.machine.last_break;
+        emu_set_status("Breakpoint hit");
+    }
+    
+    /* Render the run's audio in one batch */
+    if (state.machine.perf) {
+        uint64_t start = perf_ticks();
+        audio_update(&state.audio);
+        perf_add(&state.perf, PERF_AUDIO, perf_ticks() - start);
+    } else {
+        audio_update(&state.audio);
+    }
+    
     /* Check loader status */
     if (loader_is_complete(&state.loader)) {
-        set_status("GT1 loaded successfully");
+        emu_set_status("GT1 loaded successfully");
         loader_reset(&state.loader);
     } else if (loader_has_error(&state.loader)) {
-        set_status(loader_get_error(&state.loader) ? loader_get_error(&state.loader) : "Loader error");
+        emu_set_status(loader_get_error(&state.loader) ? loader_get_error(&state.loader) : "Loader error");
         loader_reset(&state.loader);
     }
+    
+    return hit;
+}
+
+/* Execute a number of CPU cycles */
+static uint32_t run_cycles(uint32_t cycles) {
+    return run_until(0, cycles);
 }
 
-static void run_emulator_frame() {
+/* Run to the start of the next frame (used by step function) */
+static uint32_t run_one_frame() {
+    /* Bounded in case the ROM generates no VSYNC */
+    return run_until(MACHINE_STOP_VSYNC, 2 * GIGATRON_CYCLES_PER_FRAME);
+}
+
+/* Run the cycles that correspond to the elapsed host time */
+static void run_emulator_slice(double elapsed) {
     if (!state.rom_loaded || !state.emulator_running) return;
-    run_one_frame();
+    
+    if (elapsed > EMU_MAX_SLICE) {
+        elapsed = EMU_MAX_SLICE;
+    }
+    
+    uint32_t hit;
+    if (state.sync_to_audio && state.audio_valid) {
+        /* Audio-driven pacing: the device's demand decides how far to run */
+        hit = run_cycles(scheduler_next_cycles(&state.scheduler, elapsed,
+                                               audio_available_samples(&state.audio)));
+    } else {
+        /* Real time, rate control absorbs the audio clock's drift */
+        double cycles = (double)state.cpu.hz * elapsed + state.cycle_carry;
+        uint32_t whole = (uint32_t)cycles;
+        state.cycle_carry = cycles - (double)whole;
+        hit = run_cycles(whole);
+    }
+    
+    /* Show the picture as the breakpoint left it */
+    if (hit & MACHINE_STOP_BREAK) {
+        emu_publish_partial();
+    }
 }
 
-static void update_screen_texture() {
-    if (!state.vga.pixels) return;
+/* Runs on the emulation thread (or after it stopped) */
+static void stop_trace() {
+    if (!state.machine.tracer) return;
+    
+    machine_set_tracer(&state.machine, nullptr);
+    emu_set_status(trace_writer_close(&state.tracer) ? "Trace saved" : "Failed to write trace");
+}
+
+/* Record video to path (.y4m or indexed) and audio next to it (.wav) */
+static void start_recording(const char* path) {
+    if (state.recording) return;
+    
+    char audio_path[sizeof(emu_command_t::path) + 4];
+    snprintf(audio_path, sizeof(audio_path), "%s", path);
+    char* ext = nullptr;
+    for (char* c = audio_path; *c; c++) {
+        if (*c == '.') ext = c;
+        else if (*c == '/' || *c == '\\') ext = nullptr;
+    }
+    if (ext) *ext = '\0';
+    strcat(audio_path, ".wav");
+    
+    size_t length = strlen(path);
+    recorder_config_t config = recorder_default_config();
+    config.video = (length >= 4 && strcmp(path + length - 4, ".y4m") == 0) ? RECORDER_VIDEO_Y4M
+                                                                           : RECORDER_VIDEO_INDEXED;
+    config.video_path = path;
+    config.audio_path = audio_path;
+    config.sample_rate = state.audio.sample_rate;
+    if (!recorder_open(&state.recorder, &config, state.cpu.hz)) {
+        emu_set_status("Failed to create recording");
+        return;
+    }
+    state.recording = true;
+    state.recording_started = false;
+    emu_set_status("Recording");
+}
+
+/* Runs on the emulation thread (or after it stopped) */
+static void stop_recording() {
+    if (!state.recording) return;
+    
+    vga_set_scanline_callback(&state.vga, nullptr, nullptr);
+    audio_set_sample_callback(&state.audio, nullptr, nullptr);
+    state.recording = false;
+    state.recording_started = false;
+    emu_set_status(recorder_close(&state.recorder) ? "Recording saved" : "Failed to write recording");
+}
+
+static void execute_command(const emu_command_t& cmd) {
+    switch (cmd.type) {
+        case EMU_CMD_LOAD_ROM:
+            load_rom(cmd.path);
+            profiler_reset(&state.profiler);
+            vcpu_profiler_reset(&state.vcpu_profiler);
+            break;
+        case EMU_CMD_LOAD_GT1:
+            load_gt1(cmd.path);
+            break;
+        case EMU_CMD_RESET:
+            if (!state.rom_loaded) break;
+            gigatron_reset(&state.cpu);
+            vga_reset(&state.vga);
+            audio_reset(&state.audio);
+            loader_reset(&state.loader);
+            scheduler_reset(&state.scheduler);
+            emu_set_status("Emulator reset");
+            break;
+        case EMU_CMD_SET_RUNNING:
+            state.emulator_running = state.rom_loaded && cmd.arg;
+            state.break_index = -1;
+            scheduler_reset(&state.scheduler);
+            break;
+        case EMU_CMD_STEP_CYCLE:
+            if (!state.rom_loaded) break;
+            run_cycles(1);
+            emu_publish_partial();
+            break;
+        case EMU_CMD_STEP_FRAME:
+            if (!state.rom_loaded) break;
+            /* A completed frame was handed over at VSYNC */
+            if (!(run_one_frame() & MACHINE_STOP_VSYNC)) {
+                emu_publish_partial();
+            }
+            break;
+        case EMU_CMD_SET_SYNC_AUDIO:
+            state.sync_to_audio = cmd.arg != 0;
+            scheduler_reset(&state.scheduler);
+            /* The scheduler holds the fill itself, rate control would fight it */
+            audio_set_rate_control(&state.audio, !state.sync_to_audio, state.scheduler.target_samples);
+            break;
+        case EMU_CMD_SET_REPLICATE:
+            vga_set_line_replication(&state.vga, cmd.arg != 0);
+            state.force_publish = true;     /* Frame hash does not cover replication */
+            break;
+        case EMU_CMD_SET_AUDIO_QUALITY:
+            audio_set_quality(&state.audio, (audio_quality_t)cmd.arg);
+            break;
+        case EMU_CMD_ADD_BREAKPOINT:
+            if (machine_add_breakpoint(&state.machine, &cmd.breakpoint) < 0) {
+                emu_set_status("Breakpoint table full");
+            }
+            break;
+        case EMU_CMD_REMOVE_BREAKPOINT:
+            machine_remove_breakpoint(&state.machine, (uint32_t)cmd.arg);
+            state.break_index = -1;
+            break;
+        case EMU_CMD_ENABLE_BREAKPOINT:
+        case EMU_CMD_DISABLE_BREAKPOINT:
+            machine_enable_breakpoint(&state.machine, (uint32_t)cmd.arg, cmd.type == EMU_CMD_ENABLE_BREAKPOINT);
+            break;
+        case EMU_CMD_SET_PROFILING:
+            machine_set_profiler(&state.machine, cmd.arg ? &state.profiler : nullptr);
+            break;
+        case EMU_CMD_RESET_PROFILE:
+            profiler_reset(&state.profiler);
+            vcpu_profiler_reset(&state.vcpu_profiler);
+            break;
+        case EMU_CMD_EXPORT_PROFILE:
+            emu_set_status(profiler_write_report(&state.profiler, &state.cpu, cmd.path, PROFILER_REPORT_TOP) ?
+                           "Profile exported" : "Failed to export profile");
+            break;
+        case EMU_CMD_SET_VCPU_PROFILING:
+            if (!machine_set_vcpu_profiler(&state.machine, cmd.arg ? &state.vcpu_profiler : nullptr)) {
+                emu_set_status("vCPU interpreter not found in ROM");
+            }
+            break;
+        case EMU_CMD_EXPORT_VCPU_PROFILE: {
+            bool ok = cmd.arg ? vcpu_profiler_write_folded(&state.vcpu_profiler, cmd.path) :
+                                vcpu_profiler_write_report(&state.vcpu_profiler, cmd.path, PROFILER_REPORT_TOP);
+            emu_set_status(ok ? "vCPU profile exported" : "Failed to export vCPU profile");
+            break;
+        }
+        case EMU_CMD_START_TRACE:
+            if (state.machine.tracer) break;
+            if (trace_writer_open(&state.tracer, cmd.path, state.cpu.hz)) {
+                machine_set_tracer(&state.machine, &state.tracer);
+                emu_set_status("Tracing");
+            } else {
+                emu_set_status("Failed to create trace");
+            }
+            break;
+        case EMU_CMD_STOP_TRACE:
+            stop_trace();
+            break;
+        case EMU_CMD_START_RECORDING:
+            start_recording(cmd.path);
+            break;
+        case EMU_CMD_STOP_RECORDING:
+            stop_recording();
+            break;
+        case EMU_CMD_SET_PERF:
+            if (cmd.arg) {
+                perf_reset(&state.perf);
+                state.perf_frame_cycle = state.cpu.cycles;
+            }
+            machine_set_perf(&state.machine, cmd.arg ? &state.perf : nullptr);
+            break;
+        case EMU_CMD_SET_ACCESS_MAP:
+            if (!machine_set_access_map(&state.machine, cmd.arg ? &state.access_map : nullptr)) {
+                emu_set_status("RAM access counters unavailable");
+            }
+            break;
+    }
+}
+
+static void publish_snapshot() {
+    uint32_t seq = state.snapshot_seq.load(std::memory_order_relaxed);
+    state.snapshot_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    
+    emu_snapshot_t& snap = state.snapshot;
+    snap.cpu = state.cpu;
+    if (state.cpu.ram && state.cpu.ram_size <= sizeof(snap.ram)) {
+        memcpy(snap.ram, state.cpu.ram, state.cpu.ram_size);
+    } else {
+        snap.cpu.ram = nullptr;
+    }
+    snap.rom_loaded = state.rom_loaded;
+    snap.rom_generation = state.rom_generation;
+    snap.running = state.emulator_running;
+    snap.frame_count = state.vga.frame_count;
+    snap.pixel_lines = vga_get_pixel_lines(&state.vga);
+    snap.replicated_lines = state.vga.replicated_lines;
+    snap.duplicate_frames = state.vga.duplicate_frames;
+    snap.audio_overruns = audio_get_overruns(&state.audio);
+    snap.audio_rate_ratio = audio_get_rate_ratio(&state.audio);
+    snap.speed = scheduler_get_speed(&state.scheduler);
+    snap.fill_error = state.scheduler.fill_error;
+    pacer_get_stats(&state.pacer, &snap.pacing);
+    memcpy(snap.breakpoints, state.machine.breakpoints, sizeof(snap.breakpoints));
+    snap.num_breakpoints = state.machine.num_breakpoints;
+    snap.break_index = state.break_index;
+    snap.profiling = state.machine.profiler != nullptr;
+    snap.vcpu_profiling = state.machine.vcpu_profiler != nullptr;
+    snap.vcpu_found = state.vcpu_profiler.valid;
+    snap.tracing = state.machine.tracer != nullptr;
+    snap.recording = state.recording;
+    snap.rec_frames = state.recorder.frames;
+    snap.rec_elided = state.recorder.elided;
+    snap.rec_dropped_frames = state.recorder.dropped_frames;
+    snap.rec_dropped_samples = state.recorder.dropped_samples;
+    snap.perf_on = state.machine.perf != nullptr;
+    if (snap.perf_on) {
+        perf_get_stats(&state.perf, &snap.perf);
+    }
+    snap.loader_state = state.loader.state;
+    memcpy(snap.rom_path, state.rom_path, sizeof(snap.rom_path));
+    
+    state.snapshot_seq.store(seq + 2, std::memory_order_release);
+}
+
+static void emu_thread_main() {
+    pacer_init(&state.pacer, pacer_frame_period_ns(state.cpu.hz));
     
+    while (!state.emu_quit.load(std::memory_order_acquire)) {
+        /* Sleep/spin until the next Gigatron frame (~59.98 Hz) is due */
+        uint32_t due = pacer_wait(&state.pacer);
+        
+        emu_command_t cmd;
+        while (state.commands.pop(cmd)) {
+            execute_command(cmd);
+        }
+        
+        /* While paused only the latest button state matters */
+        if (!state.emulator_running) {
+            uint8_t buttons;
+            while (state.input_queue.pop(buttons)) {
+                state.emu_buttons = buttons;
+            }
+        }
+        
+        run_emulator_slice((double)due * (double)state.pacer.period_ns * 1e-9);
+        
+        publish_snapshot();
+    }
+    
+    pacer_shutdown(&state.pacer);
+}
+
+/* Copy the latest snapshot (retry while the emulation thread writes it) */
+static void read_snapshot() {
+    uint32_t before, after;
+    do {
+        before = state.snapshot_seq.load(std::memory_order_acquire);
+        memcpy(&state.view, &state.snapshot, sizeof(emu_snapshot_t));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = state.snapshot_seq.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    
+    /* The live RAM belongs to the emulation thread, the UI reads the copy */
+    if (state.view.cpu.ram) {
+        state.view.cpu.ram = state.view.ram;
+    }
+}
+
+/* Swap the newest published frame into the front buffer */
+static bool acquire_frame() {
+    if (!(state.frame_middle.load(std::memory_order_relaxed) & FRAME_FRESH)) return false;
+    
+    uint32_t prev = state.frame_middle.exchange(state.frame_front, std::memory_order_acq_rel);
+    state.frame_front = prev & FRAME_INDEX_MASK;
+    return true;
+}
+
+static void update_screen_texture() {
     sg_image_data img_data = {};
-    img_data.mip_levels[0].ptr = state.vga.pixels;
-    img_data.mip_levels[0].size = VGA_WIDTH * VGA_HEIGHT * 4;
+    img_data.mip_levels[0].ptr = state.frame_buffers[state.frame_front];
+    img_data.mip_levels[0].size = FRAME_SIZE;
     sg_update_image(state.screen_texture, &img_data);
+    
+    state.uploaded_hash = state.frame_hash[state.frame_front];
+    state.screen_dirty = false;
 }
 
 /* ============================================================================
  * Input Handling
  * ============================================================================ */
 
+/* Queue the button state; when the queue is full the latest state is retried next frame, coalescing the changes in between */
+static void queue_input() {
+    state.input_pending = !state.input_queue.push(state.button_state);
+}
+
 static void handle_key(sapp_keycode key, bool down) {
     uint8_t bit = 0;
     
@@ -256,6 +897,7 @@ static void handle_key(sapp_keycode key, bool down) {
     } else {
         state.button_state &= ~bit;
     }
+    queue_input();
 }
 
 /* ============================================================================
@@ -268,16 +910,27 @@ static void draw_main_menu() {
             if (ImGui::MenuItem("Open ROM...", "Ctrl+O")) {
                 open_rom_dialog();
             }
-            if (ImGui::MenuItem("Load GT1...", "Ctrl+L", false, state.rom_loaded)) {
+            if (ImGui::MenuItem("Load GT1...", "Ctrl+L", false, state.view.rom_loaded)) {
                 open_gt1_dialog();
             }
             ImGui::Separator();
-            if (ImGui::MenuItem("Reset", "F5", false, state.rom_loaded)) {
-                gigatron_reset(&state.cpu);
-                vga_reset(&state.vga);
-                audio_reset(&state.audio);
-                loader_reset(&state.loader);
-                set_status("Emulator reset");
+            if (ImGui::MenuItem("Reset", "F5", false, state.view.rom_loaded)) {
+                send_command(EMU_CMD_RESET);
+            }
+            ImGui::Separator();
+            if (state.view.tracing) {
+                if (ImGui::MenuItem("Stop Trace")) {
+                    send_command(EMU_CMD_STOP_TRACE);
+                }
+            } else if (ImGui::MenuItem("Start Trace...", nullptr, false, state.view.rom_loaded)) {
+                start_trace_dialog();
+            }
+            if (state.view.recording) {
+                if (ImGui::MenuItem("Stop Recording")) {
+                    send_command(EMU_CMD_STOP_RECORDING);
+                }
+            } else if (ImGui::MenuItem("Start Recording...", nullptr, false, state.view.rom_loaded)) {
+                start_recording_dialog();
             }
             ImGui::Separator();
             if (ImGui::MenuItem("Exit", "Alt+F4")) {
@@ -287,8 +940,12 @@ static void draw_main_menu() {
         }
         
         if (ImGui::BeginMenu("Emulation")) {
-            if (ImGui::MenuItem(state.emulator_running ? "Pause" : "Resume", "Space", false, state.rom_loaded)) {
-                state.emulator_running = !state.emulator_running;
+            if (ImGui::MenuItem(state.view.running ? "Pause" : "Resume", "Space", false, state.view.rom_loaded)) {
+                send_command(EMU_CMD_SET_RUNNING, !state.view.running);
+            }
+            ImGui::Separator();
+            if (ImGui::MenuItem("Sync to Audio", nullptr, &state.ui_sync_to_audio, state.audio_valid)) {
+                send_command(EMU_CMD_SET_SYNC_AUDIO, state.ui_sync_to_audio);
             }
             ImGui::EndMenu();
         }
@@ -297,6 +954,28 @@ static void draw_main_menu() {
             ImGui::MenuItem("Debug Window", "F1", &state.show_debug_window);
             ImGui::MenuItem("CPU State", "F2", &state.show_cpu_state);
             ImGui::MenuItem("Memory Viewer", "F3", &state.show_memory_viewer);
+            ImGui::MenuItem("Disassembly", "F8", &state.show_disassembly);
+            ImGui::MenuItem("ROM Profiler", "F4", &state.show_profiler);
+            if (ImGui::MenuItem("RAM Heatmap", "F7", state.show_ram_heatmap)) {
+                set_ram_heatmap(!state.show_ram_heatmap);
+            }
+            if (ImGui::MenuItem("Performance Overlay", "F6", state.show_perf_overlay)) {
+                set_perf_overlay(!state.show_perf_overlay);
+            }
+            ImGui::Separator();
+            if (ImGui::MenuItem("Fill Blank Scanlines", nullptr, &state.ui_replicate_lines)) {
+                send_command(EMU_CMD_SET_REPLICATE, state.ui_replicate_lines);
+            }
+            if (ImGui::BeginMenu("Audio Quality")) {
+                for (int q = 0; q < AUDIO_QUALITY_COUNT; q++) {
+                    audio_quality_t quality = (audio_quality_t)q;
+                    if (ImGui::MenuItem(audio_quality_name(quality), nullptr, state.ui_audio_quality == quality)) {
+                        state.ui_audio_quality = quality;
+                        send_command(EMU_CMD_SET_AUDIO_QUALITY, q);
+                    }
+                }
+                ImGui::EndMenu();
+            }
             ImGui::EndMenu();
         }
         
@@ -344,6 +1023,86 @@ static void draw_screen_window() {
     ImGui::End();
 }
 
+/* Breakpoint editor, changes go to the emulation thread as commands */
+static void draw_breakpoints() {
+    if (!ImGui::CollapsingHeader("Breakpoints", ImGuiTreeNodeFlags_DefaultOpen)) return;
+    
+    static int bp_type = MACHINE_BP_PC;
+    static int bp_reg = MACHINE_REG_AC;
+    static uint16_t bp_addr = 0;
+    static uint8_t bp_mask = 0xFF;
+    static uint8_t bp_value = 0;
+    
+    ImGui::SetNextItemWidth(100);
+    if (ImGui::BeginCombo("Type", machine_bp_type_name((machine_bp_type_t)bp_type))) {
+        for (int i = 0; i < MACHINE_BP_TYPE_COUNT; i++) {
+            if (ImGui::Selectable(machine_bp_type_name((machine_bp_type_t)i), bp_type == i)) {
+                bp_type = i;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    
+    if (bp_type == MACHINE_BP_REGISTER) {
+        ImGui::SetNextItemWidth(100);
+        if (ImGui::BeginCombo("Register", machine_reg_name((machine_reg_t)bp_reg))) {
+            for (int i = 0; i < MACHINE_REG_COUNT; i++) {
+                if (ImGui::Selectable(machine_reg_name((machine_reg_t)i), bp_reg == i)) {
+                    bp_reg = i;
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::SetNextItemWidth(40);
+        ImGui::InputScalar("Mask", ImGuiDataType_U8, &bp_mask, nullptr, nullptr, "%02X",
+                           ImGuiInputTextFlags_CharsHexadecimal);
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(40);
+        ImGui::InputScalar("Value", ImGuiDataType_U8, &bp_value, nullptr, nullptr, "%02X",
+                           ImGuiInputTextFlags_CharsHexadecimal);
+    } else {
+        ImGui::SetNextItemWidth(60);
+        ImGui::InputScalar(bp_type == MACHINE_BP_PC ? "ROM Address" : "RAM Address", ImGuiDataType_U16,
+                           &bp_addr, nullptr, nullptr, "%04X", ImGuiInputTextFlags_CharsHexadecimal);
+    }
+    
+    if (ImGui::Button("Add") && state.view.num_breakpoints < MACHINE_MAX_BREAKPOINTS) {
+        machine_breakpoint_t bp = {};
+        bp.type = (machine_bp_type_t)bp_type;
+        bp.enabled = true;
+        bp.addr = bp_addr;
+        bp.reg = (machine_reg_t)bp_reg;
+        bp.mask = bp_mask;
+        bp.value = bp_value & bp_mask;
+        send_breakpoint(bp);
+    }
+    
+    for (uint32_t i = 0; i < state.view.num_breakpoints; i++) {
+        const machine_breakpoint_t& bp = state.view.breakpoints[i];
+        ImGui::PushID((int)i);
+        
+        bool enabled = bp.enabled;
+        if (ImGui::Checkbox("##enabled", &enabled)) {
+            send_command(enabled ? EMU_CMD_ENABLE_BREAKPOINT : EMU_CMD_DISABLE_BREAKPOINT, (int32_t)i);
+        }
+        ImGui::SameLine();
+        
+        const char* marker = (state.view.break_index == (int32_t)i) ? ">" : " ";
+        if (bp.type == MACHINE_BP_REGISTER) {
+            ImGui::Text("%s %s & %02X == %02X  (%u hits)", marker, machine_reg_name(bp.reg),
+                        bp.mask, bp.value, bp.hits);
+        } else {
+            ImGui::Text("%s %s %04X  (%u hits)", marker, machine_bp_type_name(bp.type), bp.addr, bp.hits);
+        }
+        ImGui::SameLine();
+        if (ImGui::SmallButton("X")) {
+            send_command(EMU_CMD_REMOVE_BREAKPOINT, (int32_t)i);
+        }
+        
+        ImGui::PopID();
+    }
+}
+
 static void draw_debug_window() {
     if (!state.show_debug_window) return;
     
@@ -353,28 +1112,44 @@ static void draw_debug_window() {
     if (ImGui::Begin("Debug", &state.show_debug_window)) {
         ImGui::Text("Frame Time: %.2f ms", state.frame_time_ms);
         ImGui::Text("FPS: %.1f", state.frame_time_ms > 0 ? 1000.0 / state.frame_time_ms : 0);
-        ImGui::Text("VGA Frames: %u", state.vga.frame_count);
-        ImGui::Text("CPU Cycles: %llu", (unsigned long long)state.cpu.cycles);
+        ImGui::Text("Real-time Speed: %.1f%%", state.emulator_speed * 100.0);
+        ImGui::Text("VGA Frames: %u", state.view.frame_count);
+        ImGui::Text("Video Mode: %u/4 lines", state.view.pixel_lines);
+        ImGui::Text("Replicated Lines: %u", state.view.replicated_lines);
+        ImGui::Text("Duplicate Frames: %u", state.view.duplicate_frames);
+        ImGui::Text("CPU Cycles: %llu", (unsigned long long)state.view.cpu.cycles);
+        if (state.ui_sync_to_audio) {
+            ImGui::Text("Emulation Speed: %.4fx", state.view.speed);
+            ImGui::Text("Audio Fill Error: %d", state.view.fill_error);
+        }
+        ImGui::Text("Pacing Jitter: %.0f us avg, %.0f us sd, %.0f us max",
+                    state.view.pacing.mean_us, state.view.pacing.stddev_us, state.view.pacing.max_us);
+        ImGui::Text("Late Frames: %llu  Resyncs: %llu", (unsigned long long)state.view.pacing.late_frames,
+                    (unsigned long long)state.view.pacing.resyncs);
         ImGui::Separator();
         ImGui::Text("Audio Samples: %u", audio_available_samples(&state.audio));
-        ImGui::Text("Loader State: %d", state.loader.state);
+        ImGui::Text("Audio Latency: %.1f ms", audio_get_latency_ms(&state.audio));
+        ImGui::Text("Rate Ratio: %.4f", state.view.audio_rate_ratio);
+        ImGui::Text("Underruns: %u  Overruns: %u", audio_get_underruns(&state.audio), state.view.audio_overruns);
+        ImGui::Text("Loader State: %d", state.view.loader_state);
+        if (state.view.recording) {
+            ImGui::Separator();
+            ImGui::Text("Recorded Frames: %llu  Elided: %llu", (unsigned long long)state.view.rec_frames,
+                        (unsigned long long)state.view.rec_elided);
+            ImGui::Text("Dropped Frames: %llu  Samples: %llu", (unsigned long long)state.view.rec_dropped_frames,
+                        (unsigned long long)state.view.rec_dropped_samples);
+        }
         ImGui::Separator();
         
-        if (ImGui::Button("Step (1 cycle)") && state.rom_loaded) {
-            if (!loader_is_active(&state.loader)) {
-                state.cpu.in_reg = state.button_state ^ 0xFF;  /* Active low */
-            }
-            gigatron_tick(&state.cpu);
-            vga_tick(&state.vga);
-            audio_tick(&state.audio);
-            if (loader_is_active(&state.loader)) {
-                loader_tick(&state.loader);
-            }
+        if (ImGui::Button("Step (1 cycle)") && state.view.rom_loaded) {
+            send_command(EMU_CMD_STEP_CYCLE);
         }
         ImGui::SameLine();
-        if (ImGui::Button("Step (1 frame)") && state.rom_loaded) {
-            run_one_frame();  /* Use run_one_frame instead of run_emulator_frame to allow stepping when paused */
+        if (ImGui::Button("Step (1 frame)") && state.view.rom_loaded) {
+            send_command(EMU_CMD_STEP_FRAME);  /* Runs even when paused */
         }
+        
+        draw_breakpoints();
     }
     ImGui::End();
 }
@@ -388,19 +1163,19 @@ static void draw_cpu_state_window() {
     if (ImGui::Begin("CPU State", &state.show_cpu_state)) {
         ImGui::Text("Registers:");
         ImGui::Separator();
-        ImGui::Text("PC:     0x%04X", state.cpu.pc);
-        ImGui::Text("Next PC:0x%04X", state.cpu.next_pc);
-        ImGui::Text("AC:     0x%02X (%3d)", state.cpu.ac, state.cpu.ac);
-        ImGui::Text("X:      0x%02X (%3d)", state.cpu.x, state.cpu.x);
-        ImGui::Text("Y:      0x%02X (%3d)", state.cpu.y, state.cpu.y);
+        ImGui::Text("PC:     0x%04X", state.view.cpu.pc);
+        ImGui::Text("Next PC:0x%04X", state.view.cpu.next_pc);
+        ImGui::Text("AC:     0x%02X (%3d)", state.view.cpu.ac, state.view.cpu.ac);
+        ImGui::Text("X:      0x%02X (%3d)", state.view.cpu.x, state.view.cpu.x);
+        ImGui::Text("Y:      0x%02X (%3d)", state.view.cpu.y, state.view.cpu.y);
         ImGui::Separator();
-        ImGui::Text("OUT:    0x%02X", state.cpu.out);
-        ImGui::Text("  HSYNC: %d", (state.cpu.out & GIGATRON_OUT_HSYNC) ? 1 : 0);
-        ImGui::Text("  VSYNC: %d", (state.cpu.out & GIGATRON_OUT_VSYNC) ? 1 : 0);
-        ImGui::Text("  Color: 0x%02X", state.cpu.out & 0x3F);
-        ImGui::Text("OUTX:   0x%02X", state.cpu.outx);
+        ImGui::Text("OUT:    0x%02X", state.view.cpu.out);
+        ImGui::Text("  HSYNC: %d", (state.view.cpu.out & GIGATRON_OUT_HSYNC) ? 1 : 0);
+        ImGui::Text("  VSYNC: %d", (state.view.cpu.out & GIGATRON_OUT_VSYNC) ? 1 : 0);
+        ImGui::Text("  Color: 0x%02X", state.view.cpu.out & 0x3F);
+        ImGui::Text("OUTX:   0x%02X", state.view.cpu.outx);
         ImGui::Separator();
-        ImGui::Text("IN:     0x%02X", state.cpu.in_reg);
+        ImGui::Text("IN:     0x%02X", state.view.cpu.in_reg);
         ImGui::Text("Buttons: %s%s%s%s%s%s%s%s",
             (state.button_state & GIGATRON_BTN_UP) ? "U" : "-",
             (state.button_state & GIGATRON_BTN_DOWN) ? "D" : "-",
@@ -412,10 +1187,11 @@ static void draw_cpu_state_window() {
             (state.button_state & GIGATRON_BTN_SELECT) ? "s" : "-"
         );
         
-        if (state.rom_loaded) {
+        if (state.view.rom_loaded) {
             ImGui::Separator();
-            uint16_t ir = state.cpu.rom[state.cpu.pc];
+            uint16_t ir = state.view.cpu.rom[state.view.cpu.pc];
             ImGui::Text("Current IR: 0x%04X", ir);
+            ImGui::Text("  %s", disasm_cache_native(&state.disasm, state.view.cpu.rom, state.view.cpu.pc));
             ImGui::Text("  OP:   %d", (ir >> 13) & 0x07);
             ImGui::Text("  MODE: %d", (ir >> 10) & 0x07);
             ImGui::Text("  BUS:  %d", (ir >> 8) & 0x03);
@@ -425,85 +1201,644 @@ static void draw_cpu_state_window() {
     ImGui::End();
 }
 
+/* Mark RAM bytes that changed since the last UI frame, ages count down to 0 */
+static void update_memory_changes(const uint8_t* ram, uint32_t size, bool reset) {
+    if (reset) {
+        memcpy(state.mem_prev, ram, size);
+        memset(state.mem_age, 0, size);
+        return;
+    }
+    for (uint32_t i = 0; i < size; i++) {
+        uint8_t value = ram[i];
+        uint8_t age = state.mem_age[i];
+        state.mem_age[i] = value != state.mem_prev[i] ? MEMVIEW_FADE_FRAMES : (age ? age - 1 : 0);
+        state.mem_prev[i] = value;
+    }
+}
+
+/* Format one row as "ADDR: hex bytes  |ascii|", returns the column of the first hex digit */
+static int format_memory_row(char* line, uint32_t addr, const uint8_t* bytes, int count, bool rom) {
+    int prefix = snprintf(line, MEMVIEW_LINE_SIZE, rom ? "%05X: " : "%04X: ", addr);
+    char* p = line + prefix;
+    static const char hex[] = "0123456789ABCDEF";
+    for (int i = 0; i < MEMVIEW_BYTES_PER_ROW; i++) {
+        if (i < count) {
+            *p++ = hex[bytes[i] >> 4];
+            *p++ = hex[bytes[i] & 0xF];
+        } else {
+            *p++ = ' ';
+            *p++ = ' ';
+        }
+        *p++ = ' ';
+    }
+    *p++ = ' ';
+    *p++ = '|';
+    for (int i = 0; i < count; i++) {
+        *p++ = (bytes[i] >= 32 && bytes[i] < 127) ? (char)bytes[i] : '.';
+    }
+    *p++ = '|';
+    *p = '\0';
+    return prefix;
+}
+
 static void draw_memory_viewer() {
-    if (!state.show_memory_viewer) return;
+    if (!state.show_memory_viewer) {
+        state.mem_primed = false;
+        return;
+    }
     
-    ImGui::SetNextWindowSize(ImVec2(500, 400), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(560, 400), ImGuiCond_FirstUseEver);
     ImGui::SetNextWindowPos(ImVec2(200, 200), ImGuiCond_FirstUseEver);
     
+    /* RAM as of the last frame handoff */
+    const gigatron_t& cpu = state.view.cpu;
+    if (cpu.ram && cpu.ram_size <= sizeof(state.mem_prev)) {
+        update_memory_changes(cpu.ram, cpu.ram_size, !state.mem_primed);
+        state.mem_primed = true;
+    }
+    
     if (ImGui::Begin("Memory Viewer", &state.show_memory_viewer)) {
-        static int view_addr = 0;
         static bool show_rom = false;
+        static uint32_t goto_addr = 0;
+        bool scroll_to = false;
         
-        ImGui::Checkbox("Show ROM", &show_rom);
+        if (ImGui::Checkbox("Show ROM", &show_rom)) {
+            scroll_to = true;
+        }
         ImGui::SameLine();
-        ImGui::SetNextItemWidth(100);
-        ImGui::InputInt("Address", &view_addr, 16, 256);
+        ImGui::SetNextItemWidth(80);
+        if (ImGui::InputScalar("Go to", ImGuiDataType_U32, &goto_addr, nullptr, nullptr, "%04X",
+                               ImGuiInputTextFlags_CharsHexadecimal | ImGuiInputTextFlags_EnterReturnsTrue)) {
+            scroll_to = true;
+        }
         
-        if (view_addr < 0) view_addr = 0;
+        const bool rom = show_rom && cpu.rom;
+        const uint32_t size = rom ? cpu.rom_size * 2 : (cpu.ram ? cpu.ram_size : 0);
+        const int rows = (int)((size + MEMVIEW_BYTES_PER_ROW - 1) / MEMVIEW_BYTES_PER_ROW);
         
-        const int bytes_per_row = 16;
-        const int rows = 16;
+        ImGui::BeginChild("MemoryView", ImVec2(0, 0), true, ImGuiWindowFlags_HorizontalScrollbar);
         
-        ImGui::BeginChild("MemoryView", ImVec2(0, 0), true);
+        /* Rows are laid out one line pitch (text plus item spacing) apart */
+        const float line_height = ImGui::GetTextLineHeightWithSpacing();
+        if (scroll_to && size) {
+            uint32_t addr = goto_addr < size ? goto_addr : size - 1;
+            ImGui::SetScrollY((float)(addr / MEMVIEW_BYTES_PER_ROW) * line_height);
+        }
         
-        if (show_rom && state.cpu.rom) {
-            int max_addr = (int)state.cpu.rom_size * 2;
-            if (view_addr >= max_addr) view_addr = max_addr - 1;
-            
-            ImGui::Text("ROM (16-bit words as bytes):");
-            for (int row = 0; row < rows; row++) {
-                int addr = view_addr + row * bytes_per_row;
-                if (addr >= max_addr) break;
-                
-                ImGui::Text("%04X: ", addr);
-                ImGui::SameLine();
-                
-                for (int col = 0; col < bytes_per_row && addr + col < max_addr; col++) {
-                    int word_idx = (addr + col) / 2;
-                    uint16_t word = state.cpu.rom[word_idx];
-                    uint8_t byte = ((addr + col) & 1) ? (word & 0xFF) : (word >> 8);
-                    ImGui::Text("%02X ", byte);
-                    ImGui::SameLine();
-                }
-                ImGui::NewLine();
-            }
-        } else if (state.cpu.ram) {
-            int max_addr = (int)state.cpu.ram_size;
-            if (view_addr >= max_addr) view_addr = max_addr - 1;
-            
-            ImGui::Text("RAM (8-bit bytes):");
-            for (int row = 0; row < rows; row++) {
-                int addr = view_addr + row * bytes_per_row;
-                if (addr >= max_addr) break;
-                
-                ImGui::Text("%04X: ", addr);
-                ImGui::SameLine();
-                
-                /* Hex view */
-                for (int col = 0; col < bytes_per_row && addr + col < max_addr; col++) {
-                    ImGui::Text("%02X ", state.cpu.ram[addr + col]);
-                    ImGui::SameLine();
+        /* Only visible rows are formatted, one string each */
+        const float char_width = ImGui::CalcTextSize("0").x;
+        ImDrawList* draw_list = ImGui::GetWindowDrawList();
+        ImGuiListClipper clipper;
+        clipper.Begin(rows, line_height);
+        while (clipper.Step()) {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+                uint32_t addr = (uint32_t)row * MEMVIEW_BYTES_PER_ROW;
+                int count = (int)(size - addr < MEMVIEW_BYTES_PER_ROW ? size - addr : MEMVIEW_BYTES_PER_ROW);
+                uint8_t bytes[MEMVIEW_BYTES_PER_ROW];
+                for (int i = 0; i < count; i++) {
+                    if (rom) {
+                        /* ROM words as bytes, high byte (instruction) first */
+                        uint16_t word = cpu.rom[(addr + i) / 2];
+                        bytes[i] = ((addr + i) & 1) ? (uint8_t)(word & 0xFF) : (uint8_t)(word >> 8);
+                    } else {
+                        bytes[i] = cpu.ram[addr + i];
+                    }
                 }
                 
-                ImGui::Text(" | ");
-                ImGui::SameLine();
+                char line[MEMVIEW_LINE_SIZE];
+                int hex_col = format_memory_row(line, addr, bytes, count, rom);
                 
-                /* ASCII view */
-                for (int col = 0; col < bytes_per_row && addr + col < max_addr; col++) {
-                    uint8_t c = state.cpu.ram[addr + col];
-                    ImGui::Text("%c", (c >= 32 && c < 127) ? c : '.');
-                    ImGui::SameLine();
+                /* Changed bytes: background behind the hex digits and the character */
+                if (!rom && state.mem_primed) {
+                    ImVec2 pos = ImGui::GetCursorScreenPos();
+                    int ascii_col = hex_col + MEMVIEW_BYTES_PER_ROW * 3 + 2;
+                    for (int i = 0; i < count; i++) {
+                        uint8_t age = state.mem_age[addr + i];
+                        if (!age) continue;
+                        ImU32 color = IM_COL32(255, 200, 0, 40 + 160 * age / MEMVIEW_FADE_FRAMES);
+                        float x = pos.x + (float)(hex_col + i * 3) * char_width;
+                        draw_list->AddRectFilled(ImVec2(x, pos.y), ImVec2(x + 2 * char_width, pos.y + line_height), color);
+                        x = pos.x + (float)(ascii_col + i) * char_width;
+                        draw_list->AddRectFilled(ImVec2(x, pos.y), ImVec2(x + char_width, pos.y + line_height), color);
+                    }
                 }
-                ImGui::NewLine();
+                ImGui::TextUnformatted(line);
             }
         }
+        clipper.End();
         
         ImGui::EndChild();
     }
     ImGui::End();
 }
 
+/* Scroll so that row stays DISASM_FOLLOW_MARGIN rows inside the view, centering it when it left */
+static void follow_row(int row, float line_height) {
+    float top = ImGui::GetScrollY() / line_height;
+    float rows = (ImGui::GetWindowHeight() - ImGui::GetStyle().WindowPadding.y * 2.0f) / line_height;
+    if (row < top + DISASM_FOLLOW_MARGIN || row + 1 > top + rows - DISASM_FOLLOW_MARGIN) {
+        ImGui::SetScrollY(((float)row + 0.5f - rows * 0.5f) * line_height);
+    }
+}
+
+/* RAM page shown by the vCPU listing: the one holding the next instruction, or the go-to address */
+static uint16_t vcpu_listing_page(bool follow, uint32_t goto_addr) {
+    const gigatron_t& cpu = state.view.cpu;
+    uint16_t vpc = (uint16_t)(cpu.ram[VCPU_VPC] | (cpu.ram[VCPU_VPC + 1] << 8));
+    uint16_t next = follow ? disasm_vcpu_next(vpc, 2) : (uint16_t)goto_addr;
+    return (uint16_t)(next & cpu.ram_mask & 0xFF00);
+}
+
+/* Native listing of the whole ROM, lines come from the cache */
+static void draw_native_listing(bool follow, bool scroll_to, uint32_t goto_addr) {
+    const gigatron_t& cpu = state.view.cpu;
+    const float line_height = ImGui::GetTextLineHeightWithSpacing();
+    if (follow) {
+        follow_row(cpu.pc, line_height);
+    } else if (scroll_to) {
+        ImGui::SetScrollY((float)(goto_addr & cpu.rom_mask) * line_height);
+    }
+    
+    ImGuiListClipper clipper;
+    clipper.Begin((int)cpu.rom_size, line_height);
+    while (clipper.Step()) {
+        for (int addr = clipper.DisplayStart; addr < clipper.DisplayEnd; addr++) {
+            char line[64];
+            snprintf(line, sizeof(line), "%s%04X  %04X  %s", addr == cpu.pc ? "> " : "  ", addr,
+                     cpu.rom[addr], disasm_cache_native(&state.disasm, cpu.rom, (uint16_t)addr));
+            if (addr == cpu.pc) {
+                ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1, 1, 0, 1));
+                ImGui::TextUnformatted(line);
+                ImGui::PopStyleColor();
+            } else {
+                ImGui::TextUnformatted(line);
+            }
+        }
+    }
+    clipper.End();
+}
+
+/* vCPU listing of one RAM page, decoded from its start and realigned on the next instruction */
+static void draw_vcpu_listing(bool follow, uint32_t goto_addr) {
+    const gigatron_t& cpu = state.view.cpu;
+    uint16_t vpc = (uint16_t)(cpu.ram[VCPU_VPC] | (cpu.ram[VCPU_VPC + 1] << 8));
+    uint16_t next = disasm_vcpu_next(vpc, 2);
+    uint16_t page = vcpu_listing_page(follow, goto_addr);
+    
+    struct row_t {
+        uint16_t addr;
+        const disasm_line_t* line;
+    } rows[DISASM_PAGE_SIZE];
+    int num_rows = 0;
+    int next_row = -1;
+    for (uint32_t offset = 0; offset < DISASM_PAGE_SIZE; ) {
+        uint16_t addr = (uint16_t)(page + offset);
+        const disasm_line_t* line = disasm_cache_vcpu(&state.disasm, addr);
+        if (!line) break;
+        
+        /* An instruction overlapping the next one is cut short */
+        uint32_t length = line->length;
+        if (addr < next && addr + length > next) length = next - addr;
+        if (addr == next) next_row = num_rows;
+        rows[num_rows].addr = addr;
+        rows[num_rows].line = length == line->length ? line : nullptr;
+        num_rows++;
+        offset += length;
+    }
+    
+    const float line_height = ImGui::GetTextLineHeightWithSpacing();
+    if (follow && next_row >= 0) {
+        follow_row(next_row, line_height);
+    }
+    
+    ImGuiListClipper clipper;
+    clipper.Begin(num_rows, line_height);
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            char line[64];
+            const char* marker = i == next_row ? "> " : "  ";
+            if (rows[i].line) {
+                snprintf(line, sizeof(line), "%s%04X  %s", marker, rows[i].addr, rows[i].line->text);
+            } else {
+                snprintf(line, sizeof(line), "%s%04X  db $%02x", marker, rows[i].addr, cpu.ram[rows[i].addr]);
+            }
+            if (i == next_row) {
+                ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1, 1, 0, 1));
+                ImGui::TextUnformatted(line);
+                ImGui::PopStyleColor();
+            } else {
+                ImGui::TextUnformatted(line);
+            }
+        }
+    }
+    clipper.End();
+}
+
+static void draw_disassembly_window() {
+    if (!state.show_disassembly) return;
+    
+    ImGui::SetNextWindowSize(ImVec2(320, 420), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowPos(ImVec2(960, 120), ImGuiCond_FirstUseEver);
+    
+    if (ImGui::Begin("Disassembly", &state.show_disassembly)) {
+        static bool vcpu = false;
+        static bool follow = true;
+        static uint32_t goto_addr = 0;
+        bool scroll_to = false;
+        
+        if (ImGui::RadioButton("Native", !vcpu)) vcpu = false;
+        ImGui::SameLine();
+        if (ImGui::RadioButton("vCPU", vcpu)) vcpu = true;
+        ImGui::SameLine();
+        ImGui::Checkbox("Follow PC", &follow);
+        ImGui::SetNextItemWidth(80);
+        if (ImGui::InputScalar("Go to", ImGuiDataType_U32, &goto_addr, nullptr, nullptr, "%04X",
+                               ImGuiInputTextFlags_CharsHexadecimal | ImGuiInputTextFlags_EnterReturnsTrue)) {
+            follow = false;
+            scroll_to = true;
+        }
+        
+        /* The vCPU listing covers one page and moves to the next instruction's page when following */
+        const gigatron_t& cpu = state.view.cpu;
+        if (vcpu && cpu.ram && state.view.rom_loaded) {
+            uint16_t page = vcpu_listing_page(follow, goto_addr);
+            ImGui::SameLine();
+            ImGui::TextDisabled("Page %04X-%04X", page, page + DISASM_PAGE_SIZE - 1);
+        }
+        
+        /* Cached vCPU lines are dropped only for pages that changed */
+        if (vcpu && cpu.ram && cpu.ram_size == state.disasm.ram_size) {
+            disasm_cache_sync_ram(&state.disasm, cpu.ram);
+        }
+        
+        ImGui::BeginChild("Listing", ImVec2(0, 0), true);
+        if (!state.view.rom_loaded || !state.disasm.native) {
+            ImGui::TextDisabled("No ROM loaded");
+        } else if (vcpu) {
+            draw_vcpu_listing(follow, goto_addr);
+        } else {
+            draw_native_listing(follow, scroll_to, goto_addr);
+        }
+        ImGui::EndChild();
+    }
+    ImGui::End();
+}
+
+/* Heat color for a count relative to the hottest address (log scale) */
+static uint32_t heatmap_color(uint64_t count, double log_max) {
+    if (count == 0) return 0xFF000000;  /* Never executed: black */
+    
+    float t = log_max > 0.0 ? (float)(log1p((double)count) / log_max) : 1.0f;
+    
+    /* Blue -> red -> yellow */
+    uint8_t r = (uint8_t)(t < 0.5f ? t * 2.0f * 255.0f : 255.0f);
+    uint8_t g = (uint8_t)(t < 0.5f ? 0.0f : (t - 0.5f) * 2.0f * 255.0f);
+    uint8_t b = (uint8_t)(t < 0.5f ? (1.0f - t * 2.0f) * 200.0f + 55.0f : 0.0f);
+    uint8_t bytes[4] = { r, g, b, 255 };
+    uint32_t pixel;
+    memcpy(&pixel, bytes, 4);
+    return pixel;
+}
+
+/* Rebuild the heatmap texture and hot spot list from the live counters */
+static void update_profiler_view(profiler_hotspot_t* spots, uint32_t* num_spots, uint64_t* total) {
+    static uint32_t pixels[HEATMAP_SIZE * HEATMAP_SIZE];
+    const profiler_t* profiler = &state.profiler;
+    uint32_t size = profiler->size < HEATMAP_SIZE * HEATMAP_SIZE ? profiler->size : HEATMAP_SIZE * HEATMAP_SIZE;
+    
+    *num_spots = profiler_hotspots(profiler, spots, PROFILER_UI_TOP);
+    *total = profiler_total(profiler);
+    
+    double log_max = *num_spots ? log1p((double)spots[0].count) : 0.0;
+    for (uint32_t addr = 0; addr < HEATMAP_SIZE * HEATMAP_SIZE; addr++) {
+        pixels[addr] = addr < size ? heatmap_color(profiler->counts[addr], log_max) : 0xFF000000;
+    }
+    
+    sg_image_data img_data = {};
+    img_data.mip_levels[0].ptr = pixels;
+    img_data.mip_levels[0].size = sizeof(pixels);
+    sg_update_image(state.heatmap_texture, &img_data);
+}
+
+static void export_profile_dialog() {
+    nfdchar_t* path = NULL;
+    nfdfilteritem_t filters[1] = { { "Text Files", "txt" } };
+    nfdresult_t result = NFD_SaveDialog(&path, filters, 1, NULL, "rom_profile.txt");
+    
+    if (result == NFD_OKAY) {
+        send_command(EMU_CMD_EXPORT_PROFILE, 0, path);
+        NFD_FreePath(path);
+    }
+}
+
+static void export_vcpu_profile_dialog(bool folded) {
+    nfdchar_t* path = NULL;
+    nfdfilteritem_t filters[1] = { { folded ? "Folded Stacks" : "Text Files", folded ? "folded" : "txt" } };
+    nfdresult_t result = NFD_SaveDialog(&path, filters, 1, NULL, folded ? "vcpu.folded" : "vcpu_profile.txt");
+    
+    if (result == NFD_OKAY) {
+        send_command(EMU_CMD_EXPORT_VCPU_PROFILE, folded, path);
+        NFD_FreePath(path);
+    }
+}
+
+/* vCPU section of the profiler window: opcode and SYS tables from the live counters */
+static void draw_vcpu_profile() {
+    const vcpu_profiler_t* profiler = &state.vcpu_profiler;
+    
+    if (!state.view.vcpu_found) {
+        ImGui::TextDisabled("vCPU interpreter not found in ROM");
+        return;
+    }
+    
+    bool profiling = state.view.vcpu_profiling;
+    if (ImGui::Checkbox("Profile vCPU", &profiling)) {
+        send_command(EMU_CMD_SET_VCPU_PROFILING, profiling);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export Report...")) {
+        export_vcpu_profile_dialog(false);
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export Flame Graph...")) {
+        export_vcpu_profile_dialog(true);
+    }
+    
+    uint64_t total = profiler->total_cycles;
+    ImGui::Text("Instructions: %llu  Cycles: %llu",
+                (unsigned long long)profiler->instructions, (unsigned long long)total);
+    
+    /* Opcodes by time, insertion into a short sorted list */
+    uint8_t top[VCPU_UI_TOP];
+    uint32_t n = 0;
+    for (uint32_t op = 0; op < 256; op++) {
+        uint64_t cycles = profiler->op_cycles[op];
+        if (cycles == 0) continue;
+        if (n == VCPU_UI_TOP && cycles <= profiler->op_cycles[top[n - 1]]) continue;
+        
+        uint32_t i = (n < VCPU_UI_TOP) ? n++ : n - 1;
+        while (i > 0 && profiler->op_cycles[top[i - 1]] < cycles) {
+            top[i] = top[i - 1];
+            i--;
+        }
+        top[i] = (uint8_t)op;
+    }
+    
+    if (ImGui::BeginTable("Opcodes", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+        ImGui::TableSetupColumn("Opcode");
+        ImGui::TableSetupColumn("Count");
+        ImGui::TableSetupColumn("Cycles %");
+        ImGui::TableSetupColumn("Avg");
+        ImGui::TableHeadersRow();
+        for (uint32_t i = 0; i < n; i++) {
+            uint64_t count = profiler->op_counts[top[i]];
+            uint64_t cycles = profiler->op_cycles[top[i]];
+            const char* name = vcpu_opcode_name(top[i]);
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%02X %s", top[i], name ? name : "?");
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)count);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", total ? 100.0 * (double)cycles / (double)total : 0.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", count ? (double)cycles / (double)count : 0.0);
+        }
+        ImGui::EndTable();
+    }
+    
+    if (ImGui::BeginTable("SysCalls", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+        ImGui::TableSetupColumn("SYS");
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("Cycles %");
+        ImGui::TableSetupColumn("Avg");
+        ImGui::TableHeadersRow();
+        uint32_t num_sys = profiler->num_sys < VCPU_MAX_SYS ? profiler->num_sys : VCPU_MAX_SYS;
+        for (uint32_t i = 0; i < num_sys; i++) {
+            const vcpu_sys_stats_t* sys = &profiler->sys[i];
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%04X", sys->addr);
+            ImGui::TableNextColumn();
+            ImGui::Text("%llu", (unsigned long long)sys->count);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", total ? 100.0 * (double)sys->cycles / (double)total : 0.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", sys->count ? (double)sys->cycles / (double)sys->count : 0.0);
+        }
+        ImGui::EndTable();
+    }
+}
+
+static void draw_profiler_window() {
+    if (!state.show_profiler) return;
+    
+    ImGui::SetNextWindowSize(ImVec2(560, 700), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowPos(ImVec2(260, 60), ImGuiCond_FirstUseEver);
+    
+    if (ImGui::Begin("ROM Profiler", &state.show_profiler)) {
+        static profiler_hotspot_t spots[PROFILER_UI_TOP];
+        static uint32_t num_spots = 0;
+        static uint64_t total = 0;
+        static double last_update = -HEATMAP_REFRESH;
+        
+        /* Counters are read live, refresh at a calm rate */
+        double now = stm_sec(stm_now());
+        if (now - last_update >= HEATMAP_REFRESH) {
+            update_profiler_view(spots, &num_spots, &total);
+            last_update = now;
+        }
+        
+        bool profiling = state.view.profiling;
+        if (ImGui::Checkbox("Profile", &profiling)) {
+            send_command(EMU_CMD_SET_PROFILING, profiling);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Reset")) {
+            send_command(EMU_CMD_RESET_PROFILE);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Export...")) {
+            export_profile_dialog();
+        }
+        ImGui::Text("Instructions: %llu", (unsigned long long)total);
+        
+        /* Heatmap: row = ROM page, column = offset in page */
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        const float scale = 2.0f;
+        ImGui::Image((ImTextureID)simgui_imtextureid_with_sampler(state.heatmap_view, state.screen_sampler),
+                     ImVec2(HEATMAP_SIZE * scale, HEATMAP_SIZE * scale));
+        if (ImGui::IsItemHovered() && state.profiler.counts) {
+            ImVec2 mouse = ImGui::GetMousePos();
+            uint32_t col = (uint32_t)((mouse.x - origin.x) / scale);
+            uint32_t row = (uint32_t)((mouse.y - origin.y) / scale);
+            uint32_t addr = (row * HEATMAP_SIZE + col) & (HEATMAP_SIZE * HEATMAP_SIZE - 1);
+            if (addr < state.profiler.size) {
+                ImGui::SetTooltip("%04X: %llu", addr, (unsigned long long)state.profiler.counts[addr]);
+            }
+        }
+        
+        /* Hot spots */
+        if (ImGui::BeginTable("Hotspots", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV)) {
+            ImGui::TableSetupColumn("Address");
+            ImGui::TableSetupColumn("Count");
+            ImGui::TableSetupColumn("%");
+            ImGui::TableHeadersRow();
+            for (uint32_t i = 0; i < num_spots; i++) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%04X", spots[i].addr);
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", (unsigned long long)spots[i].count);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", total ? 100.0 * (double)spots[i].count / (double)total : 0.0);
+            }
+            ImGui::EndTable();
+        }
+        
+        if (ImGui::CollapsingHeader("vCPU", ImGuiTreeNodeFlags_DefaultOpen)) {
+            draw_vcpu_profile();
+        }
+    }
+    ImGui::End();
+}
+
+/* Decay the RAM heat by the accesses since the last UI frame and upload it */
+static void update_ram_heatmap() {
+    static uint32_t pixels[1 << 16];
+    const access_map_t* map = &state.access_map;
+    uint32_t size = map->size < state.view.cpu.ram_size ? map->size : state.view.cpu.ram_size;
+    if (!map->reads || size > (1u << 16)) return;
+    
+    /* Counters only grow, a fresh start takes the current ones as the base */
+    float max_heat = 1.0f;
+    for (uint32_t addr = 0; addr < size; addr++) {
+        uint32_t reads = map->reads[addr];
+        uint32_t writes = map->writes[addr];
+        if (state.heat_primed) {
+            state.heat_reads[addr] = state.heat_reads[addr] * RAM_HEATMAP_DECAY +
+                                     (float)(reads - state.heat_prev_reads[addr]);
+            state.heat_writes[addr] = state.heat_writes[addr] * RAM_HEATMAP_DECAY +
+                                      (float)(writes - state.heat_prev_writes[addr]);
+        } else {
+            state.heat_reads[addr] = 0.0f;
+            state.heat_writes[addr] = 0.0f;
+        }
+        state.heat_prev_reads[addr] = reads;
+        state.heat_prev_writes[addr] = writes;
+        max_heat = state.heat_reads[addr] > max_heat ? state.heat_reads[addr] : max_heat;
+        max_heat = state.heat_writes[addr] > max_heat ? state.heat_writes[addr] : max_heat;
+    }
+    state.heat_primed = true;
+    
+    /* Reads green, writes red (log scale), both yellow */
+    float log_max = logf(1.0f + max_heat);
+    for (uint32_t addr = 0; addr < size; addr++) {
+        uint32_t r = (uint32_t)(255.0f * logf(1.0f + state.heat_writes[addr]) / log_max);
+        uint32_t g = (uint32_t)(255.0f * logf(1.0f + state.heat_reads[addr]) / log_max);
+        pixels[addr] = 0xFF000000 | (g << 8) | r;
+    }
+    
+    sg_image_data img_data = {};
+    img_data.mip_levels[0].ptr = pixels;
+    img_data.mip_levels[0].size = size * sizeof(uint32_t);
+    sg_update_image(state.ram_heatmap_texture, &img_data);
+}
+
+static void draw_ram_heatmap_window() {
+    if (!state.show_ram_heatmap) return;
+    
+    ImGui::SetNextWindowSize(ImVec2(560, 340), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowPos(ImVec2(260, 120), ImGuiCond_FirstUseEver);
+    
+    bool open = true;
+    if (ImGui::Begin("RAM Heatmap", &open)) {
+        update_ram_heatmap();
+        
+        ImGui::TextColored(ImVec4(0.3f, 1, 0.3f, 1), "Reads");
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1, 0.3f, 0.3f, 1), "Writes");
+        ImGui::SameLine();
+        ImGui::TextDisabled("(decayed per frame, one row per page)");
+        
+        /* Integer scale that fits the window */
+        uint32_t rows = state.view.cpu.ram_size / RAM_HEATMAP_WIDTH;
+        ImVec2 avail = ImGui::GetContentRegionAvail();
+        float scale = floorf(avail.x / RAM_HEATMAP_WIDTH);
+        if (avail.y / rows < scale) scale = floorf(avail.y / rows);
+        if (scale < 1.0f) scale = 1.0f;
+        ImGui::Image((ImTextureID)simgui_imtextureid_with_sampler(state.ram_heatmap_view, state.screen_sampler),
+                     ImVec2(RAM_HEATMAP_WIDTH * scale, rows * scale));
+        if (ImGui::IsItemHovered() && state.access_map.reads) {
+            ImVec2 mouse = ImGui::GetMousePos();
+            ImVec2 min = ImGui::GetItemRectMin();
+            uint32_t col = (uint32_t)((mouse.x - min.x) / scale);
+            uint32_t row = (uint32_t)((mouse.y - min.y) / scale);
+            uint32_t addr = row * RAM_HEATMAP_WIDTH + col;
+            if (col < RAM_HEATMAP_WIDTH && addr < state.access_map.size) {
+                ImGui::SetTooltip("%04X: %u reads, %u writes", addr,
+                                  state.access_map.reads[addr], state.access_map.writes[addr]);
+            }
+        }
+    }
+    ImGui::End();
+    
+    if (!open) {
+        set_ram_heatmap(false);
+    }
+}
+
+static void draw_perf_overlay() {
+    if (!state.show_perf_overlay) return;
+    
+    /* Top right corner, below the menu bar */
+    ImGuiViewport* viewport = ImGui::GetMainViewport();
+    ImGui::SetNextWindowPos(ImVec2(viewport->WorkPos.x + viewport->WorkSize.x - 10, viewport->WorkPos.y + 10),
+                            ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    
+    ImGuiWindowFlags flags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                             ImGuiWindowFlags_NoSavedSettings | ImGuiWindowFlags_NoFocusOnAppearing |
+                             ImGuiWindowFlags_NoNav | ImGuiWindowFlags_NoMove;
+    
+    if (ImGui::Begin("##Performance", nullptr, flags)) {
+        const perf_stats_t& stats = state.view.perf;
+        if (!state.view.perf_on || stats.frames == 0) {
+            ImGui::TextUnformatted(state.view.running ? "Measuring..." : "Paused");
+        } else {
+            ImGui::Text("Emulated: %.3f MHz (%.1f%% real time)", stats.emulated_mhz, stats.realtime * 100.0);
+            ImGui::Text("Capacity: %.1f MHz (%.1fx)", stats.capacity_mhz,
+                        state.view.cpu.hz ? stats.capacity_mhz * 1e6 / state.view.cpu.hz : 0.0);
+            ImGui::Separator();
+            if (ImGui::BeginTable("##perf", 3, ImGuiTableFlags_SizingFixedFit)) {
+                ImGui::TableSetupColumn("us/frame");
+                ImGui::TableSetupColumn("p50");
+                ImGui::TableSetupColumn("p99");
+                ImGui::TableHeadersRow();
+                for (int d = 0; d < PERF_DEVICE_COUNT; d++) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(perf_device_name((perf_device_t)d));
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%8.1f", stats.p50_us[d]);
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%8.1f", stats.p99_us[d]);
+                }
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted("Total");
+                ImGui::TableNextColumn();
+                ImGui::Text("%8.1f", stats.busy_p50_us);
+                ImGui::TableNextColumn();
+                ImGui::Text("%8.1f", stats.busy_p99_us);
+                ImGui::EndTable();
+            }
+            ImGui::TextDisabled("Last %u frames", stats.frames);
+        }
+    }
+    ImGui::End();
+}
+
 static void draw_status_bar() {
     ImGuiViewport* viewport = ImGui::GetMainViewport();
     ImGui::SetNextWindowPos(ImVec2(viewport->Pos.x, viewport->Pos.y + viewport->Size.y - 25));
@@ -519,9 +1854,9 @@ static void draw_status_bar() {
     if (ImGui::Begin("##StatusBar", nullptr, flags)) {
         if (state.status_timeout > 0) {
             ImGui::Text("%s", state.status_message);
-        } else if (state.rom_loaded) {
-            ImGui::Text("ROM: %s | %s", state.rom_path, 
-                       state.emulator_running ? "Running" : "Paused");
+        } else if (state.view.rom_loaded) {
+            ImGui::Text("ROM: %s | %s", state.view.rom_path, 
+                       state.view.running ? "Running" : "Paused");
         } else {
             ImGui::Text("No ROM loaded - Press Ctrl+O to open a ROM file");
         }
@@ -567,6 +1902,37 @@ static void init(void) {
     vga_init(&state.vga, &state.cpu);
     audio_init(&state.audio, &state.cpu);
     loader_init(&state.loader, &state.cpu);
+    machine_init(&state.machine, &state.cpu, &state.vga, &state.loader);
+    profiler_init(&state.profiler, state.cpu.rom_size);
+    vcpu_profiler_init(&state.vcpu_profiler, &state.cpu);
+    perf_init(&state.perf, state.cpu.hz);
+    access_map_init(&state.access_map, state.cpu.ram_size);
+    disasm_cache_init(&state.disasm, state.cpu.rom_size, state.cpu.ram_size);
+    state.break_index = -1;
+    
+    /* Keep about one device period plus one display frame buffered */
+    uint32_t sample_rate = AUDIO_SAMPLE_RATE;
+    uint32_t device_frames = AUDIO_BUFFER_SIZE;
+    state.audio_valid = saudio_isvalid();
+    if (state.audio_valid) {
+        sample_rate = (uint32_t)saudio_sample_rate();
+        device_frames = (uint32_t)saudio_buffer_frames();
+        audio_set_sample_rate(&state.audio, sample_rate);
+    }
+    scheduler_init(&state.scheduler, state.cpu.hz, sample_rate, device_frames + sample_rate / 60);
+    audio_set_rate_control(&state.audio, true, state.scheduler.target_samples);
+    
+    /* Render into the triple buffer: back 0, middle 1, front 2 (opaque black) */
+    for (uint32_t i = 0; i < 3; i++) {
+        for (uint32_t p = 0; p < FRAME_SIZE; p += 4) {
+            state.frame_buffers[i][p + 3] = 255;
+        }
+    }
+    state.frame_back = 0;
+    state.frame_middle.store(1, std::memory_order_relaxed);
+    state.frame_front = 2;
+    vga_set_framebuffer(&state.vga, state.frame_buffers[state.frame_back], VGA_WIDTH * 4,
+                        VGA_FORMAT_RGBA8888, VGA_MAX_SCALE);
     
     /* Create screen texture */
     sg_image_desc img_desc = {};
@@ -589,6 +1955,30 @@ static void init(void) {
     view_desc.texture.image = state.screen_texture;
     state.screen_view = sg_make_view(&view_desc);
     
+    /* Create ROM heatmap texture */
+    sg_image_desc heatmap_desc = {};
+    heatmap_desc.width = HEATMAP_SIZE;
+    heatmap_desc.height = HEATMAP_SIZE;
+    heatmap_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    heatmap_desc.usage.stream_update = true;
+    state.heatmap_texture = sg_make_image(&heatmap_desc);
+    
+    sg_view_desc heatmap_view_desc = {};
+    heatmap_view_desc.texture.image = state.heatmap_texture;
+    state.heatmap_view = sg_make_view(&heatmap_view_desc);
+    
+    /* Create RAM heatmap texture */
+    sg_image_desc ram_heatmap_desc = {};
+    ram_heatmap_desc.width = RAM_HEATMAP_WIDTH;
+    ram_heatmap_desc.height = (int)(state.cpu.ram_size / RAM_HEATMAP_WIDTH);
+    ram_heatmap_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    ram_heatmap_desc.usage.stream_update = true;
+    state.ram_heatmap_texture = sg_make_image(&ram_heatmap_desc);
+    
+    sg_view_desc ram_heatmap_view_desc = {};
+    ram_heatmap_view_desc.texture.image = state.ram_heatmap_texture;
+    state.ram_heatmap_view = sg_make_view(&ram_heatmap_view_desc);
+    
     /* Clear color */
     state.pass_action.colors[0] = { 
         .load_action = SG_LOADACTION_CLEAR, 
@@ -602,12 +1992,23 @@ static void init(void) {
     state.show_debug_window = false;
     state.show_cpu_state = false;
     state.show_memory_viewer = false;
+    state.show_profiler = false;
+    state.show_perf_overlay = false;
+    state.show_ram_heatmap = false;
+    state.show_disassembly = false;
+    state.ui_audio_quality = state.audio.quality;
+    state.screen_dirty = true;
     state.last_time = stm_now();
     
     /* Try to load default ROM */
     if (load_rom("roms/gigatron.rom")) {
+        state.emu_status.store(nullptr);
         set_status("Default ROM loaded");
     }
+    
+    /* From here on the emulation thread owns the core */
+    publish_snapshot();
+    state.emu_thread = std::thread(emu_thread_main);
 }
 
 static void frame(void) {
@@ -621,11 +2022,41 @@ static void frame(void) {
         state.status_timeout -= (float)(state.frame_time_ms / 1000.0);
     }
     
-    /* Run emulator */
-    run_emulator_frame();
+    /* Pick up emulator state and messages from the emulation thread */
+    read_snapshot();
+    if (state.input_pending) {
+        queue_input();
+    }
+    
+    /* Emulated clock rate relative to the nominal one, smoothed */
+    if (state.view.running && state.frame_time_ms > 0 && state.view.cpu.cycles >= state.speed_cycles) {
+        double speed = (double)(state.view.cpu.cycles - state.speed_cycles) /
+                       ((double)state.view.cpu.hz * state.frame_time_ms * 1e-3);
+        state.emulator_speed += (speed - state.emulator_speed) * SPEED_SMOOTHING;
+    } else if (!state.view.running) {
+        state.emulator_speed = 0.0;
+    }
+    state.speed_cycles = state.view.cpu.cycles;
+    
+    /* Native disassembly is cached until another ROM is loaded */
+    if (state.disasm_rom != state.view.rom_generation) {
+        disasm_cache_invalidate_rom(&state.disasm);
+        state.disasm_rom = state.view.rom_generation;
+    }
     
-    /* Update screen texture */
-    if (vga_frame_ready(&state.vga) || !state.emulator_running) {
+    const char* status = state.emu_status.exchange(nullptr, std::memory_order_acquire);
+    if (status) {
+        set_status(status);
+    }
+    
+    /* Update screen texture, frames identical to the uploaded one are skipped */
+    if (acquire_frame()) {
+        uint32_t front = state.frame_front;
+        if (state.frame_forced[front] || state.frame_hash[front] != state.uploaded_hash) {
+            state.screen_dirty = true;
+        }
+    }
+    if (state.screen_dirty) {
         update_screen_texture();
     }
     
@@ -640,6 +2071,10 @@ static void frame(void) {
     draw_debug_window();
     draw_cpu_state_window();
     draw_memory_viewer();
+    draw_disassembly_window();
+    draw_profiler_window();
+    draw_ram_heatmap_window();
+    draw_perf_overlay();
     draw_status_bar();
     
     /* Render */
@@ -654,10 +2089,22 @@ static void frame(void) {
 }
 
 static void cleanup(void) {
+    /* Stop the emulation thread before tearing down its state */
+    state.emu_quit.store(true, std::memory_order_release);
+    if (state.emu_thread.joinable()) {
+        state.emu_thread.join();
+    }
+    
     /* Cleanup emulator */
+    stop_trace();
+    stop_recording();
     loader_shutdown(&state.loader);
     audio_shutdown(&state.audio);
     vga_shutdown(&state.vga);
+    profiler_shutdown(&state.profiler);
+    vcpu_profiler_shutdown(&state.vcpu_profiler);
+    access_map_shutdown(&state.access_map);
+    disasm_cache_shutdown(&state.disasm);
     gigatron_shutdown(&state.cpu);
     
     /* Cleanup NFD */
@@ -667,6 +2114,10 @@ static void cleanup(void) {
     sg_destroy_view(state.screen_view);
     sg_destroy_sampler(state.screen_sampler);
     sg_destroy_image(state.screen_texture);
+    sg_destroy_view(state.heatmap_view);
+    sg_destroy_image(state.heatmap_texture);
+    sg_destroy_view(state.ram_heatmap_view);
+    sg_destroy_image(state.ram_heatmap_texture);
     
     /* Cleanup sokol */
     saudio_shutdown();
@@ -689,7 +2140,7 @@ static void event(const sapp_event* ev) {
                 if (ev->key_code == SAPP_KEYCODE_O) {
                     open_rom_dialog();
                 } else if (ev->key_code == SAPP_KEYCODE_L) {
-                    if (state.rom_loaded) open_gt1_dialog();
+                    if (state.view.rom_loaded) open_gt1_dialog();
                 }
             } else if (!ev->key_repeat) {
                 switch (ev->key_code) {
@@ -702,18 +2153,26 @@ static void event(const sapp_event* ev) {
                     case SAPP_KEYCODE_F3:
                         state.show_memory_viewer = !state.show_memory_viewer;
                         break;
+                    case SAPP_KEYCODE_F4:
+                        state.show_profiler = !state.show_profiler;
+                        break;
                     case SAPP_KEYCODE_F5:
-                        if (state.rom_loaded) {
-                            gigatron_reset(&state.cpu);
-                            vga_reset(&state.vga);
-                            audio_reset(&state.audio);
-                            loader_reset(&state.loader);
-                            set_status("Emulator reset");
+                        if (state.view.rom_loaded) {
+                            send_command(EMU_CMD_RESET);
                         }
                         break;
+                    case SAPP_KEYCODE_F6:
+                        set_perf_overlay(!state.show_perf_overlay);
+                        break;
+                    case SAPP_KEYCODE_F7:
+                        set_ram_heatmap(!state.show_ram_heatmap);
+                        break;
+                    case SAPP_KEYCODE_F8:
+                        state.show_disassembly = !state.show_disassembly;
+                        break;
                     case SAPP_KEYCODE_SPACE:
-                        if (state.rom_loaded) {
-                            state.emulator_running = !state.emulator_running;
+                        if (state.view.rom_loaded) {
+                            send_command(EMU_CMD_SET_RUNNING, !state.view.running);
                         }
                         break;
                     default:
@@ -722,11 +2181,11 @@ static void event(const sapp_event* ev) {
                 }
             }
             break;
-            
+        
         case SAPP_EVENTTYPE_KEY_UP:
             handle_key(ev->key_code, false);
             break;
-            
+        
         case SAPP_EVENTTYPE_FILES_DROPPED: {
             const int num_files = sapp_get_num_dropped_files();
             if (num_files > 0) {
@@ -735,11 +2194,11 @@ static void event(const sapp_event* ev) {
                 if (len > 4) {
                     if (strcmp(path + len - 4, ".rom") == 0 || 
                         strcmp(path + len - 4, ".ROM") == 0) {
-                        load_rom(path);
+                        send_command(EMU_CMD_LOAD_ROM, 0, path);
                     } else if (strcmp(path + len - 4, ".gt1") == 0 ||
                                strcmp(path + len - 4, ".GT1") == 0) {
-                        if (state.rom_loaded) {
-                            load_gt1(path);
+                        if (state.view.rom_loaded) {
+                            send_command(EMU_CMD_LOAD_GT1, 0, path);
                         } else {
                             set_status("Please load a ROM first");
                         }
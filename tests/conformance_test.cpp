@@ -0,0 +1,374 @@
+/**
+ * Gigatron Instruction Conformance Test
+ *
+ * Executes every 16-bit instruction word from a matrix of register, RAM and
+ * input states on each engine and compares the full post-state (registers,
+ * cycle count and RAM) against the reference gigatron_tick. Directed checks
+ * pin down the reference itself where the hardware is subtle: the [y,x++]
+ * increment, the OUTX latch, stores with the RAM bus, and branch conditions
+ * (signed compares via the ZERO bias).
+ *
+ * The instruction space is split into chunks run on all hardware threads.
+ */
+
+extern "C" {
+#include "gigatron.h"
+#include "machine.h"
+#include "profiler.h"
+#include "disasm.h"
+}
+
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define TEST_CHUNK          256     /* Instruction words per work item */
+#define TEST_MAX_REPORTS    20      /* Failures printed in detail */
+
+/* Encode an instruction word from its fields */
+#define TEST_IR(op, mode, bus, d)   ((uint16_t)(((op) << 13) | ((mode) << 10) | ((bus) << 8) | (d)))
+
+/* State matrix: ZERO bias edges for AC, page and RAM mask edges for X and Y,
+ * OUT with bit 6 low and high for the OUTX latch, and a branch on the last
+ * word of a page (the target page is the next one) */
+static const uint16_t test_pcs[] = { 0x1234, 0x12FF };
+static const uint8_t test_acs[] = { 0x00, 0x01, 0x7F, 0x80, 0x81, 0xFF };
+static const uint8_t test_xs[] = { 0x00, 0x7F, 0xFF };
+static const uint8_t test_ys[] = { 0x00, 0x7F, 0xFF };
+static const uint8_t test_outs[] = { 0x00, 0x40, 0xFF };
+static const uint8_t test_ins[] = { 0x00, 0xA5 };
+static const uint8_t test_outx = 0x5A;
+
+#define TEST_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+/**
+ * Worker-owned engine context
+ */
+struct engine_ctx_t {
+    gigatron_t* cpu;
+    machine_t machine;
+    profiler_t profiler;
+    access_map_t access_map;
+};
+
+/**
+ * Engine under test: executes one instruction
+ */
+struct engine_t {
+    const char* name;
+    void (*step)(engine_ctx_t* ctx);
+};
+
+static void engine_run(engine_ctx_t* ctx) {
+    gigatron_run(ctx->cpu, 1);
+}
+
+static void engine_machine(engine_ctx_t* ctx) {
+    machine_set_profiler(&ctx->machine, nullptr);
+    machine_set_access_map(&ctx->machine, nullptr);
+    machine_run(&ctx->machine, 1);
+}
+
+static void engine_checked(engine_ctx_t* ctx) {
+    machine_set_profiler(&ctx->machine, nullptr);
+    machine_set_access_map(&ctx->machine, nullptr);
+    machine_until_t until = { MACHINE_STOP_CYCLES | MACHINE_STOP_OUTX, 0, 0, 1 };
+    machine_run_until(&ctx->machine, &until);
+}
+
+static void engine_instrumented(engine_ctx_t* ctx) {
+    machine_set_profiler(&ctx->machine, &ctx->profiler);
+    machine_set_access_map(&ctx->machine, nullptr);
+    machine_run(&ctx->machine, 1);
+}
+
+static void engine_access_counted(engine_ctx_t* ctx) {
+    machine_set_profiler(&ctx->machine, nullptr);
+    machine_set_access_map(&ctx->machine, &ctx->access_map);
+    machine_run(&ctx->machine, 1);
+}
+
+static const engine_t engines[] = {
+    { "gigatron_run",         engine_run },
+    { "machine (counted)",    engine_machine },
+    { "machine (checked)",    engine_checked },
+    { "machine (instrumented)", engine_instrumented },
+    { "machine (access counted)", engine_access_counted },
+};
+
+/* Shared results */
+static std::atomic<uint32_t> next_chunk{0};
+static std::atomic<uint64_t> total_checks{0};
+static std::atomic<uint64_t> total_failures{0};
+static std::mutex report_mutex;
+
+/**
+ * Register state of one test case
+ */
+struct test_state_t {
+    uint16_t pc;
+    uint8_t ac, x, y, out, in;
+};
+
+static void set_state(gigatron_t* cpu, const test_state_t& s) {
+    cpu->pc = s.pc;
+    cpu->next_pc = (uint16_t)((s.pc + 1) & cpu->rom_mask);
+    cpu->ac = s.ac;
+    cpu->x = s.x;
+    cpu->y = s.y;
+    cpu->out = s.out;
+    cpu->outx = test_outx;
+    cpu->in_reg = s.in;
+    cpu->cycles = 0;
+}
+
+static bool regs_equal(const gigatron_t* a, const gigatron_t* b) {
+    return a->pc == b->pc && a->next_pc == b->next_pc && a->ac == b->ac && a->x == b->x &&
+           a->y == b->y && a->out == b->out && a->outx == b->outx && a->in_reg == b->in_reg &&
+           a->cycles == b->cycles;
+}
+
+/* RAM bytes an instruction can address from a state */
+static void candidate_addrs(const gigatron_t* cpu, const test_state_t& s, uint8_t d, uint32_t addrs[4]) {
+    addrs[0] = d & cpu->ram_mask;
+    addrs[1] = s.x & cpu->ram_mask;
+    addrs[2] = (((uint32_t)s.y << 8) | d) & cpu->ram_mask;
+    addrs[3] = (((uint32_t)s.y << 8) | s.x) & cpu->ram_mask;
+}
+
+static void report_failure(const char* engine, uint16_t ir, const test_state_t& s,
+                           const gigatron_t* ref, const gigatron_t* dut, const char* what) {
+    std::lock_guard<std::mutex> lock(report_mutex);
+    if (total_failures.fetch_add(1) >= TEST_MAX_REPORTS) return;
+    
+    char text[DISASM_MAX_TEXT];
+    disasm_native(ir, text, sizeof(text));
+    printf("FAIL %s: %04X %-18s pc=%04X ac=%02X x=%02X y=%02X out=%02X in=%02X: %s\n",
+           engine, ir, text, s.pc, s.ac, s.x, s.y, s.out, s.in, what);
+    printf("     reference pc=%04X next=%04X ac=%02X x=%02X y=%02X out=%02X outx=%02X\n",
+           ref->pc, ref->next_pc, ref->ac, ref->x, ref->y, ref->out, ref->outx);
+    printf("     engine    pc=%04X next=%04X ac=%02X x=%02X y=%02X out=%02X outx=%02X\n",
+           dut->pc, dut->next_pc, dut->ac, dut->x, dut->y, dut->out, dut->outx);
+}
+
+/**
+ * Worker: take chunks of instruction words until none are left
+ */
+static void worker(const std::vector<uint8_t>* pattern) {
+    gigatron_config_t config = gigatron_default_config();
+    gigatron_t ref;
+    gigatron_t dut;
+    engine_ctx_t ctx;
+    if (!gigatron_init(&ref, &config) || !gigatron_init(&dut, &config) ||
+        !profiler_init(&ctx.profiler, dut.rom_size) || !access_map_init(&ctx.access_map, dut.ram_size)) {
+        total_failures++;
+        return;
+    }
+    memcpy(ref.ram, pattern->data(), ref.ram_size);
+    memcpy(dut.ram, pattern->data(), dut.ram_size);
+    ctx.cpu = &dut;
+    machine_init(&ctx.machine, &dut, nullptr, nullptr);
+    
+    uint64_t checks = 0;
+    uint32_t chunk;
+    while ((chunk = next_chunk.fetch_add(1)) < 65536 / TEST_CHUNK) {
+        for (uint32_t i = 0; i < TEST_CHUNK; i++) {
+            uint16_t ir = (uint16_t)(chunk * TEST_CHUNK + i);
+            uint8_t d = ir & 0xFF;
+            
+            for (uint16_t pc : test_pcs)
+            for (uint8_t ac : test_acs)
+            for (uint8_t x : test_xs)
+            for (uint8_t y : test_ys)
+            for (uint8_t out : test_outs)
+            for (uint8_t in : test_ins) {
+                test_state_t s = { pc, ac, x, y, out, in };
+                uint32_t addrs[4];
+                candidate_addrs(&ref, s, d, addrs);
+                
+                ref.rom[pc] = ir;
+                dut.rom[pc] = ir;
+                set_state(&ref, s);
+                gigatron_tick(&ref);
+                
+                for (const engine_t& engine : engines) {
+                    set_state(&dut, s);
+                    engine.step(&ctx);
+                    checks++;
+                    
+                    if (!regs_equal(&ref, &dut)) {
+                        report_failure(engine.name, ir, s, &ref, &dut, "registers differ");
+                    } else {
+                        for (uint32_t a : addrs) {
+                            if (ref.ram[a] != dut.ram[a]) {
+                                report_failure(engine.name, ir, s, &ref, &dut, "RAM differs");
+                                break;
+                            }
+                        }
+                    }
+                    for (uint32_t a : addrs) {
+                        dut.ram[a] = (*pattern)[a];
+                    }
+                }
+                for (uint32_t a : addrs) {
+                    ref.ram[a] = (*pattern)[a];
+                }
+                ref.rom[pc] = 0;
+                dut.rom[pc] = 0;
+            }
+            
+            /* Writes outside the addressable bytes would survive the restore */
+            if (memcmp(ref.ram, pattern->data(), ref.ram_size) != 0 ||
+                memcmp(dut.ram, pattern->data(), dut.ram_size) != 0) {
+                test_state_t s = { test_pcs[0], 0, 0, 0, 0, 0 };
+                report_failure("any", ir, s, &ref, &dut, "stray RAM write");
+                memcpy(ref.ram, pattern->data(), ref.ram_size);
+                memcpy(dut.ram, pattern->data(), dut.ram_size);
+            }
+        }
+    }
+    total_checks += checks;
+    
+    profiler_shutdown(&ctx.profiler);
+    access_map_shutdown(&ctx.access_map);
+    gigatron_shutdown(&ref);
+    gigatron_shutdown(&dut);
+}
+
+/*
+ * Directed checks of the reference
+ */
+
+static uint32_t directed_failures = 0;
+
+static void expect(bool ok, const char* what) {
+    if (!ok) {
+        printf("FAIL reference: %s\n", what);
+        directed_failures++;
+    }
+}
+
+/* Execute one instruction at 0x0100 on the reference */
+static void exec_one(gigatron_t* cpu, uint16_t ir) {
+    cpu->rom[0x0100] = ir;
+    cpu->pc = 0x0100;
+    cpu->next_pc = 0x0101;
+    cpu->cycles = 0;
+    gigatron_tick(cpu);
+}
+
+static void directed_checks() {
+    gigatron_config_t config = gigatron_default_config();
+    gigatron_t cpu;
+    if (!gigatron_init(&cpu, &config)) {
+        expect(false, "init");
+        return;
+    }
+    memset(cpu.ram, 0, cpu.ram_size);
+    
+    /* [y,x++]: reads Y:X, then X increments and wraps within the page */
+    cpu.ram[0x12FF] = 0x3C;
+    cpu.x = 0xFF;
+    cpu.y = 0x12;
+    cpu.ac = 0x01;
+    cpu.out = 0x00;
+    exec_one(&cpu, TEST_IR(2, 7, 1, 0x00));     /* ora [y,x++],out */
+    expect(cpu.out == 0x3D && cpu.x == 0x00 && cpu.y == 0x12, "ora [y,x++],out reads Y:X and increments X");
+    
+    cpu.x = 0x10;
+    cpu.ac = 0x77;
+    exec_one(&cpu, TEST_IR(6, 7, 2, 0x00));     /* st [y,x++] */
+    expect(cpu.ram[0x1210] == 0x77 && cpu.x == 0x11, "st [y,x++] writes Y:X and increments X");
+    
+    /* OUTX latches AC on the rising edge of OUT bit 6 (HSYNC) only */
+    cpu.out = 0x00;
+    cpu.outx = 0x00;
+    cpu.ac = 0xA5;
+    exec_one(&cpu, TEST_IR(0, 6, 0, 0x40));     /* ld $40,out */
+    expect(cpu.out == 0x40 && cpu.outx == 0xA5, "OUTX latches AC on bit 6 rising");
+    
+    cpu.ac = 0x5A;
+    exec_one(&cpu, TEST_IR(0, 6, 0, 0xC0));     /* ld $c0,out: bit 6 stays high */
+    expect(cpu.outx == 0xA5, "OUTX holds while bit 6 stays high");
+    
+    exec_one(&cpu, TEST_IR(0, 6, 0, 0x00));     /* ld $00,out: falling */
+    expect(cpu.outx == 0xA5, "OUTX holds on bit 6 falling");
+    
+    cpu.ac = 0x3C;
+    exec_one(&cpu, TEST_IR(0, 6, 2, 0x00));     /* ld ac,out with AC bit 6 low: no edge */
+    expect(cpu.outx == 0xA5, "OUTX holds without a rising edge");
+    
+    /* Store with the RAM bus: the bus is undriven, the reference stores 0 */
+    cpu.ram[0x0020] = 0xEE;
+    cpu.ac = 0x99;
+    exec_one(&cpu, TEST_IR(6, 0, 1, 0x20));     /* st ?,[$20] */
+    expect(cpu.ram[0x0020] == 0x00 && cpu.ac == 0x99, "st with RAM bus stores 0, AC unchanged");
+    
+    /* Store modes 4 and 5 also load X or Y with the stored value */
+    cpu.ac = 0x42;
+    exec_one(&cpu, TEST_IR(6, 4, 2, 0x30));     /* st [$30],x */
+    expect(cpu.ram[0x0030] == 0x42 && cpu.x == 0x42, "st [$30],x loads X");
+    exec_one(&cpu, TEST_IR(6, 5, 0, 0x31));     /* st $31,[$31],y */
+    expect(cpu.ram[0x0031] == 0x31 && cpu.y == 0x31, "st $31,[$31],y loads Y");
+    
+    /* Branch conditions compare AC as signed (AC ^ ZERO against ZERO) */
+    for (uint32_t ac = 0; ac < 256; ac++) {
+        int8_t v = (int8_t)ac;
+        bool taken[8] = { true, v > 0, v < 0, v != 0, v == 0, v >= 0, v <= 0, true };
+        for (uint8_t cond = 1; cond < 8; cond++) {
+            cpu.ac = (uint8_t)ac;
+            exec_one(&cpu, TEST_IR(7, cond, 0, 0x80));
+            uint16_t expected = taken[cond] ? 0x0180 : 0x0102;
+            if (cpu.next_pc != expected) {
+                char what[64];
+                snprintf(what, sizeof(what), "branch condition %u with AC=%02X", cond, ac);
+                expect(false, what);
+            }
+        }
+    }
+    
+    /* Far jump takes the page from Y, conditional branches stay in the delay slot's page */
+    cpu.y = 0x34;
+    exec_one(&cpu, TEST_IR(7, 0, 0, 0x56));     /* jmp y,$56 */
+    expect(cpu.pc == 0x0101 && cpu.next_pc == 0x3456, "jmp y,$56 targets Y:D after the delay slot");
+    
+    cpu.rom[0x01FF] = TEST_IR(7, 7, 0, 0x10);   /* bra $10 on the last word of a page */
+    cpu.pc = 0x01FF;
+    cpu.next_pc = 0x0200;
+    gigatron_tick(&cpu);
+    expect(cpu.next_pc == 0x0210, "bra at a page end targets the next page");
+    
+    gigatron_shutdown(&cpu);
+}
+
+int main() {
+    directed_checks();
+    
+    /* Deterministic RAM pattern shared by all workers */
+    std::vector<uint8_t> pattern(GIGATRON_RAM_SIZE);
+    uint32_t seed = 0x12345678;
+    for (uint8_t& byte : pattern) {
+        seed = seed * 1664525u + 1013904223u;
+        byte = (uint8_t)(seed >> 24);
+    }
+    
+    unsigned num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0) num_threads = 4;
+    
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < num_threads; i++) {
+        threads.emplace_back(worker, &pattern);
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    
+    uint64_t failures = total_failures.load();
+    printf("%llu engine checks on %u threads, %llu failures, %u directed failures\n",
+           (unsigned long long)total_checks.load(), num_threads, (unsigned long long)failures,
+           directed_failures);
+    return (failures || directed_failures) ? 1 : 0;
+}
@@ -0,0 +1,306 @@
+/**
+ * Gigatron Golden Frame-Hash Test
+ *
+ * Boots the ROM, optionally loads a GT1, replays scripted input and hashes
+ * the framebuffer and RAM at given frames, comparing against a checked-in
+ * golden file:
+ *   gigatron_golden_test <rom> <cases> <golden> [--update]
+ *
+ * Cases file, one command per line (# starts a comment):
+ *   case NAME              Start a case: reset with zeroed RAM
+ *   gt1 FILE               Load FILE (relative to the cases file) from frame 0
+ *   input FRAME BUTTONS    Set the buttons held from FRAME on (A+DOWN, none)
+ *   check FRAME...         Hash after FRAME frames
+ *
+ * Input goes through machine_set_input; a case fails if in_reg does not
+ * hold it after a frame with the loader idle.
+ *
+ * Golden file: "NAME FRAME FRAMEBUFFER_HASH RAM_HASH" per check. --update
+ * rewrites it from the current results. Cases run on all hardware threads.
+ */
+
+extern "C" {
+#include "gigatron.h"
+#include "vga.h"
+#include "loader.h"
+#include "machine.h"
+}
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define GOLDEN_SCALE    4       /* Hash every VGA line */
+
+/**
+ * Scripted input change
+ */
+struct golden_input_t {
+    uint32_t frame;
+    uint8_t buttons;
+};
+
+/**
+ * Test case and its results
+ */
+struct golden_case_t {
+    std::string name;
+    std::string gt1;                    /* Empty if none */
+    std::vector<golden_input_t> inputs;
+    std::vector<uint32_t> checks;
+    std::vector<std::string> results;   /* "NAME FRAME FB RAM" per check */
+    std::string error;
+};
+
+static const struct {
+    const char* name;
+    uint8_t bit;
+} button_names[] = {
+    { "RIGHT", GIGATRON_BTN_RIGHT }, { "LEFT", GIGATRON_BTN_LEFT },
+    { "DOWN", GIGATRON_BTN_DOWN },   { "UP", GIGATRON_BTN_UP },
+    { "START", GIGATRON_BTN_START }, { "SELECT", GIGATRON_BTN_SELECT },
+    { "B", GIGATRON_BTN_B },         { "A", GIGATRON_BTN_A },
+};
+
+/**
+ * FNV-1a over a byte range
+ */
+static uint64_t golden_hash(const uint8_t* data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+static bool parse_buttons(const std::string& text, uint8_t* buttons) {
+    *buttons = 0;
+    if (text == "none") return true;
+    std::stringstream names(text);
+    std::string name;
+    while (std::getline(names, name, '+')) {
+        bool found = false;
+        for (const auto& button : button_names) {
+            if (name == button.name) {
+                *buttons |= button.bit;
+                found = true;
+            }
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+/**
+ * Parse the cases file. Returns false with a message on a syntax error.
+ */
+static bool parse_cases(const char* filename, std::vector<golden_case_t>* cases) {
+    std::ifstream file(filename);
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", filename);
+        return false;
+    }
+    
+    std::string dir = filename;
+    size_t slash = dir.find_last_of("/\\");
+    dir = slash == std::string::npos ? "" : dir.substr(0, slash + 1);
+    
+    std::string line;
+    uint32_t line_no = 0;
+    while (std::getline(file, line)) {
+        line_no++;
+        line = line.substr(0, line.find('#'));
+        std::stringstream words(line);
+        std::string command;
+        if (!(words >> command)) continue;
+        
+        bool ok = command == "case" || !cases->empty();
+        if (command == "case") {
+            golden_case_t c;
+            ok = static_cast<bool>(words >> c.name);
+            cases->push_back(c);
+        } else if (ok && command == "gt1") {
+            std::string gt1;
+            ok = static_cast<bool>(words >> gt1);
+            cases->back().gt1 = dir + gt1;
+        } else if (ok && command == "input") {
+            golden_input_t input;
+            std::string buttons;
+            ok = (words >> input.frame >> buttons) && parse_buttons(buttons, &input.buttons);
+            cases->back().inputs.push_back(input);
+        } else if (ok && command == "check") {
+            uint32_t frame;
+            while (words >> frame) {
+                cases->back().checks.push_back(frame);
+            }
+            ok = !cases->back().checks.empty();
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s:%u: invalid line\n", filename, line_no);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Run one case and fill in its results
+ */
+static void run_case(golden_case_t* c, const char* rom_file) {
+    gigatron_config_t config = gigatron_default_config();
+    gigatron_t cpu;
+    vga_t vga;
+    loader_t loader;
+    machine_t machine;
+    if (!gigatron_init(&cpu, &config)) {
+        c->error = "failed to initialize CPU";
+        return;
+    }
+    std::vector<uint8_t> pixels((size_t)VGA_WIDTH * VGA_HEIGHT);
+    if (!gigatron_load_rom_file(&cpu, rom_file) || !vga_init(&vga, &cpu) || !loader_init(&loader, &cpu)) {
+        c->error = "failed to load ROM";
+        gigatron_shutdown(&cpu);
+        return;
+    }
+    vga_set_framebuffer(&vga, pixels.data(), VGA_WIDTH, VGA_FORMAT_INDEX8, GOLDEN_SCALE);
+    memset(cpu.ram, 0, cpu.ram_size);
+    gigatron_reset(&cpu);
+    machine_init(&machine, &cpu, &vga, &loader);
+    
+    if (!c->gt1.empty()) {
+        gt1_file_t* gt1 = loader_load_gt1_file(c->gt1.c_str());
+        if (!gt1) {
+            c->error = "failed to load " + c->gt1;
+        } else {
+            loader_start(&loader, gt1);
+        }
+    }
+    
+    uint32_t last = 0;
+    for (uint32_t frame : c->checks) {
+        last = frame > last ? frame : last;
+    }
+    
+    machine_until_t until = { MACHINE_STOP_VSYNC, 0, 0, 0 };
+    for (uint32_t frame = 0; c->error.empty(); ) {
+        for (const golden_input_t& input : c->inputs) {
+            if (input.frame == frame) machine_set_input(&machine, input.buttons ^ 0xFF);
+        }
+        for (uint32_t check : c->checks) {
+            if (check != frame) continue;
+            char result[128];
+            snprintf(result, sizeof(result), "%s %u %016llx %016llx", c->name.c_str(), frame,
+                     (unsigned long long)golden_hash(pixels.data(), pixels.size()),
+                     (unsigned long long)golden_hash(cpu.ram, cpu.ram_size));
+            c->results.push_back(result);
+        }
+        if (frame++ == last) break;
+        machine_run_until(&machine, &until);
+        
+        /* The input takes over on the cycle the loader finishes, not at the next run */
+        if (!loader_is_active(&loader) && cpu.in_reg != machine.input) {
+            c->error = "input not applied after the loader finished";
+        }
+    }
+    if (loader_has_error(&loader)) {
+        c->error = std::string("loader: ") + loader_get_error(&loader);
+    }
+    
+    loader_shutdown(&loader);
+    vga_shutdown(&vga);
+    gigatron_shutdown(&cpu);
+}
+
+static std::string result_key(const std::string& result) {
+    size_t end = result.find(' ', result.find(' ') + 1);
+    return result.substr(0, end);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4 || (argc > 4 && strcmp(argv[4], "--update") != 0)) {
+        fprintf(stderr, "Usage: gigatron_golden_test <rom> <cases> <golden> [--update]\n");
+        return 1;
+    }
+    const char* rom_file = argv[1];
+    const char* golden_file = argv[3];
+    bool update = argc > 4;
+    
+    std::vector<golden_case_t> cases;
+    if (!parse_cases(argv[2], &cases)) return 1;
+    
+    /* Run the cases on all hardware threads */
+    std::atomic<size_t> next_case{0};
+    unsigned num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0) num_threads = 4;
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < num_threads; i++) {
+        threads.emplace_back([&]() {
+            size_t index;
+            while ((index = next_case.fetch_add(1)) < cases.size()) {
+                run_case(&cases[index], rom_file);
+            }
+        });
+    }
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    
+    uint32_t failures = 0;
+    for (const golden_case_t& c : cases) {
+        if (!c.error.empty()) {
+            printf("FAIL %s: %s\n", c.name.c_str(), c.error.c_str());
+            failures++;
+        }
+    }
+    
+    if (update) {
+        FILE* file = fopen(golden_file, "w");
+        if (!file) {
+            fprintf(stderr, "Failed to write %s\n", golden_file);
+            return 1;
+        }
+        fprintf(file, "# case frame framebuffer_hash ram_hash (gigatron_golden_test --update)\n");
+        for (const golden_case_t& c : cases) {
+            for (const std::string& result : c.results) {
+                fprintf(file, "%s\n", result.c_str());
+            }
+        }
+        fclose(file);
+        printf("Wrote %s\n", golden_file);
+        return failures ? 1 : 0;
+    }
+    
+    std::map<std::string, std::string> golden;
+    std::ifstream file(golden_file);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line[0] != '#') golden[result_key(line)] = line;
+    }
+    
+    uint32_t checks = 0;
+    for (const golden_case_t& c : cases) {
+        for (const std::string& result : c.results) {
+            checks++;
+            auto it = golden.find(result_key(result));
+            if (it == golden.end()) {
+                printf("FAIL %s: no golden entry\n", result.c_str());
+                failures++;
+            } else if (it->second != result) {
+                printf("FAIL %s: expected %s\n", result.c_str(), it->second.c_str());
+                failures++;
+            }
+        }
+    }
+    
+    printf("%zu cases, %u checks on %u threads, %u failures\n", cases.size(), checks, num_threads, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,305 @@
+/**
+ * Gigatron Engine Divergence Bisector
+ *
+ * Runs two execution engines side by side from the same state, compares
+ * the full machine state (registers and RAM) at checkpoints, and on a
+ * mismatch bisects from the last matching snapshot down to the first
+ * cycle where they differ:
+ *   gigatron_bisect <rom> <engine_a> <engine_b> [--cycles N] [--interval N]
+ *                   [--seed N] [--inject CYCLE]
+ *
+ * New engines are added to the engines table.
+ */
+
+#include "gigatron.h"
+#include "machine.h"
+#include "disasm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BISECT_DEFAULT_CYCLES   (60ULL * GIGATRON_CYCLES_PER_FRAME)
+#define BISECT_DEFAULT_INTERVAL 1000000ULL
+#define BISECT_MAX_RAM_DIFFS    16
+
+/**
+ * Execution engine: advances the CPU by a number of cycles
+ */
+typedef struct engine_t {
+    const char* name;
+    const char* description;
+    void (*run)(gigatron_t* cpu, uint64_t cycles);
+} engine_t;
+
+/**
+ * CPU registers and RAM at one cycle
+ */
+typedef struct snapshot_t {
+    gigatron_t regs;        /* rom/ram pointers are not used */
+    uint8_t* ram;
+} snapshot_t;
+
+static void engine_tick(gigatron_t* cpu, uint64_t cycles) {
+    for (uint64_t i = 0; i < cycles; i++) {
+        gigatron_tick(cpu);
+    }
+}
+
+static void engine_run(gigatron_t* cpu, uint64_t cycles) {
+    while (cycles > 0) {
+        uint32_t n = cycles > UINT32_MAX ? UINT32_MAX : (uint32_t)cycles;
+        gigatron_run(cpu, n);
+        cycles -= n;
+    }
+}
+
+static void engine_machine(gigatron_t* cpu, uint64_t cycles) {
+    machine_t machine;
+    machine_init(&machine, cpu, NULL, NULL);
+    machine_run(&machine, cycles);
+}
+
+/* An OUTX stop condition selects the per-cycle checked loop */
+static void engine_machine_checked(gigatron_t* cpu, uint64_t cycles) {
+    machine_t machine;
+    machine_init(&machine, cpu, NULL, NULL);
+    machine_until_t until = { MACHINE_STOP_CYCLES | MACHINE_STOP_OUTX, 0, 0, 0 };
+    uint64_t end = cpu->cycles + cycles;
+    while (cpu->cycles < end) {
+        until.cycles = end - cpu->cycles;
+        machine_run_until(&machine, &until);
+    }
+}
+
+static const engine_t engines[] = {
+    { "tick",    "gigatron_tick per cycle (reference)",           engine_tick },
+    { "run",     "gigatron_run",                                  engine_run },
+    { "machine", "machine_run, counted fast path",                engine_machine },
+    { "checked", "machine_run_until, checked loop (OUTX stops)",  engine_machine_checked },
+};
+
+#define NUM_ENGINES (sizeof(engines) / sizeof(engines[0]))
+
+static const engine_t* find_engine(const char* name) {
+    for (size_t i = 0; i < NUM_ENGINES; i++) {
+        if (strcmp(engines[i].name, name) == 0) return &engines[i];
+    }
+    return NULL;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage: gigatron_bisect <rom> <engine_a> <engine_b> [--cycles N] [--interval N]\n"
+            "                       [--seed N] [--inject CYCLE]\n"
+            "  --cycles N      Cycles to compare (default %llu)\n"
+            "  --interval N    Cycles between checkpoints (default %llu)\n"
+            "  --seed N        RAM fill seed, 0 = zeroed RAM (default)\n"
+            "  --inject CYCLE  Corrupt RAM in engine B after CYCLE (tests the bisector)\n"
+            "Engines:\n",
+            (unsigned long long)BISECT_DEFAULT_CYCLES, (unsigned long long)BISECT_DEFAULT_INTERVAL);
+    for (size_t i = 0; i < NUM_ENGINES; i++) {
+        fprintf(stderr, "  %-10s %s\n", engines[i].name, engines[i].description);
+    }
+}
+
+/*
+ * Snapshots
+ */
+
+static void snapshot_save(snapshot_t* snap, const gigatron_t* cpu) {
+    snap->regs = *cpu;
+    memcpy(snap->ram, cpu->ram, cpu->ram_size);
+}
+
+static void snapshot_restore(const snapshot_t* snap, gigatron_t* cpu) {
+    uint16_t* rom = cpu->rom;
+    uint8_t* ram = cpu->ram;
+    *cpu = snap->regs;
+    cpu->rom = rom;
+    cpu->ram = ram;
+    memcpy(cpu->ram, snap->ram, cpu->ram_size);
+}
+
+/**
+ * Compare the full state of two CPUs
+ */
+static bool state_equal(const gigatron_t* a, const gigatron_t* b) {
+    return a->pc == b->pc && a->next_pc == b->next_pc && a->ac == b->ac && a->x == b->x &&
+           a->y == b->y && a->out == b->out && a->outx == b->outx && a->in_reg == b->in_reg &&
+           a->cycles == b->cycles && memcmp(a->ram, b->ram, a->ram_size) == 0;
+}
+
+/*
+ * Side-by-side execution
+ */
+
+static const engine_t* engine_a;
+static const engine_t* engine_b;
+static uint64_t inject_cycle = UINT64_MAX;
+
+/**
+ * Run engine B, corrupting the last RAM byte once the injection cycle has run
+ */
+static void run_b(gigatron_t* cpu, uint64_t cycles) {
+    uint64_t end = cpu->cycles + cycles;
+    if (inject_cycle >= cpu->cycles && inject_cycle < end) {
+        engine_b->run(cpu, inject_cycle + 1 - cpu->cycles);
+        cpu->ram[cpu->ram_mask] ^= 0xFF;
+    }
+    engine_b->run(cpu, end - cpu->cycles);
+}
+
+/**
+ * Restore both CPUs to a snapshot, run both, and compare
+ */
+static bool run_pair(const snapshot_t* from, gigatron_t* a, gigatron_t* b, uint64_t cycles) {
+    snapshot_restore(from, a);
+    snapshot_restore(from, b);
+    engine_a->run(a, cycles);
+    run_b(b, cycles);
+    return state_equal(a, b);
+}
+
+static void print_state(const char* label, const gigatron_t* cpu) {
+    printf("  %-10s pc=%04X next=%04X ac=%02X x=%02X y=%02X out=%02X outx=%02X in=%02X cycles=%llu\n",
+           label, cpu->pc, cpu->next_pc, cpu->ac, cpu->x, cpu->y, cpu->out, cpu->outx, cpu->in_reg,
+           (unsigned long long)cpu->cycles);
+}
+
+/**
+ * Print the diverging instruction and both resulting states
+ */
+static void report(const snapshot_t* before, const gigatron_t* a, const gigatron_t* b) {
+    uint16_t pc = before->regs.pc;
+    uint16_t ir = a->rom[pc & a->rom_mask];
+    char text[DISASM_MAX_TEXT];
+    disasm_native(ir, text, sizeof(text));
+    
+    printf("First divergence at cycle %llu\n", (unsigned long long)before->regs.cycles);
+    printf("  instruction %04X: %04X  %s\n", pc, ir, text);
+    printf("State before:\n");
+    print_state("", &before->regs);
+    printf("State after:\n");
+    print_state(engine_a->name, a);
+    print_state(engine_b->name, b);
+    
+    uint32_t diffs = 0;
+    for (uint32_t addr = 0; addr < a->ram_size; addr++) {
+        if (a->ram[addr] == b->ram[addr]) continue;
+        if (diffs++ < BISECT_MAX_RAM_DIFFS) {
+            printf("  ram[%04X]  %s=%02X %s=%02X (was %02X)\n", addr, engine_a->name, a->ram[addr],
+                   engine_b->name, b->ram[addr], before->ram[addr]);
+        }
+    }
+    if (diffs > BISECT_MAX_RAM_DIFFS) {
+        printf("  ... %u RAM bytes differ\n", diffs);
+    }
+}
+
+/**
+ * Narrow a divergence within step cycles after good down to one cycle and report it
+ */
+static void bisect(snapshot_t* good, gigatron_t* a, gigatron_t* b, uint64_t step) {
+    printf("Divergence between cycles %llu and %llu, bisecting\n",
+           (unsigned long long)good->regs.cycles, (unsigned long long)(good->regs.cycles + step));
+    
+    /* Invariant: good matches, good + step does not */
+    while (step > 1) {
+        uint64_t half = step / 2;
+        if (run_pair(good, a, b, half)) {
+            snapshot_save(good, a);
+            step -= half;
+        } else {
+            step = half;
+        }
+    }
+    
+    run_pair(good, a, b, 1);
+    report(good, a, b);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        usage();
+        return 1;
+    }
+    
+    engine_a = find_engine(argv[2]);
+    engine_b = find_engine(argv[3]);
+    if (!engine_a || !engine_b) {
+        usage();
+        return 1;
+    }
+    
+    uint64_t total = BISECT_DEFAULT_CYCLES;
+    uint64_t interval = BISECT_DEFAULT_INTERVAL;
+    uint32_t seed = 0;
+    for (int i = 4; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        uint64_t value = strtoull(argv[i + 1], NULL, 10);
+        if (strcmp(argv[i], "--cycles") == 0) {
+            total = value;
+        } else if (strcmp(argv[i], "--interval") == 0) {
+            interval = value ? value : 1;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            seed = (uint32_t)value;
+        } else if (strcmp(argv[i], "--inject") == 0) {
+            inject_cycle = value;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    
+    gigatron_config_t config = gigatron_default_config();
+    gigatron_t a;
+    gigatron_t b;
+    if (!gigatron_init(&a, &config) || !gigatron_init(&b, &config)) {
+        fprintf(stderr, "Failed to initialize CPU\n");
+        return 1;
+    }
+    if (!gigatron_load_rom_file(&a, argv[1]) || !gigatron_load_rom_file(&b, argv[1])) {
+        fprintf(stderr, "Failed to load ROM: %s\n", argv[1]);
+        return 1;
+    }
+    
+    snapshot_t good = { a, (uint8_t*)malloc(a.ram_size) };
+    if (!good.ram) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    /* Common start: reset with reproducible RAM contents */
+    for (uint32_t i = 0; i < a.ram_size; i++) {
+        seed = seed ? seed * 1664525u + 1013904223u : 0;
+        a.ram[i] = (uint8_t)(seed >> 24);
+    }
+    gigatron_reset(&a);
+    snapshot_save(&good, &a);
+    
+    /* Checkpoints: advance both while they agree */
+    uint64_t done = 0;
+    uint64_t step = 0;
+    while (done < total) {
+        step = total - done < interval ? total - done : interval;
+        if (!run_pair(&good, &a, &b, step)) break;
+        snapshot_save(&good, &a);
+        done += step;
+    }
+    
+    bool diverged = done < total;
+    if (!diverged) {
+        printf("No divergence in %llu cycles (%s vs %s)\n", (unsigned long long)total,
+               engine_a->name, engine_b->name);
+    } else {
+        bisect(&good, &a, &b, step);
+    }
+    
+    free(good.ram);
+    gigatron_shutdown(&a);
+    gigatron_shutdown(&b);
+    return diverged ? 2 : 0;
+}
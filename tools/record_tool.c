@@ -0,0 +1,177 @@
+/**
+ * Gigatron Recording Tool
+ *
+ * Runs a ROM headless as fast as the host allows and records its picture
+ * and sound:
+ *   gigatron_record <rom> <frames> [--gt1 FILE] [--video FILE] [--format y4m|indexed]
+ *                   [--scale N] [--audio FILE]
+ *
+ * The recorder waits for its writer thread instead of dropping, so the
+ * output is complete however slow the disk.
+ */
+
+#include "gigatron.h"
+#include "vga.h"
+#include "audio.h"
+#include "loader.h"
+#include "machine.h"
+#include "pacer.h"
+#include "recorder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage:\n"
+            "  gigatron_record <rom> <frames> [--gt1 FILE] [--video FILE] [--format y4m|indexed]\n"
+            "                  [--scale 1|2|4] [--audio FILE]\n"
+            "The video format defaults to y4m for a .y4m file, indexed otherwise.\n");
+}
+
+/**
+ * Pick the video format from a file name
+ */
+static recorder_video_t video_format(const char* path) {
+    size_t length = strlen(path);
+    return (length >= 4 && strcmp(path + length - 4, ".y4m") == 0) ? RECORDER_VIDEO_Y4M :
+                                                                   RECORDER_VIDEO_INDEXED;
+}
+
+/**
+ * Run to the next VSYNC and render its audio. Samples reach the recorder
+ * through the tap, the ring is only drained.
+ */
+static void run_frame(machine_t* machine, audio_t* audio) {
+    static float drain[AUDIO_BUFFER_SIZE];
+    machine_until_t until = { MACHINE_STOP_VSYNC, 0, 0, 0 };
+    machine_run_until(machine, &until);
+    audio_update(audio);
+    while (audio_read_samples(audio, drain, AUDIO_BUFFER_SIZE) == AUDIO_BUFFER_SIZE) {
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        usage();
+        return 1;
+    }
+    const char* rom_path = argv[1];
+    uint32_t frames = (uint32_t)strtoul(argv[2], NULL, 10);
+    const char* gt1_path = NULL;
+    const char* format = NULL;
+    
+    recorder_config_t rec_config = recorder_default_config();
+    rec_config.video = RECORDER_VIDEO_NONE;
+    rec_config.wait = true;
+    for (int i = 3; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) {
+            usage();
+            return 1;
+        }
+        if (strcmp(argv[i], "--gt1") == 0) {
+            gt1_path = value;
+        } else if (strcmp(argv[i], "--video") == 0) {
+            rec_config.video_path = value;
+        } else if (strcmp(argv[i], "--format") == 0) {
+            format = value;
+        } else if (strcmp(argv[i], "--scale") == 0) {
+            rec_config.scale = (uint32_t)strtoul(value, NULL, 10);
+        } else if (strcmp(argv[i], "--audio") == 0) {
+            rec_config.audio_path = value;
+        } else {
+            usage();
+            return 1;
+        }
+        i++;
+    }
+    if (rec_config.video_path) {
+        rec_config.video = video_format(rec_config.video_path);
+        if (format && strcmp(format, "y4m") == 0) {
+            rec_config.video = RECORDER_VIDEO_Y4M;
+        } else if (format && strcmp(format, "indexed") == 0) {
+            rec_config.video = RECORDER_VIDEO_INDEXED;
+        } else if (format) {
+            usage();
+            return 1;
+        }
+    }
+    if (!rec_config.video_path && !rec_config.audio_path) {
+        fprintf(stderr, "Nothing to record: give --video and/or --audio\n");
+        return 1;
+    }
+    
+    gigatron_config_t config = gigatron_default_config();
+    gigatron_t cpu;
+    vga_t vga;
+    audio_t audio;
+    loader_t loader;
+    machine_t machine;
+    recorder_t recorder;
+    
+    if (!gigatron_init(&cpu, &config) || !vga_init(&vga, &cpu) || !audio_init(&audio, &cpu) ||
+        !loader_init(&loader, &cpu)) {
+        fprintf(stderr, "Failed to initialize emulator\n");
+        return 1;
+    }
+    if (!gigatron_load_rom_file(&cpu, rom_path)) {
+        fprintf(stderr, "Failed to load ROM: %s\n", rom_path);
+        return 1;
+    }
+    gigatron_reset(&cpu);
+    machine_init(&machine, &cpu, &vga, &loader);
+    if (gt1_path) {
+        gt1_file_t* gt1 = loader_load_gt1_file(gt1_path);
+        if (!gt1) {
+            fprintf(stderr, "Failed to load GT1: %s\n", gt1_path);
+            return 1;
+        }
+        loader_start(&loader, gt1);
+    }
+    
+    rec_config.sample_rate = audio.sample_rate;
+    if (!recorder_open(&recorder, &rec_config, cpu.hz)) {
+        fprintf(stderr, "Failed to create recording\n");
+        return 1;
+    }
+    
+    /* Both streams start on a frame boundary: boot to the first VSYNC untapped */
+    uint64_t start = pacer_now_ns();
+    run_frame(&machine, &audio);
+    vga_set_scanline_callback(&vga, recorder_scanline, &recorder);
+    audio_set_sample_callback(&audio, recorder_audio, &recorder);
+    for (uint32_t i = 0; i < frames; i++) {
+        run_frame(&machine, &audio);
+        recorder_end_frame(&recorder, vga_get_frame_hash(&vga));
+    }
+    bool ok = recorder_close(&recorder);
+    double seconds = (double)(pacer_now_ns() - start) * 1e-9;
+    
+    /* Statistics stay valid after closing */
+    double emulated = (double)recorder.frames * GIGATRON_CYCLES_PER_FRAME / (double)cpu.hz;
+    printf("Frames:     %llu (%.2f s emulated)\n", (unsigned long long)recorder.frames, emulated);
+    printf("Time:       %.3f s (%.2fx real time)\n", seconds, seconds > 0.0 ? emulated / seconds : 0.0);
+    printf("Elided:     %llu static frames\n", (unsigned long long)recorder.elided);
+    printf("Samples:    %llu\n", (unsigned long long)recorder.recorded_samples);
+    if (rec_config.video_path) {
+        printf("Video:      %s, %s, %llu bytes\n", rec_config.video_path,
+               recorder_video_name(rec_config.video), (unsigned long long)recorder.video_bytes);
+    }
+    if (rec_config.audio_path) {
+        printf("Audio:      %s, %llu bytes\n", rec_config.audio_path,
+               (unsigned long long)recorder.audio_bytes);
+    }
+    printf("Stalls:     %llu\n", (unsigned long long)recorder.stalls);
+    
+    loader_shutdown(&loader);
+    audio_shutdown(&audio);
+    vga_shutdown(&vga);
+    gigatron_shutdown(&cpu);
+    
+    if (!ok) {
+        fprintf(stderr, "Failed to write recording\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,221 @@
+/**
+ * Gigatron Trace Tool
+ * 
+ * Records execution traces headless and dumps or filters them:
+ *   gigatron_trace record <rom> <frames> <trace>
+ *   gigatron_trace info <trace>
+ *   gigatron_trace dump <trace> [--from C] [--to C] [--pc A[:B]] [--write A[:B]] [--limit N]
+ */
+
+#include "gigatron.h"
+#include "vga.h"
+#include "machine.h"
+#include "pacer.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Address range filter, inclusive
+ */
+typedef struct trace_range_t {
+    bool enabled;
+    uint32_t lo;
+    uint32_t hi;
+} trace_range_t;
+
+static void usage(void) {
+    fprintf(stderr,
+            "Usage:\n"
+            "  gigatron_trace record <rom> <frames> <trace>\n"
+            "  gigatron_trace info <trace>\n"
+            "  gigatron_trace dump <trace> [--from CYCLE] [--to CYCLE] [--pc ADDR[:ADDR]]\n"
+            "                      [--write ADDR[:ADDR]] [--limit N]\n"
+            "Addresses are hexadecimal, cycles and counts decimal.\n");
+}
+
+/**
+ * Parse "lo" or "lo:hi" (hexadecimal)
+ */
+static bool parse_range(const char* text, trace_range_t* range) {
+    char* end;
+    range->lo = (uint32_t)strtoul(text, &end, 16);
+    range->hi = range->lo;
+    if (*end == ':') {
+        range->hi = (uint32_t)strtoul(end + 1, &end, 16);
+    }
+    range->enabled = true;
+    return *end == '\0' && range->lo <= range->hi;
+}
+
+static inline bool in_range(const trace_range_t* range, uint32_t value) {
+    return value >= range->lo && value <= range->hi;
+}
+
+/**
+ * Run a ROM for a number of frames with tracing on
+ */
+static int cmd_record(const char* rom_path, uint32_t frames, const char* trace_path) {
+    gigatron_config_t config = gigatron_default_config();
+    gigatron_t cpu;
+    vga_t vga;
+    machine_t machine;
+    trace_writer_t tracer;
+    
+    if (!gigatron_init(&cpu, &config) || !vga_init(&vga, &cpu)) {
+        fprintf(stderr, "Failed to initialize emulator\n");
+        return 1;
+    }
+    if (!gigatron_load_rom_file(&cpu, rom_path)) {
+        fprintf(stderr, "Failed to load ROM: %s\n", rom_path);
+        return 1;
+    }
+    gigatron_reset(&cpu);
+    if (!trace_writer_open(&tracer, trace_path, cpu.hz)) {
+        fprintf(stderr, "Failed to create trace: %s\n", trace_path);
+        return 1;
+    }
+    
+    machine_init(&machine, &cpu, &vga, NULL);
+    machine_set_tracer(&machine, &tracer);
+    
+    uint64_t start = pacer_now_ns();
+    for (uint32_t i = 0; i < frames; i++) {
+        machine_run(&machine, GIGATRON_CYCLES_PER_FRAME);
+    }
+    bool ok = trace_writer_close(&tracer);
+    double seconds = (double)(pacer_now_ns() - start) * 1e-9;
+    
+    /* Statistics stay valid after closing */
+    uint64_t records = tracer.records;
+    double emulated = (double)records / (double)cpu.hz;
+    printf("Records:    %llu (%.2f s emulated)\n", (unsigned long long)records, emulated);
+    printf("Time:       %.3f s (%.2fx real time)\n", seconds, seconds > 0.0 ? emulated / seconds : 0.0);
+    printf("Encoded:    %.2f bytes/record\n", records ? (double)tracer.raw_bytes / (double)records : 0.0);
+    printf("File:       %llu bytes (%.2f bytes/record)\n", (unsigned long long)tracer.file_bytes,
+           records ? (double)tracer.file_bytes / (double)records : 0.0);
+    printf("Stalls:     %llu\n", (unsigned long long)tracer.stalls);
+    
+    vga_shutdown(&vga);
+    gigatron_shutdown(&cpu);
+    
+    if (!ok) {
+        fprintf(stderr, "Failed to write trace\n");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Print the block index summary
+ */
+static int cmd_info(const char* trace_path) {
+    trace_reader_t reader;
+    if (!trace_reader_open(&reader, trace_path)) {
+        fprintf(stderr, "Failed to open trace: %s\n", trace_path);
+        return 1;
+    }
+    
+    printf("Clock:      %u Hz\n", reader.hz);
+    printf("Blocks:     %u\n", reader.num_blocks);
+    printf("Records:    %llu\n", (unsigned long long)reader.num_records);
+    
+    /* Contiguous cycle ranges */
+    for (uint32_t i = 0; i < reader.num_blocks;) {
+        uint64_t first = reader.blocks[i].first_cycle;
+        uint64_t end = first + reader.blocks[i].count;
+        for (i++; i < reader.num_blocks && reader.blocks[i].first_cycle == end; i++) {
+            end += reader.blocks[i].count;
+        }
+        printf("Cycles:     %llu - %llu\n", (unsigned long long)first, (unsigned long long)(end - 1));
+    }
+    
+    trace_reader_close(&reader);
+    return 0;
+}
+
+/**
+ * Print matching records as text
+ */
+static int cmd_dump(const char* trace_path, int argc, char** argv) {
+    uint64_t from = 0;
+    uint64_t to = UINT64_MAX;
+    uint64_t limit = UINT64_MAX;
+    trace_range_t pc_range = { false, 0, 0 };
+    trace_range_t write_range = { false, 0, 0 };
+    
+    for (int i = 0; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (!value) {
+            usage();
+            return 1;
+        }
+        if (strcmp(argv[i], "--from") == 0) {
+            from = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--to") == 0) {
+            to = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--limit") == 0) {
+            limit = strtoull(value, NULL, 10);
+        } else if (strcmp(argv[i], "--pc") == 0) {
+            if (!parse_range(value, &pc_range)) {
+                usage();
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--write") == 0) {
+            if (!parse_range(value, &write_range)) {
+                usage();
+                return 1;
+            }
+        } else {
+            usage();
+            return 1;
+        }
+        i++;
+    }
+    
+    trace_reader_t reader;
+    if (!trace_reader_open(&reader, trace_path)) {
+        fprintf(stderr, "Failed to open trace: %s\n", trace_path);
+        return 1;
+    }
+    
+    printf("# cycle       pc    ir    ac x  y  out outx  write\n");
+    
+    trace_record_t record;
+    uint64_t printed = 0;
+    if (trace_reader_seek(&reader, from)) {
+        while (printed < limit && trace_reader_next(&reader, &record) && record.cycle <= to) {
+            if (pc_range.enabled && !in_range(&pc_range, record.pc)) continue;
+            if (write_range.enabled && (!(record.flags & TRACE_RECORD_WRITE) ||
+                                        !in_range(&write_range, record.write_addr))) continue;
+            
+            printf("%-12llu  %04X  %04X  %02X %02X %02X %02X  %02X",
+                   (unsigned long long)record.cycle, record.pc, record.ir,
+                   record.ac, record.x, record.y, record.out, record.outx);
+            if (record.flags & TRACE_RECORD_WRITE) {
+                printf("    [%04X]=%02X", record.write_addr, record.write_value);
+            }
+            printf("\n");
+            printed++;
+        }
+    }
+    
+    trace_reader_close(&reader);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc == 5 && strcmp(argv[1], "record") == 0) {
+        return cmd_record(argv[2], (uint32_t)strtoul(argv[3], NULL, 10), argv[4]);
+    }
+    if (argc == 3 && strcmp(argv[1], "info") == 0) {
+        return cmd_info(argv[2]);
+    }
+    if (argc >= 3 && strcmp(argv[1], "dump") == 0) {
+        return cmd_dump(argv[2], argc - 3, argv + 3);
+    }
+    
+    usage();
+    return 1;
+}